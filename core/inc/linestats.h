@@ -0,0 +1,69 @@
+#ifndef LineStats_H
+#define LineStats_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "Histogram.h"
+
+/*
+ * Per line throughput and latency statistics for the bit reversal program.
+ *
+ * Each worker owns one LINE_STATS_T and is its only writer, so recording needs no locks. Counters are
+ * stored with relaxed atomics so a reporter thread may read them while the workers are running.
+ */
+
+typedef enum {
+    LINE_STAGE_DECODE = 0,      /* hex text to binary */
+    LINE_STAGE_REVERSE,         /* ReverseBits */
+    LINE_STAGE_ENCODE,          /* binary back to hex text */
+    LINE_STAGE_TOTAL,           /* the whole line */
+    LINE_STAGE_COUNT
+} LINE_STAGE;
+
+typedef struct {
+    uint64_t lines;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    HISTOGRAM_T stage[LINE_STAGE_COUNT];
+} LINE_STATS_T;
+
+static inline uint64_t LineStatsNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define LINE_STATS_ADD(field, n)  __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+static inline void LineStatsRecord(LINE_STATS_T *stats, LINE_STAGE stage, uint64_t ns)
+{
+    HistogramRecord(stats->stage + stage, ns);
+}
+
+static inline void LineStatsLine(LINE_STATS_T *stats, uint64_t bytesIn, uint64_t bytesOut)
+{
+    LINE_STATS_ADD(stats->lines, 1);
+    LINE_STATS_ADD(stats->bytesIn, bytesIn);
+    LINE_STATS_ADD(stats->bytesOut, bytesOut);
+}
+
+/*
+ * LineStatsInit - empties count stats
+ */
+void LineStatsInit(LINE_STATS_T *stats, int count);
+
+/*
+ * LineStatsMerge - adds the counters of count per worker stats into total
+ */
+void LineStatsMerge(LINE_STATS_T *total, LINE_STATS_T *workers, int count);
+
+/*
+ * LineStatsReport - prints rates and per stage latency percentiles.
+ * Rates are computed from the difference between now and previous over elapsedNs; previous may be NULL.
+ */
+void LineStatsReport(FILE *f, const char *label, const LINE_STATS_T *now, const LINE_STATS_T *previous,
+                     uint64_t elapsedNs);
+
+#endif // LineStats_H
@@ -0,0 +1,39 @@
+#ifndef Pipeline_H
+#define Pipeline_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * Line handler run by the pipeline workers. Processes one input line (as read by fgets, newline included)
+ * and writes at most outSize bytes of output to out. Returns the number of bytes written.
+ * worker is the index of the calling worker (0 .. workers-1) so handlers can keep per-worker state.
+ */
+typedef int (*PIPELINE_LINE_HANDLER_T)(char *line, char *out, int outSize, int worker);
+
+typedef struct {
+    int workers;                        /* number of worker threads decoding lines */
+    int batchLines;                     /* lines handed to a worker at a time, fewer when the input goes idle */
+    int batchesInFlight;                /* batches held by the pipeline at once; caps memory use */
+    int lineSize;                       /* size of the fgets buffer for one line */
+    int outSize;                        /* max output bytes produced for one line */
+    PIPELINE_LINE_HANDLER_T handler;    /* per line processing function */
+} PIPELINE_CONFIG_T;
+
+#define PIPELINE_DEFAULT_BATCH_LINES 1024
+
+/*
+ * RunLinePipeline - reads lines from in, processes them on a set of worker threads and writes the results
+ * to out in input order.
+ *
+ * The calling thread reads batches of lines, the workers run the handler over whole batches and a writer
+ * thread emits finished batches through a reorder ring. The ring holds batchesInFlight batches, so memory
+ * stays bounded regardless of input size. A batch is handed off early when reading in would block, and the
+ * writer flushes out whenever it catches up, so interactive input is answered line by line. Worker and writer
+ * threads are taken from the thread pool, which must be initialized by the caller.
+ *
+ * Returns true if every line was processed and written.
+ */
+bool RunLinePipeline(FILE *in, FILE *out, const PIPELINE_CONFIG_T *config);
+
+#endif // Pipeline_H
@@ -6,4 +6,23 @@
 void ReverseBits(unsigned char *arr, int len_arr);
 
 
+/*
+ * ReverseBits kernels. Every kernel reverses the bit order across the whole array exactly like
+ * ReverseBits; they differ only in how the work is done.
+ */
+typedef void (*REVERSE_BITS_FN)(unsigned char *arr, int len_arr);
+
+typedef struct {
+    const char *name;
+    REVERSE_BITS_FN fn;
+} REVERSE_KERNEL_T;
+
+void ReverseBitsReference(unsigned char *arr, int len_arr);   // bit by bit swap loop
+void ReverseBitsTable(unsigned char *arr, int len_arr);       // byte swap with a 256 entry bit reversal table
+void ReverseBitsWord64(unsigned char *arr, int len_arr);      // 64 bit byte swap and mask shifts, table for the middle
+
+// All kernels, terminated by an entry with a NULL name
+extern const REVERSE_KERNEL_T ReverseKernels[];
+
+
 #endif // Reverse_H
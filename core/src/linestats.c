@@ -0,0 +1,59 @@
+#include "linestats.h"
+
+static const char *stageNames[LINE_STAGE_COUNT] = {
+    "decode",
+    "reverse",
+    "encode",
+    "total",
+};
+
+void LineStatsInit(LINE_STATS_T *stats, int count)
+{
+    for (int w = 0; w < count; w++) {
+        LINE_STATS_T *s = stats + w;
+        s->lines = s->bytesIn = s->bytesOut = 0;
+        for (int st = 0; st < LINE_STAGE_COUNT; st++)
+            HistogramInit(s->stage + st);
+    }
+}
+
+void LineStatsMerge(LINE_STATS_T *total, LINE_STATS_T *workers, int count)
+{
+    LineStatsInit(total, 1);
+
+    for (int w = 0; w < count; w++) {
+        LINE_STATS_T *s = workers + w;
+        total->lines += __atomic_load_n(&s->lines, __ATOMIC_RELAXED);
+        total->bytesIn += __atomic_load_n(&s->bytesIn, __ATOMIC_RELAXED);
+        total->bytesOut += __atomic_load_n(&s->bytesOut, __ATOMIC_RELAXED);
+
+        for (int st = 0; st < LINE_STAGE_COUNT; st++)
+            HistogramMerge(total->stage + st, s->stage + st);
+    }
+}
+
+void LineStatsReport(FILE *f, const char *label, const LINE_STATS_T *now, const LINE_STATS_T *previous,
+                     uint64_t elapsedNs)
+{
+    double seconds = elapsedNs / 1e9;
+    uint64_t lines = now->lines - (previous ? previous->lines : 0);
+    uint64_t bytesIn = now->bytesIn - (previous ? previous->bytesIn : 0);
+    uint64_t bytesOut = now->bytesOut - (previous ? previous->bytesOut : 0);
+
+    if (seconds <= 0)
+        seconds = 1e-9;
+
+    fprintf(f, "stats %s: %.3f s, %llu lines (%.0f lines/s), in %.2f MB/s, out %.2f MB/s\n",
+            label, seconds, (unsigned long long)lines, lines / seconds, bytesIn / seconds / 1e6,
+            bytesOut / seconds / 1e6);
+    fprintf(f, "  %-8s %10s %10s %10s %10s  (ns per line)\n", "stage", "p50", "p90", "p99", "max");
+
+    for (int st = 0; st < LINE_STAGE_COUNT; st++) {
+        const HISTOGRAM_T *h = now->stage + st;
+        fprintf(f, "  %-8s %10llu %10llu %10llu %10llu\n", stageNames[st],
+                (unsigned long long)HistogramPercentile(h, 50),
+                (unsigned long long)HistogramPercentile(h, 90),
+                (unsigned long long)HistogramPercentile(h, 99),
+                (unsigned long long)h->max);
+    }
+}
@@ -0,0 +1,293 @@
+#define LOG_MODULE_NAME     "Pipeline"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include "pipeline.h"
+#include "Threads.h"
+#include "Logger.h"
+#include "Trace.h"
+
+typedef enum {
+    BATCH_FREE = 0,     /* slot may be filled by the reader */
+    BATCH_FILLED,       /* lines read, waiting for a worker */
+    BATCH_DONE,         /* output produced, waiting for the writer */
+} BATCH_STATE;
+
+typedef struct {
+    BATCH_STATE state;
+    int lineCount;      /* lines stored in lines */
+    int outLen;         /* bytes stored in out */
+    char *lines;        /* lineCount entries of lineSize bytes each */
+    char *out;          /* concatenated output of every line in the batch */
+} BATCH_T;
+
+/*
+ * The batches form a ring indexed by sequence number. A batch with sequence seq always lives in
+ * slot seq % batchCount and is only refilled once the writer has emitted it, so the ring doubles as the
+ * reorder buffer: the writer simply waits for the slot of the next sequence number to become DONE.
+ */
+typedef struct {
+    const PIPELINE_CONFIG_T *config;
+    FILE *out;
+    BATCH_T *batches;
+    int batchCount;
+    pthread_mutex_t lock;
+    pthread_cond_t slotFree;        /* writer -> reader: a slot was emitted */
+    pthread_cond_t workReady;       /* reader -> workers: a batch was filled, or input ended */
+    pthread_cond_t slotDone;        /* workers -> writer: the next batch in order is done */
+    long readSeq;                   /* next sequence number the reader will fill */
+    long workSeq;                   /* next sequence number a worker will claim */
+    long writeSeq;                  /* next sequence number the writer will emit */
+    bool eof;                       /* reader has published its last batch */
+    bool writeFailed;
+} PIPELINE_T;
+
+typedef struct {
+    PIPELINE_T *pipeline;
+    int index;
+} WORKER_CONTEXT_T;
+
+static void *pipeline_worker(void *arg)
+{
+    WORKER_CONTEXT_T *ctx = (WORKER_CONTEXT_T *)arg;
+    PIPELINE_T *p = ctx->pipeline;
+    const PIPELINE_CONFIG_T *config = p->config;
+
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (p->workSeq == p->readSeq && !p->eof)
+            pthread_cond_wait(&p->workReady, &p->lock);
+        if (p->workSeq == p->readSeq) {
+            pthread_mutex_unlock(&p->lock);
+            break;
+        }
+        long seq = p->workSeq++;
+        pthread_mutex_unlock(&p->lock);
+
+        BATCH_T *batch = p->batches + seq % p->batchCount;
+        TraceBegin(TRACE_CATEGORY_USER, "batch", NULL, seq);
+        batch->outLen = 0;
+        for (int i = 0; i < batch->lineCount; i++) {
+            batch->outLen += config->handler(batch->lines + (size_t)i * config->lineSize,
+                                             batch->out + batch->outLen, config->outSize, ctx->index);
+        }
+        TraceEnd(TRACE_CATEGORY_USER, "batch");
+
+        pthread_mutex_lock(&p->lock);
+        batch->state = BATCH_DONE;
+        if (seq == p->writeSeq)
+            pthread_cond_signal(&p->slotDone);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    return NULL;
+}
+
+static void *pipeline_writer(void *arg)
+{
+    PIPELINE_T *p = (PIPELINE_T *)arg;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        BATCH_T *batch = p->batches + p->writeSeq % p->batchCount;
+        while (batch->state != BATCH_DONE && !(p->eof && p->writeSeq == p->readSeq))
+            pthread_cond_wait(&p->slotDone, &p->lock);
+        if (batch->state != BATCH_DONE)
+            break;
+        pthread_mutex_unlock(&p->lock);
+
+        TraceBegin(TRACE_CATEGORY_USER, "write", NULL, p->writeSeq);
+        if (fwrite(batch->out, 1, batch->outLen, p->out) != (size_t)batch->outLen)
+            p->writeFailed = true;
+        TraceEnd(TRACE_CATEGORY_USER, "write");
+
+        pthread_mutex_lock(&p->lock);
+        batch->state = BATCH_FREE;
+        p->writeSeq++;
+        pthread_cond_signal(&p->slotFree);
+
+        /* caught up with the workers: let an interactive reader see what is done so far */
+        if (p->batches[p->writeSeq % p->batchCount].state != BATCH_DONE) {
+            pthread_mutex_unlock(&p->lock);
+            if (fflush(p->out) != 0)
+                p->writeFailed = true;
+            pthread_mutex_lock(&p->lock);
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+/*
+ * True when in has no line buffered and reading would block, as on a terminal or a pipe that has gone quiet.
+ * Streams without a descriptor, and stdio without a visible read buffer, never count as idle.
+ */
+static bool pipeline_input_idle(FILE *in)
+{
+    int fd = fileno(in);
+    if (fd < 0)
+        return false;
+#ifdef __GLIBC__
+    if (in->_IO_read_ptr < in->_IO_read_end)
+        return false;
+#else
+    return false;
+#endif
+    struct pollfd pending = { fd, POLLIN, 0 };
+    return poll(&pending, 1, 0) == 0;
+}
+
+/*
+ * Fill the next batch from in. A batch is handed off before it is full when the input goes idle, so lines
+ * typed or trickling in are answered without waiting for batchLines more. Returns false once the input is
+ * exhausted and nothing was read.
+ */
+static bool pipeline_read_batch(PIPELINE_T *p, FILE *in)
+{
+    const PIPELINE_CONFIG_T *config = p->config;
+
+    pthread_mutex_lock(&p->lock);
+    BATCH_T *batch = p->batches + p->readSeq % p->batchCount;
+    while (batch->state != BATCH_FREE)
+        pthread_cond_wait(&p->slotFree, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    /* The slot is owned by the reader until it is published as FILLED */
+    batch->lineCount = 0;
+    bool more = true;
+    while (batch->lineCount < config->batchLines) {
+        if (batch->lineCount > 0 && pipeline_input_idle(in))
+            break;
+        if (fgets(batch->lines + (size_t)batch->lineCount * config->lineSize, config->lineSize, in) == NULL) {
+            more = false;
+            break;
+        }
+        batch->lineCount++;
+    }
+
+    if (batch->lineCount == 0)
+        return false;
+
+    pthread_mutex_lock(&p->lock);
+    batch->state = BATCH_FILLED;
+    p->readSeq++;
+    pthread_cond_signal(&p->workReady);
+    pthread_mutex_unlock(&p->lock);
+
+    return more;
+}
+
+static bool pipeline_alloc(PIPELINE_T *p)
+{
+    const PIPELINE_CONFIG_T *config = p->config;
+
+    p->batches = calloc(p->batchCount, sizeof(BATCH_T));
+    if (p->batches == NULL)
+        return false;
+
+    for (int i = 0; i < p->batchCount; i++) {
+        p->batches[i].lines = malloc((size_t)config->batchLines * config->lineSize);
+        p->batches[i].out = malloc((size_t)config->batchLines * config->outSize);
+        if (p->batches[i].lines == NULL || p->batches[i].out == NULL)
+            return false;
+    }
+    return true;
+}
+
+static void pipeline_free(PIPELINE_T *p)
+{
+    if (p->batches == NULL)
+        return;
+
+    for (int i = 0; i < p->batchCount; i++) {
+        free(p->batches[i].lines);
+        free(p->batches[i].out);
+    }
+    free(p->batches);
+}
+
+bool RunLinePipeline(FILE *in, FILE *out, const PIPELINE_CONFIG_T *config)
+{
+    if (in == NULL || out == NULL || config == NULL || config->handler == NULL ||
+        config->workers <= 0 || config->batchLines <= 0 || config->lineSize <= 1 || config->outSize <= 0) {
+        LogMessage(LOG_LEVEL_ERROR, "Invalid pipeline configuration");
+        return false;
+    }
+
+    /* the writer needs a pool thread of its own */
+    int workers = config->workers;
+    if (workers > THREAD_POOL_SIZE - 1) {
+        LogMessage(LOG_LEVEL_WARNING, "Pipeline workers limited to %d", THREAD_POOL_SIZE - 1);
+        workers = THREAD_POOL_SIZE - 1;
+    }
+
+    PIPELINE_T p;
+    memset(&p, 0, sizeof(p));
+    p.config = config;
+    p.out = out;
+    p.batchCount = config->batchesInFlight;
+    if (p.batchCount < workers + 1)
+        p.batchCount = workers + 1;
+
+    if (!pipeline_alloc(&p)) {
+        LogMessage(LOG_LEVEL_ERROR, "Failed to allocate %d pipeline batches", p.batchCount);
+        pipeline_free(&p);
+        return false;
+    }
+
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.slotFree, NULL);
+    pthread_cond_init(&p.workReady, NULL);
+    pthread_cond_init(&p.slotDone, NULL);
+
+    WORKER_CONTEXT_T contexts[THREAD_POOL_SIZE];
+    THREAD_T threads[THREAD_POOL_SIZE];
+    int started = 0;
+    bool success = true;
+
+    THREAD_T writer;
+    bool writerStarted = InitThread(&writer, "pipeline writer", pipeline_writer, &p);
+
+    for (int i = 0; writerStarted && i < workers; i++) {
+        contexts[i].pipeline = &p;
+        contexts[i].index = i;
+        if (!InitThread(&threads[i], "pipeline worker", pipeline_worker, &contexts[i]))
+            break;
+        started++;
+    }
+
+    if (!writerStarted || started == 0) {
+        LogMessage(LOG_LEVEL_ERROR, "Failed to start pipeline threads");
+        success = false;
+    } else {
+        while (pipeline_read_batch(&p, in))
+            ;
+    }
+
+    pthread_mutex_lock(&p.lock);
+    p.eof = true;
+    pthread_cond_broadcast(&p.workReady);
+    pthread_cond_signal(&p.slotDone);
+    pthread_mutex_unlock(&p.lock);
+
+    for (int i = 0; i < started; i++)
+        WaitThreadComplete(&threads[i], 0, NULL);
+    if (writerStarted)
+        WaitThreadComplete(&writer, 0, NULL);
+
+    if (p.writeFailed) {
+        LogMessage(LOG_LEVEL_ERROR, "Failed writing pipeline output");
+        success = false;
+    }
+
+    pthread_cond_destroy(&p.slotDone);
+    pthread_cond_destroy(&p.workReady);
+    pthread_cond_destroy(&p.slotFree);
+    pthread_mutex_destroy(&p.lock);
+    pipeline_free(&p);
+
+    return success;
+}
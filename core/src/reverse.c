@@ -1,26 +1,42 @@
-
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include "reverse.h"
 
+const REVERSE_KERNEL_T ReverseKernels[] = {
+    {"reference", ReverseBitsReference},
+    {"table", ReverseBitsTable},
+    {"word64", ReverseBitsWord64},
+    {NULL, NULL}
+};
+
 /*
  * ReverseBits - reverses the bit order across an entire byte array
  */
 void ReverseBits(unsigned char *arr, int len_arr) {
+    ReverseBitsReference(arr, len_arr);
+}
+
+/*
+ * ReverseBitsReference - the original bit loop, kept as the reference every other kernel is checked against
+ */
+void ReverseBitsReference(unsigned char *arr, int len_arr) {
     // Guard clause for NULL pointer or non-positive length
     if (arr == NULL || len_arr <= 0)
         return;
 
-    int total_bits = len_arr * 8;
+    // size_t, as an int bit count overflows from 256 MB
+    size_t total_bits = (size_t)len_arr * 8;
 
     // Loop through half of the bits so we move from left and right side ot the center
-    for (int left_index = 0; left_index < total_bits / 2; ++left_index) {
+    for (size_t left_index = 0; left_index < total_bits / 2; ++left_index) {
         // Calculate the corresponding left index
-        int left_byte = left_index / 8;
+        size_t left_byte = left_index / 8;
         int left_mask  = left_index % 8;
 
         // Calculate the corresponding right index
-        int right_index = total_bits - 1 - left_index;
-        int right_byte = right_index / 8;
+        size_t right_index = total_bits - 1 - left_index;
+        size_t right_byte = right_index / 8;
         int right_mask  = right_index % 8;
 
         // Get the left and right bits
@@ -34,3 +50,68 @@ void ReverseBits(unsigned char *arr, int len_arr) {
         }
     }
 }
+
+// Bit reversal of every byte value
+#define R2(n)   n, n + 2*64, n + 1*64, n + 3*64
+#define R4(n)   R2(n), R2(n + 2*16), R2(n + 1*16), R2(n + 3*16)
+#define R6(n)   R4(n), R4(n + 2*4 ), R4(n + 1*4 ), R4(n + 3*4 )
+static const unsigned char reverse_table[256] = { R6(0), R6(2), R6(1), R6(3) };
+
+/*
+ * ReverseBitsTable - swaps bytes from both ends toward the center, reversing each through the table
+ */
+void ReverseBitsTable(unsigned char *arr, int len_arr) {
+    if (arr == NULL || len_arr <= 0)
+        return;
+
+    unsigned char *left = arr;
+    unsigned char *right = arr + len_arr - 1;
+
+    for (; left < right; left++, right--) {
+        unsigned char tmp = reverse_table[*left];
+        *left = reverse_table[*right];
+        *right = tmp;
+    }
+
+    // odd length leaves the middle byte to reverse in place
+    if (left == right)
+        *left = reverse_table[*left];
+}
+
+// Reverse the bits of a 64 bit word held in memory order: swap the bytes, then reverse the bits in each byte
+static inline uint64_t reverse_word64(uint64_t v) {
+    v = __builtin_bswap64(v);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    return v;
+}
+
+/*
+ * ReverseBitsWord64 - swaps 8 byte words from both ends toward the center. Words are loaded with memcpy so
+ * any alignment is fine. The remaining middle, under 16 bytes, is done by the table kernel.
+ */
+void ReverseBitsWord64(unsigned char *arr, int len_arr) {
+    if (arr == NULL || len_arr <= 0)
+        return;
+
+    unsigned char *left = arr;
+    unsigned char *right = arr + len_arr;
+
+    while (right - left >= 16) {
+        uint64_t l, r;
+        right -= 8;
+        memcpy(&l, left, 8);
+        memcpy(&r, right, 8);
+        l = reverse_word64(l);
+        r = reverse_word64(r);
+        memcpy(left, &r, 8);
+        memcpy(right, &l, 8);
+        left += 8;
+    }
+
+    ReverseBitsTable(left, right - left);
+}
+
+
+
@@ -4,43 +4,252 @@
 #include <stdlib.h>
 #include <string.h>
 #include "reverse.h"
+#include "pipeline.h"
+#include "linestats.h"
+#include "Threads.h"
+#include "Events.h"
+#include "Logger.h"
+#include "Trace.h"
 
 /* Prototypes  */
 int HexToBinary(char* hex, unsigned char *binary, int lenBinary);
+int ReverseLine(char* line, char* out, int outSize, int worker);
+
+#define LINE_BUF_SIZE 80                        /* Input buffer for ASCII hex string*/
+#define BITS_BUF_SIZE 40                        /* Stores bits to be reversed and result of reversal */
+#define LINE_OUT_SIZE (BITS_BUF_SIZE * 4 + 8)   /* "<hex> --> <hex>\n" */
+
+static LINE_STATS_T *lineStats = NULL;          /* one per worker when --stats is given, otherwise NULL */
+static int lineStatsCount = 0;
+
+typedef struct {
+  EVENT_T stop;               /* signaled at exit to end the periodic reports */
+  int intervalSec;
+  uint64_t start;
+} STATS_REPORTER_T;
+
+/*---------------------------------------------------------------------------------------------
+ Periodic statistics report. Prints the rates of the last interval and the latencies so far to stderr.
+---------------------------------------------------------------------------------------------
+*/
+static void* StatsReporter(void* arg)
+{
+  STATS_REPORTER_T *reporter = (STATS_REPORTER_T*) arg;
+  LINE_STATS_T *now = malloc(2 * sizeof(LINE_STATS_T));
+  LINE_STATS_T *previous = now + 1;
+  uint64_t last = reporter->start;
+
+  if (now == NULL)
+    return NULL;
+  LineStatsInit(now, 2);
+
+  while (!WaitForEvent(&reporter->stop, reporter->intervalSec * 1000)) {
+    uint64_t t = LineStatsNow();
+    LineStatsMerge(now, lineStats, lineStatsCount);
+    LineStatsReport(stderr, "interval", now, previous, t - last);
+    memcpy(previous, now, sizeof(LINE_STATS_T));
+    last = t;
+  }
+
+  free(now);
+  return NULL;
+}
 
 
 /*-----------------------------------------------------------------------------------------------
- Program to test bit reversal code. Standard arguments are not used.
+ Program to test bit reversal code.
   The main program loop reads lines from stdin converts the input line from ASCII
   hex to an array of bytes (unsigned chars), reverses the bits, and prints the results. This
   keeps looping until CTRL-C is pressed or end-of-file is reached,
+
+  Options:
+    --threads=N     process lines on a pipeline of N worker threads. Output order is unchanged. At most
+                    THREAD_POOL_SIZE-1 workers, one fewer with --stats=N, which reports on a pool thread
+    --batch=N       lines handed to a pipeline worker at a time, fewer when stdin has nothing more waiting
+    --stats[=N]     report throughput and per stage latency on stderr at exit, and every N seconds
+    --trace=FILE    record a timeline of the pool threads, their waits and the pipeline batches, and
+                    write it to FILE as Chrome trace event JSON at exit
 ----------------------------------------------------------------------------------------------
 */
-int main(void)
+int main(int argc, char *argv[])
 {
-  char buf[80];                    /* Input buffer for ASCII hex string*/
-  unsigned char bits[40];          /* Stores bits to be reversed and result of reversal */
-  int len, i;
+  char buf[LINE_BUF_SIZE];
+  char out[LINE_OUT_SIZE];
+  int threads = 0, batch = PIPELINE_DEFAULT_BATCH_LINES;
+  int stats = 0, statsInterval = 0;
+  const char *tracePath = NULL;
+  int i, len, ret = 0;
+
+  for (i=1; i<argc; i++) {
+    if (strncmp(argv[i], "--threads=", 10) == 0)
+      threads = atoi(argv[i] + 10);
+    else if (strncmp(argv[i], "--batch=", 8) == 0)
+      batch = atoi(argv[i] + 8);
+    else if (strcmp(argv[i], "--stats") == 0)
+      stats = 1;
+    else if (strncmp(argv[i], "--stats=", 8) == 0) {
+      stats = 1;
+      statsInterval = atoi(argv[i] + 8);
+    }
+    else if (strncmp(argv[i], "--trace=", 8) == 0)
+      tracePath = argv[i] + 8;
+    else {
+      fprintf(stderr, "usage: %s [--threads=N] [--batch=N] [--stats[=N]] [--trace=FILE]\n", argv[0]);
+      return 1;
+    }
+  }
 
   /* Loop reading and reversing hex string until EOF or CTRL-C */
   printf("Enter hexadecimal number to be bit reversed. Example: 3F2C45\n");
-  while (fgets(buf, sizeof(buf), stdin) != NULL) {
-    len = HexToBinary(buf, bits, sizeof(bits));
 
-    /* Print starting value of bits array (hex)*/
-    for (i=0; i<len; i++)
-      printf("%02X", bits[i]);
-    printf(" --> ");
+  if (tracePath != NULL) {
+    TraceSetThreadName("main");
+    TraceEnable(TRACE_CATEGORY_THREADS | TRACE_CATEGORY_WAITS | TRACE_CATEGORY_USER);
+  }
+
+  bool usePool = threads > 0 || statsInterval > 0;
+  if (usePool) {
+    LogSetConfig(LOG_LEVEL_WARNING, "%(asctime)s [%(levelname)s] [%(funcName)s]: %(message)s");
+    LogAddAppender(LogAppenderStderr, true);
+    if (!InitThreadPool())
+      return 1;
+  }
+
+  /* the pipeline writer and the stats reporter each take a pool thread of their own */
+  int maxThreads = THREAD_POOL_SIZE - 1 - (statsInterval > 0 ? 1 : 0);
+  if (threads > maxThreads) {
+    LogMessage(LOG_LEVEL_WARNING, "Pipeline workers limited to %d", maxThreads);
+    threads = maxThreads;
+  }
+
+  STATS_REPORTER_T reporter;
+  THREAD_T reporterThread;
+  bool reporterStarted = false;
+  uint64_t start = LineStatsNow();
+
+  if (stats) {
+    lineStatsCount = threads > 0 ? threads : 1;
+    lineStats = malloc(lineStatsCount * sizeof(LINE_STATS_T));
+    if (lineStats == NULL)
+      return 1;
+    LineStatsInit(lineStats, lineStatsCount);
+  }
+
+  if (statsInterval > 0) {
+    InitEvent(&reporter.stop, "stats stop");
+    reporter.intervalSec = statsInterval;
+    reporter.start = start;
+    reporterStarted = InitThread(&reporterThread, "stats reporter", StatsReporter, &reporter);
+  }
+
+  if (threads > 0) {
+    PIPELINE_CONFIG_T config = {
+      threads, batch, threads * 2 + 2, LINE_BUF_SIZE, LINE_OUT_SIZE, ReverseLine
+    };
+
+    fflush(stdout);
+    if (!RunLinePipeline(stdin, stdout, &config))
+      ret = 1;
+  } else {
+    while (fgets(buf, sizeof(buf), stdin) != NULL) {
+      len = ReverseLine(buf, out, sizeof(out), 0);
+      fwrite(out, 1, len, stdout);
+    }
+  }
+
+  if (reporterStarted) {
+    SignalEvent(&reporter.stop);
+    WaitThreadComplete(&reporterThread, 0, NULL);
+  }
+  if (statsInterval > 0)
+    DestroyEvent(&reporter.stop);
+
+  if (stats) {
+    LINE_STATS_T *total = malloc(sizeof(LINE_STATS_T));
+    if (total != NULL) {
+      fflush(stdout);
+      LineStatsMerge(total, lineStats, lineStatsCount);
+      LineStatsReport(stderr, "total", total, NULL, LineStatsNow() - start);
+      free(total);
+    }
+    free(lineStats);
+  }
+
+  if (usePool)
+    DestroyThreadPool(5000);
+
+  if (tracePath != NULL) {
+    TraceEnable(0);
+    if (!TraceDumpJsonFile(tracePath)) {
+      perror(tracePath);
+      ret = 1;
+    }
+  }
 
-    ReverseBits(bits, len);
+  return ret;
+}
+
+
+/*---------------------------------------------------------------------------------------------
+ Convert one input line from hex, reverse its bits and format "<before> --> <after>\n" into out.
+ Return the number of characters written. Stage timings are recorded when --stats is given.
+---------------------------------------------------------------------------------------------
+*/
+int ReverseLine(char* line, char* out, int outSize, int worker)
+{
+  static const char hexDigits[] = "0123456789ABCDEF";
+  unsigned char bits[BITS_BUF_SIZE];
+  char *wr = out;
+  int len, i;
+  LINE_STATS_T *stats = lineStats ? lineStats + worker : NULL;
+  uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+  size_t inLen = 0;
+
+  if (stats) {
+    inLen = strlen(line);
+    t0 = LineStatsNow();
+  }
+
+  len = HexToBinary(line, bits, sizeof(bits));
+  if (len * 4 + 6 > outSize)
+    return 0;
+
+  if (stats)
+    t1 = LineStatsNow();
+
+  /* Print starting value of bits array (hex)*/
+  for (i=0; i<len; i++) {
+    *wr++ = hexDigits[bits[i] >> 4];
+    *wr++ = hexDigits[bits[i] & 0x0F];
+  }
+  memcpy(wr, " --> ", 5);
+  wr += 5;
+
+  if (stats)
+    t2 = LineStatsNow();
+
+  ReverseBits(bits, len);
+
+  if (stats)
+    t3 = LineStatsNow();
+
+  /* Print reversed bits array (hex) */
+  for (i=0; i<len; i++) {
+    *wr++ = hexDigits[bits[i] >> 4];
+    *wr++ = hexDigits[bits[i] & 0x0F];
+  }
+  *wr++ = '\n';
 
-    /* Print reversed bits array (hex) */
-    for (i=0; i<len; i++)
-      printf("%02X", bits[i]);
-    printf("\n");
+  if (stats) {
+    uint64_t t4 = LineStatsNow();
+    LineStatsRecord(stats, LINE_STAGE_DECODE, t1 - t0);
+    LineStatsRecord(stats, LINE_STAGE_REVERSE, t3 - t2);
+    LineStatsRecord(stats, LINE_STAGE_ENCODE, (t2 - t1) + (t4 - t3));
+    LineStatsRecord(stats, LINE_STAGE_TOTAL, t4 - t0);
+    LineStatsLine(stats, inLen, wr - out);
   }
 
-  return 0;
+  return wr - out;
 }
 
 
@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include "Eeyore.h"
+#include "Histogram.h"
+
+// a percentile must land within the histogram's 1/64 resolution of the exact value
+static void assert_near(uint64_t actual, uint64_t expected, const char* msg){
+    uint64_t slack = expected / 64 + 1;
+    assert_greater_than_u64(actual + slack, expected, msg);
+    assert_less_than_u64(actual, expected + slack, msg);
+}
+
+TEST(test_histogram){
+
+    test_setup();
+
+    static HISTOGRAM_T h, odd, even, merged;
+    HistogramInit(&h);
+    HistogramInit(&odd);
+    HistogramInit(&even);
+    HistogramInit(&merged);
+
+    assert_equal((int)HistogramPercentile(&h, 99), 0, "empty histogram should answer 0");
+
+    for(uint64_t v = 1; v <= 100000; v++){
+        HistogramRecord(&h, v * 1000);
+        HistogramRecord(v % 2 ? &odd : &even, v * 1000);
+    }
+
+    assert_equal((int)h.totalCount, 100000, "every value should be counted");
+    assert_equal((int)h.min, 1000, "min should be exact");
+    assert_equal((int)h.max, 100000000, "max should be exact");
+    assert_near(HistogramPercentile(&h, 50), 50000000, "p50 of 1..100000 us");
+    assert_near(HistogramPercentile(&h, 99), 99000000, "p99 of 1..100000 us");
+    assert_near(HistogramPercentile(&h, 99.9), 99900000, "p99.9 of 1..100000 us");
+    assert_equal((int)HistogramPercentile(&h, 100), 100000000, "p100 should be the max");
+    assert_near((uint64_t)HistogramMean(&h), 50000500, "mean of 1..100000 us");
+
+    // small values are exact
+    HISTOGRAM_T* small = &merged;
+    for(int v = 0; v < 100; v++) HistogramRecord(small, v);
+    assert_equal((int)HistogramPercentile(small, 50), 49, "values below 128 should be exact");
+    HistogramInit(&merged);
+
+    HistogramMerge(&merged, &odd);
+    HistogramMerge(&merged, &even);
+    assert_mem_equal(merged.counts, h.counts, sizeof(h.counts), "merged halves should equal the whole");
+    assert_equal((int)merged.totalCount, 100000, "merged count");
+    assert_equal((int)merged.min, 1000, "merged min");
+    assert_equal((int)merged.max, 100000000, "merged max");
+
+    // the extremes of the range must index inside the counts
+    HISTOGRAM_T* wide = &odd;
+    HistogramInit(wide);
+    HistogramRecord(wide, 0);
+    HistogramRecord(wide, UINT64_MAX);
+    assert_less_than(HistogramIndex(UINT64_MAX), HISTOGRAM_COUNTS, "UINT64_MAX out of range");
+    assert_not_equal_u64(HistogramPercentile(wide, 100), 0, "UINT64_MAX should be found again");
+
+    char* text = NULL;
+    size_t size = 0;
+    FILE* f = open_memstream(&text, &size);
+    HistogramWriteJson(f, &h, "test");
+    fclose(f);
+    assert_not_null(strstr(text, "\"count\": 100000"), "JSON should hold the count");
+    assert_not_null(strstr(text, "\"99\": "), "JSON should hold p99");
+    assert_not_null(strstr(text, "\"buckets\": [["), "JSON should hold the buckets");
+    free(text);
+
+}
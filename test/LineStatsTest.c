@@ -0,0 +1,65 @@
+// Per worker line statistics: recording by stage, merging the workers and the report
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "Eeyore.h"
+#include "linestats.h"
+
+#define LINE_STATS_TEST_WORKERS     3
+#define LINE_STATS_TEST_LINES       100
+
+TEST(test_line_stats_merge_and_report){
+
+    test_setup();
+
+    static LINE_STATS_T workers[LINE_STATS_TEST_WORKERS], total, previous;
+    LineStatsInit(workers, LINE_STATS_TEST_WORKERS);
+
+    // worker w takes w * 100 + 1 .. w * 100 + 100 ns to decode a line, ten times that to reverse it,
+    // encoding is always 50 ns and a line totals the three
+    for(int w = 0; w < LINE_STATS_TEST_WORKERS; w++){
+        for(int i = 1; i <= LINE_STATS_TEST_LINES; i++){
+            uint64_t decode = w * 100 + i;
+            LineStatsRecord(workers + w, LINE_STAGE_DECODE, decode);
+            LineStatsRecord(workers + w, LINE_STAGE_REVERSE, decode * 10);
+            LineStatsRecord(workers + w, LINE_STAGE_ENCODE, 50);
+            LineStatsRecord(workers + w, LINE_STAGE_TOTAL, decode * 11 + 50);
+            LineStatsLine(workers + w, 10, 20);
+        }
+    }
+
+    LineStatsMerge(&total, workers, LINE_STATS_TEST_WORKERS);
+    assert_equal((int)total.lines, 300, "merged lines");
+    assert_equal((int)total.bytesIn, 3000, "merged bytes in");
+    assert_equal((int)total.bytesOut, 6000, "merged bytes out");
+    for(int st = 0; st < LINE_STAGE_COUNT; st++){
+        assert_equal((int)total.stage[st].totalCount, 300, "merged stage count");
+    }
+
+    // decode covers 1 .. 300 ns across the workers
+    assert_equal((int)total.stage[LINE_STAGE_DECODE].min, 1, "decode min");
+    assert_equal((int)total.stage[LINE_STAGE_DECODE].max, 300, "decode max");
+    uint64_t p50 = HistogramPercentile(&total.stage[LINE_STAGE_DECODE], 50);
+    uint64_t p99 = HistogramPercentile(&total.stage[LINE_STAGE_DECODE], 99);
+    assert_equal(p50 >= 148 && p50 <= 152, true, "decode p50 of 1..300");
+    assert_equal(p99 >= 293 && p99 <= 301, true, "decode p99 of 1..300");
+    assert_equal((int)HistogramPercentile(&total.stage[LINE_STAGE_ENCODE], 99), 50, "encode is constant");
+    assert_equal((int)total.stage[LINE_STAGE_REVERSE].max, 3000, "reverse max");
+
+    // merging again starts from empty
+    LineStatsMerge(&total, workers, LINE_STATS_TEST_WORKERS);
+    assert_equal((int)total.lines, 300, "a second merge does not add up");
+
+    // an interval report is the difference from the previous merge
+    LineStatsMerge(&previous, workers, 1);
+    char* text = NULL;
+    size_t size = 0;
+    FILE* f = open_memstream(&text, &size);
+    LineStatsReport(f, "interval", &total, &previous, 2000000000ull);
+    fclose(f);
+    assert_not_null(strstr(text, "stats interval: 2.000 s, 200 lines (100 lines/s)"), "interval rates");
+    assert_not_null(strstr(text, "  encode           50         50         50         50"), "encode percentiles");
+    assert_not_null(strstr(text, "  decode   "), "decode line");
+    free(text);
+}
@@ -0,0 +1,200 @@
+// Asynchronous logging through the MPSC ring and its flusher
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Eeyore.h"
+#include "Logger.h"
+
+#define ASYNC_PRODUCERS     4
+#define ASYNC_MESSAGES      500
+
+// entries seen by the capture appender, only ever called by one thread at a time
+static int captured = 0;
+static int captured_warnings = 0;
+static int captured_last[ASYNC_PRODUCERS];
+static bool captured_in_order = true;
+static pthread_t captured_thread;
+static size_t captured_longest = 0;
+static volatile bool appender_hold = false;
+
+static void log_appender_capture(const char* entry, LOG_LEVEL level){
+
+    while(appender_hold){
+        sched_yield();
+    }
+    captured_thread = pthread_self();
+
+    int producer, n;
+    if(sscanf(entry, "producer %d message %d", &producer, &n) == 2 && producer >= 0 && producer < ASYNC_PRODUCERS){
+        if(n != captured_last[producer] + 1) captured_in_order = false;
+        captured_last[producer] = n;
+    }
+    if(level == LOG_LEVEL_WARNING && strstr(entry, "messages dropped") != NULL){
+        captured_warnings++;
+    }
+    if(strlen(entry) > captured_longest){
+        captured_longest = strlen(entry);
+    }
+    captured++;
+}
+
+static void capture_reset(void){
+    captured = 0;
+    captured_warnings = 0;
+    captured_in_order = true;
+    captured_longest = 0;
+    for(int i = 0; i < ASYNC_PRODUCERS; i++){
+        captured_last[i] = -1;
+    }
+}
+
+static void* async_producer(void* arg){
+    int producer = (int)(long)arg;
+    for(int i = 0; i < ASYNC_MESSAGES; i++){
+        LogMessage(LOG_LEVEL_INFO, "producer %d message %d", producer, i);
+    }
+    return NULL;
+}
+
+TEST(test_log_async_ordered_delivery){
+
+    test_setup();
+
+    LogSetConfig(LOG_LEVEL_INFO, "%(message)s");
+    LogAddAppender(log_appender_capture, true);
+    capture_reset();
+
+    // a small ring makes the producers wait for the flusher
+    assert_equal(LogAsyncStart(16, LOG_ASYNC_BLOCK, false), true, "LogAsyncStart failed");
+    assert_equal(LogAsyncStart(16, LOG_ASYNC_BLOCK, false), false, "async mode is already on");
+
+    pthread_t producers[ASYNC_PRODUCERS];
+    for(long i = 0; i < ASYNC_PRODUCERS; i++){
+        pthread_create(&producers[i], NULL, async_producer, (void*)i);
+    }
+    for(int i = 0; i < ASYNC_PRODUCERS; i++){
+        pthread_join(producers[i], NULL);
+    }
+    LogFlush();
+
+    assert_equal(captured, ASYNC_PRODUCERS * ASYNC_MESSAGES, "every message should be delivered by LogFlush");
+    assert_equal(captured_in_order, true, "messages of one producer should keep their order");
+    assert_equal(pthread_equal(captured_thread, pthread_self()), 0, "the flusher should call the appenders");
+    assert_equal((int)LogAsyncDropped(), 0, "nothing is dropped when blocking");
+
+    // cut to the cell size
+    char longMessage[LOG_ASYNC_ENTRY_SIZE * 2];
+    memset(longMessage, 'x', sizeof(longMessage) - 1);
+    longMessage[sizeof(longMessage) - 1] = 0;
+    LogMessage(LOG_LEVEL_INFO, "%s", longMessage);
+
+    LogAsyncStop();
+    assert_equal((int)captured_longest, LOG_ASYNC_ENTRY_SIZE - 1, "long entries should be cut");
+
+    // synchronous again
+    LogMessage(LOG_LEVEL_INFO, "after stop");
+    assert_equal(pthread_equal(captured_thread, pthread_self()) != 0, true, "LogAsyncStop should go back to synchronous");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+// a dump keeps to whole lines within the ring's entry size instead of being cut mid line
+TEST(test_log_async_hex_dump){
+
+    test_setup();
+
+    uint8_t data[LOG_HEX_DEFAULT_MAX_BYTES];
+    for(int i = 0; i < (int)sizeof(data); i++){
+        data[i] = (uint8_t)i;
+    }
+
+    test_log_capture(LOG_LEVEL_INFO, "[%(levelname)s] %(funcName)s: %(message)s");
+    assert_equal(LogAsyncStart(16, LOG_ASYNC_BLOCK, false), true, "LogAsyncStart failed");
+    LogHex(LOG_LEVEL_INFO, "packet", data, sizeof(data));
+    LogAsyncStop();
+
+    assert_less_than((int)strlen(test_log_last_entry), LOG_ASYNC_ENTRY_SIZE, "dump within the entry");
+    assert_not_null(strstr(test_log_last_entry, "[INFO] test_log_async_hex_dump: packet 512 bytes\n0000  00 01 02"), "dump head");
+    char* cut = strstr(test_log_last_entry, "|\n... ");
+    assert_not_null(cut, "the dump ends with a whole line and the cut line");
+    if(cut != NULL){
+        int left = 0;
+        assert_equal(sscanf(cut, "|\n... %d more bytes", &left), 1, "cut line");
+        assert_equal(left % LOG_HEX_DEFAULT_WIDTH, 0, "whole lines left out");
+        assert_greater_than(left, 0, "bytes left out");
+    }
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_async_drop_count){
+
+    test_setup();
+
+    LogSetConfig(LOG_LEVEL_INFO, "%(message)s");
+    LogAddAppender(log_appender_capture, true);
+    capture_reset();
+
+    // hold the flusher in the appender so the ring fills
+    appender_hold = true;
+    assert_equal(LogAsyncStart(8, LOG_ASYNC_DROP_COUNT, false), true, "LogAsyncStart failed");
+    for(int i = 0; i < 100; i++){
+        LogMessage(LOG_LEVEL_INFO, "producer 0 message %d", i);
+    }
+    appender_hold = false;
+    LogFlush();
+
+    int dropped = (int)LogAsyncDropped();
+    assert_greater_than(dropped, 0, "a full ring should drop");
+    LogAsyncStop();
+    assert_equal(captured - captured_warnings + dropped, 100, "every message is delivered or counted");
+    assert_equal(captured_warnings, 1, "one warning should report the drops");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+static FILE* crash_file = NULL;
+
+static void log_appender_crash_file(const char* entry, LOG_LEVEL level){
+    fprintf(crash_file, "%s\n", entry);
+}
+
+TEST(test_log_async_flush_on_crash){
+
+    test_setup();
+
+    char path[] = "/tmp/log_async_crash_XXXXXX";
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+
+    pid_t child = fork();
+    if(child == 0){
+        crash_file = fdopen(fd, "w");
+        LogSetConfig(LOG_LEVEL_INFO, "%(message)s");
+        LogAddAppender(log_appender_crash_file, true);
+        LogAsyncStart(0, LOG_ASYNC_BLOCK, true);
+        LogMessage(LOG_LEVEL_INFO, "last words");
+        abort();
+    }
+    close(fd);
+
+    int status;
+    waitpid(child, &status, 0);
+    assert_equal(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT, true, "the child should still die of SIGABRT");
+
+    char text[64] = "";
+    FILE* f = fopen(path, "r");
+    assert_not_null(f, "crash log missing");
+    if(f != NULL){
+        size_t n = fread(text, 1, sizeof(text) - 1, f);
+        text[n] = 0;
+        fclose(f);
+    }
+    unlink(path);
+    assert_str_equal(text, "last words\n", "the crash handler should drain the ring");
+}
@@ -0,0 +1,326 @@
+/**
+ * @file   LogBench.c
+ * @brief   Cost of a LogMessage() call per sink, leader format and thread count
+ *
+ *  disabled   the level is below the threshold, so only the check in the LogMessage() macro runs
+ *  null       formatted in full and handed to an appender that drops it
+ *  stderr     LogAppenderStderr. Measures whatever stderr is: redirect it, e.g. 2>/dev/null or to a file
+ *  file       an appender writing each entry to a file with stdio
+ *  buffered   LogAppenderFile(), writing the file in batches from its writer thread
+ *  recorder   LogAppenderRecorder(), copying into a memory mapped ring file
+ *  syslog     LogAppenderSyslog. Only run when --sink names it, to keep the system log clean
+ *
+ * --async runs every sink through LogAsyncStart() instead: the numbers are then the cost to the logging thread,
+ * and the flusher's appender time only shows when the ring fills and the block policy makes producers wait.
+ *
+ * Every thread logs --ops messages. Calls are timed in groups of LOG_GROUP, so the percentiles are of the
+ * group average per message. ns/msg is the mean time one thread spends per message and msgs/s the
+ * throughput of all threads together.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "Logger.h"
+#include "Bench.h"
+#include "Histogram.h"
+
+#define MAX_COUNTS      32
+#define LOG_GROUP       16
+
+typedef struct {
+    const char *name;
+    void (*appender)(const char *entry, LOG_LEVEL level);
+    bool disabled;                  /* log below the threshold */
+    bool optIn;                     /* run only when the sink filter is given and matches */
+} SINK_T;
+
+typedef struct {
+    const char *name;
+    const char *config;             /* LogSetConfig() format */
+} FORMAT_T;
+
+typedef struct {
+    const SINK_T *sink;
+    const FORMAT_T *format;
+    int threads;
+    long ops;                       /* all threads together */
+    uint64_t elapsedNs;             /* first thread started to last thread done */
+    uint64_t busyNs;                /* summed over the threads */
+    HISTOGRAM_T *latency;           /* ns per message */
+} RUN_RESULT_T;
+
+typedef struct {
+    pthread_barrier_t *start;
+    LOG_LEVEL level;
+    long ops;
+    uint64_t startNs;
+    uint64_t endNs;
+    HISTOGRAM_T latency;
+} WORKER_T;
+
+static FILE *benchFile = NULL;
+static bool asyncMode = false;
+static LOG_ASYNC_POLICY asyncPolicy = LOG_ASYNC_BLOCK;
+
+static void log_appender_null(const char *entry, LOG_LEVEL level)
+{
+    bench_do_not_optimize(entry);
+}
+
+static void log_appender_bench_file(const char *entry, LOG_LEVEL level)
+{
+    fprintf(benchFile, "%s\n", entry);
+}
+
+static const SINK_T sinks[] = {
+    { "disabled", log_appender_null,       true,  false },
+    { "null",     log_appender_null,       false, false },
+    { "stderr",   LogAppenderStderr,       false, false },
+    { "file",     log_appender_bench_file, false, false },
+    { "buffered", LogAppenderFile,         false, false },
+    { "recorder", LogAppenderRecorder,     false, false },
+    { "syslog",   LogAppenderSyslog,       false, true  },
+    { NULL, NULL, false, false }
+};
+
+static const FORMAT_T formats[] = {
+    { "message", "%(message)s" },
+    { "level",   "[%(levelname)s] %(message)s" },
+    { "default", "%(asctime)s [%(levelname)s] (%(thread)s) [%(funcName)s]: %(message)s" },
+    { "full",    "%(asctime)s [%(levelname)s] (%(thread)s) %(filename)s [%(funcName)s]: %(message)s" },
+    { NULL, NULL }
+};
+
+static void *log_worker(void *arg)
+{
+    WORKER_T *w = arg;
+
+    pthread_barrier_wait(w->start);
+    w->startNs = bench_now_ns();
+    for (long i = 0; i < w->ops; i += LOG_GROUP) {
+        uint64_t t0 = bench_now_ns();
+        for (int g = 0; g < LOG_GROUP; g++)
+            LogMessage(w->level, "bench message %ld of %s: %.2f", i + g, "log_worker", 3.14159);
+        HistogramRecord(&w->latency, (bench_now_ns() - t0) / LOG_GROUP);
+    }
+    w->endNs = bench_now_ns();
+    return NULL;
+}
+
+static void run(const SINK_T *sink, const FORMAT_T *format, int threads, long ops, RUN_RESULT_T *r)
+{
+    LogSetConfig(LOG_LEVEL_INFO, format->config);
+    LogAddAppender(sink->appender, true);
+    if (asyncMode && !LogAsyncStart(0, asyncPolicy, false)) {
+        fprintf(stderr, "could not start async logging\n");
+        exit(1);
+    }
+
+    WORKER_T *workers = calloc(threads, sizeof(WORKER_T));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    r->latency = malloc(sizeof(HISTOGRAM_T));
+    if (workers == NULL || ids == NULL || r->latency == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, threads);
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].start = &start;
+        /* a disabled run logs at DEBUG under the INFO threshold */
+        workers[i].level = sink->disabled ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO;
+        workers[i].ops = (ops + LOG_GROUP - 1) / LOG_GROUP * LOG_GROUP;
+        HistogramInit(&workers[i].latency);
+        if (pthread_create(&ids[i], NULL, log_worker, &workers[i]) != 0) {
+            fprintf(stderr, "could not start %d threads\n", threads);
+            exit(1);
+        }
+    }
+
+    uint64_t first = UINT64_MAX, last = 0;
+    HistogramInit(r->latency);
+    r->busyNs = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+        if (workers[i].startNs < first)
+            first = workers[i].startNs;
+        if (workers[i].endNs > last)
+            last = workers[i].endNs;
+        r->busyNs += workers[i].endNs - workers[i].startNs;
+        HistogramMerge(r->latency, &workers[i].latency);
+    }
+    pthread_barrier_destroy(&start);
+    if (asyncMode)
+        LogAsyncStop();
+    LogFileFlush();
+
+    r->sink = sink;
+    r->format = format;
+    r->threads = threads;
+    r->ops = workers[0].ops * threads;
+    r->elapsedNs = last > first ? last - first : 0;
+
+    free(workers);
+    free(ids);
+}
+
+static void print_result(const RUN_RESULT_T *r)
+{
+    printf("%-9s %-8s %7d %12.0f %10.1f %9llu %9llu %9llu %10llu\n", r->sink->name, r->format->name, r->threads,
+           r->elapsedNs ? r->ops * 1e9 / r->elapsedNs : 0, r->ops ? (double)r->busyNs / r->ops : 0,
+           (unsigned long long)HistogramPercentile(r->latency, 50),
+           (unsigned long long)HistogramPercentile(r->latency, 99),
+           (unsigned long long)HistogramPercentile(r->latency, 99.9), (unsigned long long)r->latency->max);
+}
+
+static bool write_json(const char *path, const RUN_RESULT_T *results, int count, long ops)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"benchmark\": \"logger\",\n  \"mode\": \"%s\",\n  \"ops_per_thread\": %ld,\n  \"results\": [\n",
+            !asyncMode ? "sync" : asyncPolicy == LOG_ASYNC_BLOCK ? "async block" : "async drop", ops);
+    for (int i = 0; i < count; i++) {
+        const RUN_RESULT_T *r = results + i;
+        fprintf(f, "    {\"sink\": \"%s\", \"format\": \"%s\", \"threads\": %d, \"msgs_per_s\": %.1f, "
+                "\"ns_per_msg\": %.2f, \"latency_ns\": ", r->sink->name, r->format->name, r->threads,
+                r->elapsedNs ? r->ops * 1e9 / r->elapsedNs : 0, r->ops ? (double)r->busyNs / r->ops : 0);
+        HistogramWriteJson(f, r->latency, "per message");
+        fprintf(f, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static int parse_counts(char *list, int *counts)
+{
+    int n = 0;
+    for (char *tok = strtok(list, ","); tok != NULL && n < MAX_COUNTS; tok = strtok(NULL, ","))
+        counts[n++] = atoi(tok);
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --threads=N,N,...   thread counts to run, default 1,2,4,8\n"
+            "  --ops=N             messages per thread, default 20000\n"
+            "  --sink=glob         disabled, null, stderr, file, buffered, recorder, syslog. syslog only runs when named\n"
+            "  --format=glob       message, level, default, full\n"
+            "  --async[=drop]      log through the async ring, blocking when it is full or dropping\n"
+            "  --coarse-clock      take %%(asctime)s from the coarse clock\n"
+            "  --file=PATH         log file of the file, buffered and recorder sinks, removed afterwards (default log_bench.log)\n"
+            "  --json=PATH         JSON output (default log_bench.json)\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int counts[MAX_COUNTS] = { 1, 2, 4, 8 };
+    int countCount = 4;
+    long ops = 20000;
+    const char *sinkFilter = NULL;
+    const char *formatFilter = NULL;
+    const char *filePath = "log_bench.log";
+    const char *jsonPath = "log_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        char *a = argv[i];
+        if (strncmp(a, "--threads=", 10) == 0) countCount = parse_counts(a + 10, counts);
+        else if (strncmp(a, "--ops=", 6) == 0) ops = atol(a + 6);
+        else if (strncmp(a, "--sink=", 7) == 0) sinkFilter = a + 7;
+        else if (strncmp(a, "--format=", 9) == 0) formatFilter = a + 9;
+        else if (strcmp(a, "--async") == 0 || strcmp(a, "--async=block") == 0) asyncMode = true;
+        else if (strcmp(a, "--async=drop") == 0) {
+            asyncMode = true;
+            asyncPolicy = LOG_ASYNC_DROP;
+        }
+        else if (strcmp(a, "--coarse-clock") == 0) LogSetCoarseClock(true);
+        else if (strncmp(a, "--file=", 7) == 0) filePath = a + 7;
+        else if (strncmp(a, "--json=", 7) == 0) jsonPath = a + 7;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (ops < 1) {
+        fprintf(stderr, "invalid message count\n");
+        return 1;
+    }
+
+    benchFile = fopen(filePath, "w");
+    if (benchFile == NULL) {
+        perror(filePath);
+        return 1;
+    }
+    char bufferedPath[4096], recorderPath[4096];
+    snprintf(bufferedPath, sizeof(bufferedPath), "%s.buffered", filePath);
+    snprintf(recorderPath, sizeof(recorderPath), "%s.recorder", filePath);
+    LOG_FILE_CONFIG fileConfig = { .path = bufferedPath };
+    if (!LogFileOpen(&fileConfig)) {
+        perror(bufferedPath);
+        return 1;
+    }
+    if (!LogRecorderOpen(recorderPath, 0, 0)) {
+        perror(recorderPath);
+        return 1;
+    }
+    if (isatty(STDERR_FILENO))
+        printf("note: stderr is a terminal, the stderr sink measures the terminal. Redirect it with 2>...\n");
+
+    int runCount = 0;
+    for (const SINK_T *s = sinks; s->name != NULL; s++)
+        runCount++;
+    RUN_RESULT_T *results = calloc((size_t)runCount * (sizeof(formats) / sizeof(formats[0])) * countCount,
+                                   sizeof(RUN_RESULT_T));
+    if (results == NULL)
+        return 1;
+    int count = 0;
+
+    printf("%-9s %-8s %7s %12s %10s %9s %9s %9s %10s\n", "sink", "format", "threads", "msgs/s", "ns/msg",
+           "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    for (const SINK_T *s = sinks; s->name != NULL; s++) {
+        if (sinkFilter != NULL ? fnmatch(sinkFilter, s->name, 0) != 0 : s->optIn)
+            continue;
+        for (const FORMAT_T *f = formats; f->name != NULL; f++) {
+            if (formatFilter != NULL && fnmatch(formatFilter, f->name, 0) != 0)
+                continue;
+            for (int c = 0; c < countCount; c++) {
+                if (counts[c] < 1)
+                    continue;
+                RUN_RESULT_T *r = results + count++;
+                run(s, f, counts[c], ops, r);
+                print_result(r);
+                fflush(stdout);
+            }
+        }
+    }
+
+    fclose(benchFile);
+    remove(filePath);
+    LogFileClose();
+    remove(bufferedPath);
+    LogRecorderClose();
+    remove(recorderPath);
+
+    bool written = write_json(jsonPath, results, count, ops);
+    if (written)
+        printf("results written to %s\n", jsonPath);
+    for (int i = 0; i < count; i++)
+        free(results[i].latency);
+    free(results);
+    return written ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// LogBinary() records and their decoding
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Eeyore.h"
+#include "Logger.h"
+#include "LogBinary.h"
+
+#define BINARY_THREADS      4
+#define BINARY_MESSAGES     1000
+
+// decode path into a string, NULL if it does not decode
+static char* decode_file(const char* path, long* entries){
+    char* text = NULL;
+    size_t size = 0;
+    FILE* in = fopen(path, "rb");
+    if(in == NULL) return NULL;
+    FILE* out = open_memstream(&text, &size);
+    *entries = LogBinaryDecode(in, out);
+    fclose(out);
+    fclose(in);
+    return text;
+}
+
+static void log_binary_calls(int i){
+    unsigned short port = 8080;
+    const char* peer = "10.0.0.1";
+    LogBinary(LOG_LEVEL_INFO, "no arguments at all");
+    LogBinary(LOG_LEVEL_WARNING, "call %d from %s:%hu took %.3f ms (%5.1f%%)", i, peer, port, 1.5, 12.25);
+    LogBinary(LOG_LEVEL_ERROR, "%c%c %lu %llx %ld %s", 'o', 'k', 42ul, 0xbeefull, -7l, (char*)NULL);
+    LogBinary(LOG_LEVEL_INFO, "%d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8);
+    LogBinary(LOG_LEVEL_INFO, "[%.*s] [%*d] [%-*u] [%.*f]", 3, peer, 6, 42, 4, 7u, -1, 2.5);
+}
+
+static const char* expected_calls =
+    "INFO log_binary_calls: no arguments at all\n"
+    "WARNING log_binary_calls: call 3 from 10.0.0.1:8080 took 1.500 ms ( 12.2%)\n"
+    "ERROR log_binary_calls: ok 42 beef -7 (null)\n"
+    "INFO log_binary_calls: 1 2 3 4 5 6 7 8\n"
+    "INFO log_binary_calls: [10.] [    42] [7   ] [2.500000]\n";
+
+TEST(test_log_binary_decode){
+
+    test_setup();
+
+    char path[] = "/tmp/log_binary_XXXXXX";
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+    close(fd);
+
+    LogSetConfig(LOG_LEVEL_INFO, "%(levelname)s %(funcName)s: %(message)s");
+    assert_equal(LogBinaryOpen(path), true, "LogBinaryOpen failed");
+    assert_equal(LogBinaryOpen(path), false, "a log is already open");
+    log_binary_calls(3);
+    LogBinary(LOG_LEVEL_DEBUG, "below the threshold %d", 1);
+    LogBinaryClose();
+
+    long entries = 0;
+    char* text = decode_file(path, &entries);
+    assert_not_null(text, "decode failed");
+    assert_equal((int)entries, 5, "entries decoded");
+    assert_str_equal(text, expected_calls, "decoded text");
+    free(text);
+
+    // the sites were registered in the first log; a new log must carry them again
+    assert_equal(LogBinaryOpen(path), true, "reopen failed");
+    log_binary_calls(3);
+    LogBinaryClose();
+    text = decode_file(path, &entries);
+    assert_equal((int)entries, 5, "entries decoded from the second log");
+    assert_str_equal(text, expected_calls, "decoded text of the second log");
+    free(text);
+
+    // cut short
+    FILE* f = fopen(path, "r+b");
+    fseek(f, -3, SEEK_END);
+    assert_equal(ftruncate(fileno(f), ftell(f)), 0, "truncate failed");
+    fclose(f);
+    text = decode_file(path, &entries);
+    assert_equal((int)entries, -1, "a truncated log should not decode");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+// a string length past what the writer could have written is a corrupt log, not a read past the buffer
+TEST(test_log_binary_string_length){
+
+    test_setup();
+
+    char path[] = "/tmp/log_binary_XXXXXX";
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+    close(fd);
+
+    LogSetConfig(LOG_LEVEL_INFO, "%(message)s");
+    assert_equal(LogBinaryOpen(path), true, "LogBinaryOpen failed");
+    LogBinary(LOG_LEVEL_INFO, "peer %s", "overlong");
+    LogBinaryClose();
+
+    // the u16 in front of the string's characters
+    char log[512];
+    FILE* f = fopen(path, "r+b");
+    size_t size = fread(log, 1, sizeof(log), f);
+    char* at = memmem(log, size, "overlong", 8);
+    assert_not_null(at, "string not in the log");
+    uint16_t length = LOG_BINARY_STRING_MAX + 1;
+    fseek(f, at - log - (long)sizeof(length), SEEK_SET);
+    fwrite(&length, sizeof(length), 1, f);
+    fclose(f);
+
+    long entries = 0;
+    char* text = decode_file(path, &entries);
+    assert_equal((int)entries, -1, "an overlong string should not decode");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_binary_fallback){
+
+    test_setup();
+
+    // without a log, the message is formatted and logged as text
+    test_log_capture(LOG_LEVEL_INFO, "%(funcName)s: %(message)s");
+    LogBinary(LOG_LEVEL_INFO, "%s has %u items at %p", "queue", 3u, (void*)0x10);
+    char expected[128];
+    snprintf(expected, sizeof(expected), "test_log_binary_fallback: queue has 3 items at %p", (void*)0x10);
+    assert_str_equal(test_log_last_entry, expected, "fallback entry");
+
+    // a '*' takes its value from the arguments, as LogMessage() does
+    LogBinary(LOG_LEVEL_INFO, "[%.*s] [%*d] %s", 3, "abcdef", 6, 42, "end");
+    assert_str_equal(test_log_last_entry, "test_log_binary_fallback: [abc] [    42] end", "'*' width and precision");
+    LogBinary(LOG_LEVEL_INFO, "[%*d] [%s]", "six", 42, "end");
+    assert_str_equal(test_log_last_entry, "test_log_binary_fallback: [%*d] [six]", "'*' with no integer for it");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+static void* binary_writer(void* arg){
+    for(int i = 0; i < BINARY_MESSAGES; i++){
+        LogBinary(LOG_LEVEL_INFO, "writer %ld message %d", (long)arg, i);
+    }
+    return NULL;
+}
+
+TEST(test_log_binary_threads){
+
+    test_setup();
+
+    char path[] = "/tmp/log_binary_XXXXXX";
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+    close(fd);
+
+    LogSetConfig(LOG_LEVEL_INFO, "%(asctime)s (%(thread)s) %(message)s");
+    assert_equal(LogBinaryOpen(path), true, "LogBinaryOpen failed");
+    pthread_t writers[BINARY_THREADS];
+    for(long i = 0; i < BINARY_THREADS; i++){
+        pthread_create(&writers[i], NULL, binary_writer, (void*)i);
+    }
+    for(int i = 0; i < BINARY_THREADS; i++){
+        pthread_join(writers[i], NULL);
+    }
+    LogBinaryClose();
+
+    long entries = 0;
+    char* text = decode_file(path, &entries);
+    assert_equal((int)entries, BINARY_THREADS * BINARY_MESSAGES, "every message should decode");
+    assert_not_null(strstr(text, ") writer 3 message 999\n"), "last message of a writer");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file   LogDecode.c
+ * @brief   Turn a LogBinary() log back into text
+ *
+ * Entries are written to stdout through a LogSetConfig() format, by default the logger's own.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Logger.h"
+#include "LogBinary.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options] [FILE]\n"
+            "  --format=FORMAT     LogSetConfig() leader format, e.g. \"%%(asctime)s [%%(levelname)s] %%(message)s\"\n"
+            "reads standard input without FILE\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        char *a = argv[i];
+        if (strncmp(a, "--format=", 9) == 0) LogSetConfig(LOG_LEVEL_DEBUG, a + 9);
+        else if (a[0] != '-' && path == NULL) path = a;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *in = path != NULL ? fopen(path, "rb") : stdin;
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    long entries = LogBinaryDecode(in, stdout);
+    if (in != stdin)
+        fclose(in);
+    if (entries < 0) {
+        fprintf(stderr, "%s: not a binary log, or cut short\n", path != NULL ? path : "stdin");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+// LogAppenderFile() buffering, write out triggers and rotation
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "Eeyore.h"
+#include "Logger.h"
+
+// the whole file as a string, NULL if there is none
+static char* read_file(const char* path){
+    FILE* in = fopen(path, "rb");
+    if(in == NULL) return NULL;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char* text = calloc(1, (size_t)size + 1);
+    size_t got = fread(text, 1, (size_t)size, in);
+    text[got] = 0;
+    fclose(in);
+    return text;
+}
+
+static long file_size(const char* path){
+    struct stat info;
+    return stat(path, &info) == 0 ? (long)info.st_size : -1;
+}
+
+static int count_lines(const char* text){
+    int lines = 0;
+    for(; *text; text++){
+        lines += *text == '\n';
+    }
+    return lines;
+}
+
+static void file_config(LOG_FILE_CONFIG* config, char* path){
+    memset(config, 0, sizeof(*config));
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+    close(fd);
+    config->path = path;
+    config->flushMsec = 60000;
+    LogSetConfig(LOG_LEVEL_INFO, "%(levelname)s %(message)s");
+    LogAddAppender(LogAppenderFile, true);
+}
+
+TEST(test_log_file_flush){
+
+    test_setup();
+
+    char path[] = "/tmp/log_file_XXXXXX";
+    LOG_FILE_CONFIG config;
+    file_config(&config, path);
+    assert_equal(LogFileOpen(&config), true, "LogFileOpen failed");
+    assert_equal(LogFileOpen(&config), false, "a file is already open");
+
+    for(int i = 0; i < 100; i++){
+        LogMessage(LOG_LEVEL_INFO, "entry %d", i);
+    }
+    assert_equal((int)file_size(path), 0, "entries should wait in the buffer");
+
+    LogFileFlush();
+    char* text = read_file(path);
+    assert_not_null(text, "no file");
+    assert_equal(count_lines(text), 100, "every entry after the flush");
+    assert_mem_equal(text, "INFO entry 0\nINFO entry 1\n", 26, "first entries");
+    assert_not_null(strstr(text, "\nINFO entry 99\n"), "last entry");
+    free(text);
+
+    // closing writes the rest; the appender then drops entries
+    LogMessage(LOG_LEVEL_INFO, "entry 100");
+    LogFileClose();
+    LogMessage(LOG_LEVEL_INFO, "after close");
+    text = read_file(path);
+    assert_equal(count_lines(text), 101, "entries after close");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_file_triggers){
+
+    test_setup();
+
+    char path[] = "/tmp/log_file_XXXXXX";
+    LOG_FILE_CONFIG config;
+    file_config(&config, path);
+    config.flushMsec = 50;
+    config.sync = LOG_FILE_SYNC_ERRORS;
+    config.colour = true;
+    assert_equal(LogFileOpen(&config), true, "LogFileOpen failed");
+
+    // the interval writes out a quiet buffer
+    LogMessage(LOG_LEVEL_INFO, "quiet");
+    usleep(300000);
+    char* text = read_file(path);
+    assert_str_equal(text, KNRM "INFO quiet" KNRM "\n", "written after the interval");
+    free(text);
+
+    // an error goes out at once, with what was buffered before it
+    config.flushMsec = 60000;
+    LogFileClose();
+    assert_equal(LogFileOpen(&config), true, "reopen failed");
+    LogMessage(LOG_LEVEL_WARNING, "warned");
+    LogMessage(LOG_LEVEL_ERROR, "failed");
+    for(int i = 0; i < 100 && file_size(path) < 60; i++){
+        usleep(10000);
+    }
+    text = read_file(path);
+    assert_str_equal(text, KNRM "INFO quiet" KNRM "\n" KYEL "WARNING warned" KNRM "\n" KRED "ERROR failed" KNRM "\n",
+                     "written on the error");
+    free(text);
+    LogFileClose();
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_file_rotation){
+
+    test_setup();
+
+    char path[] = "/tmp/log_file_XXXXXX";
+    char rotated[sizeof(path) + 4];
+    LOG_FILE_CONFIG config;
+    file_config(&config, path);
+    config.bufferSize = 1;          // the smallest chunks
+    config.maxBytes = 16 * 1024;
+    config.maxFiles = 2;
+    assert_equal(LogFileOpen(&config), true, "LogFileOpen failed");
+
+    // ~200 KB: rotates at every write out once the file holds a few chunks
+    for(int i = 0; i < 2000; i++){
+        LogMessage(LOG_LEVEL_INFO, "rotating entry %04d %080d", i, 0);
+    }
+    LogFileClose();
+
+    char* text = read_file(path);
+    assert_not_null(text, "current file");
+    assert_not_null(strstr(text, "rotating entry 1999 "), "the last entry is in the current file");
+    assert_equal(file_size(path) <= 16 * 1024 * 2, true, "current file size");
+    free(text);
+    for(int i = 1; i <= 3; i++){
+        snprintf(rotated, sizeof(rotated), "%s.%d", path, i);
+        assert_equal(file_size(rotated) > 0, i <= 2, "rotated files kept");
+        unlink(rotated);
+    }
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,85 @@
+// LogKV() structured entries in logfmt and JSON
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "Eeyore.h"
+#include "Logger.h"
+#include "LogKV.h"
+
+TEST(test_log_kv_logfmt){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "[%(levelname)s] %(message)s");
+    LogKV(LOG_LEVEL_INFO, "thread_start", KV_INT("thread", 3), KV_STR("name", "pool worker"), KV_BOOL("pooled", true));
+    assert_str_equal(test_log_last_entry, "[INFO] event=thread_start thread=3 name=\"pool worker\" pooled=true", "logfmt through the leader");
+
+    LogKV(LOG_LEVEL_WARNING, "limits", KV_INT("min", INT64_MIN), KV_UINT("max", UINT64_MAX), KV_INT("zero", 0),
+          KV_INT("small", -7), KV_UINT("hundred", 100));
+    assert_str_equal(test_log_last_entry, "[WARNING] event=limits min=-9223372036854775808 max=18446744073709551615 zero=0 "
+                     "small=-7 hundred=100", "integers");
+
+    // values are quoted only when they have to be
+    LogKV(LOG_LEVEL_INFO, "strings", KV_STR("plain", "a/b:c"), KV_STR("empty", ""), KV_STR("null", NULL),
+          KV_STR("eq", "a=b"), KV_STR("esc", "say \"hi\"\n\\"));
+    assert_str_equal(test_log_last_entry, "[INFO] event=strings plain=a/b:c empty=\"\" null= eq=\"a=b\" esc=\"say \\\"hi\\\"\\n\\\\\"",
+                     "logfmt quoting");
+
+    LogKV(LOG_LEVEL_INFO, "no fields");
+    assert_str_equal(test_log_last_entry, "[INFO] event=\"no fields\"", "an event alone");
+
+    LogKV(LOG_LEVEL_DEBUG, "below the level", KV_INT("n", 1));
+    assert_equal(test_log_entries, 4, "call site level");
+
+    // cut short: whole fields only, and a quoted event closed
+    char buffer[16];
+    LOG_KV fields[] = { KV_INT("a", 1), {0} };
+    assert_equal(LogKVFormat(buffer, 12, "e", fields), 11, "fits exactly");
+    assert_str_equal(buffer, "event=e a=1", "logfmt");
+    LogKVFormat(buffer, 11, "e", fields);
+    assert_str_equal(buffer, "event=e", "field left out");
+    LogKVFormat(buffer, 12, "no fields here", fields);
+    assert_str_equal(buffer, "event=\"no \"", "quote closed");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_kv_json){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "%(message)s");
+    LogKVSetFormat(LOG_KV_JSON);
+    LogKV(LOG_LEVEL_INFO, "thread_start", KV_INT("thread", 3), KV_STR("name", "pool worker"), KV_BOOL("pooled", false));
+    assert_str_equal(test_log_last_entry, "{\"event\":\"thread_start\",\"thread\":3,\"name\":\"pool worker\",\"pooled\":false}", "json");
+
+    LogKV(LOG_LEVEL_INFO, "escapes", KV_STR("s", "tab\tquote\"ctl\x01"), KV_STR("null", NULL));
+    assert_str_equal(test_log_last_entry, "{\"event\":\"escapes\",\"s\":\"tab\\tquote\\\"ctl\\u0001\",\"null\":null}", "json escapes");
+
+    // a field too long for the entry is left out whole
+    char longValue[LOG_BUFFER_MAX_SIZE * 2];
+    memset(longValue, 'v', sizeof(longValue) - 1);
+    longValue[sizeof(longValue) - 1] = 0;
+    LogKV(LOG_LEVEL_INFO, "long", KV_INT("n", 1), KV_STR("v", longValue), KV_INT("after", 2));
+    assert_str_equal(test_log_last_entry, "{\"event\":\"long\",\"n\":1}", "long field dropped");
+
+    char buffer[32];
+    LOG_KV fields[] = { KV_UINT("id", 42), {0} };
+    assert_equal(LogKVFormat(buffer, sizeof(buffer), "e", fields), 21, "LogKVFormat length");
+    assert_str_equal(buffer, "{\"event\":\"e\",\"id\":42}", "LogKVFormat");
+
+    // exactly the size it needs, and one short of it
+    assert_equal(LogKVFormat(buffer, 22, "e", fields), 21, "fits exactly");
+    assert_equal(LogKVFormat(buffer, 21, "e", fields), 13, "one short drops the field");
+    assert_str_equal(buffer, "{\"event\":\"e\"}", "object closed");
+
+    // an event cut short keeps its quote closed, and an escape is not split
+    LogKVFormat(buffer, 20, "0123456789abcdef", fields);
+    assert_str_equal(buffer, "{\"event\":\"0123456\"}", "event cut");
+    LogKVFormat(buffer, 17, "abc\ndef", fields);
+    assert_str_equal(buffer, "{\"event\":\"abc\"}", "escape left out whole");
+
+    LogKVSetFormat(LOG_KV_LOGFMT);
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,109 @@
+// Per module and per file levels through the LogMessage() call sites
+#define LOG_MODULE_NAME     "LevelTest"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "Eeyore.h"
+#include "Logger.h"
+#include "Threads.h"
+
+// how many of a DEBUG, an INFO and a WARNING call log here
+static int level_test_calls(void){
+    int before = test_log_entries;
+    LogMessage(LOG_LEVEL_DEBUG, "debug");
+    LogMessage(LOG_LEVEL_INFO, "info");
+    LogMessage(LOG_LEVEL_WARNING, "warning");
+    return test_log_entries - before;
+}
+
+#undef LOG_MODULE_NAME
+#define LOG_MODULE_NAME     "Other"
+
+static int other_calls(void){
+    int before = test_log_entries;
+    LogMessage(LOG_LEVEL_DEBUG, "debug");
+    LogMessage(LOG_LEVEL_INFO, "info");
+    LogMessage(LOG_LEVEL_WARNING, "warning");
+    return test_log_entries - before;
+}
+
+TEST(test_log_module_level){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "%(message)s");
+    assert_equal(level_test_calls(), 2, "the LogSetConfig() level");
+    assert_equal(other_calls(), 2, "the LogSetConfig() level elsewhere");
+
+    // sites already resolved pick the rules up
+    assert_equal(LogSetModuleLevel("LevelTest", LOG_LEVEL_DEBUG), true, "LogSetModuleLevel failed");
+    assert_equal(level_test_calls(), 3, "debug in the module");
+    assert_equal(other_calls(), 2, "other modules keep the LogSetConfig() level");
+
+    // the newest matching rule wins, and a module can be quieter than the rest
+    LogSetModuleLevel("Level*", LOG_LEVEL_ERROR);
+    assert_equal(level_test_calls(), 0, "module quietened");
+    LogSetModuleLevel("LevelTest", LOG_LEVEL_DEBUG);
+    assert_equal(level_test_calls(), 3, "a rule set again is the newest");
+
+    // the LogSetConfig() level moves the sites without a rule
+    LogSetConfig(LOG_LEVEL_WARNING, "%(message)s");
+    assert_equal(other_calls(), 1, "new LogSetConfig() level");
+    assert_equal(level_test_calls(), 3, "rules outlive LogSetConfig()");
+
+    LogClearLevels();
+    assert_equal(level_test_calls(), 1, "rules cleared");
+
+    for(int i = 0; i < LOG_MAX_LEVEL_RULES; i++){
+        char glob[16];
+        snprintf(glob, sizeof(glob), "module%d", i);
+        assert_equal(LogSetModuleLevel(glob, LOG_LEVEL_DEBUG), true, "rule within the limit");
+    }
+    assert_equal(LogSetModuleLevel("one too many", LOG_LEVEL_DEBUG), false, "rule past the limit");
+    assert_equal(LogSetModuleLevel("module3", LOG_LEVEL_DEBUG), true, "a rule can be set again when full");
+    LogClearLevels();
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_file_level){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_WARNING, "%(message)s");
+    assert_equal(LogSetFileLevel("LogLevel*.c", LOG_LEVEL_DEBUG), true, "LogSetFileLevel failed");
+    assert_equal(level_test_calls(), 3, "every module in the file");
+    assert_equal(other_calls(), 3, "every module in the file");
+
+    LogSetFileLevel("*/Threads.c", LOG_LEVEL_DEBUG);
+    assert_equal(other_calls(), 3, "a glob for another file changes nothing here");
+
+    LogClearLevels();
+    assert_equal(other_calls(), 1, "rules cleared");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+static void* level_worker(void* context){
+    return context;
+}
+
+TEST_WITH_THREAD_POOL(test_log_thread_pool_module_level){
+
+    test_setup();
+
+    // debugging the thread pool alone
+    test_log_capture(LOG_LEVEL_WARNING, "%(message)s");
+    LogSetModuleLevel("Threads", LOG_LEVEL_DEBUG);
+
+    THREAD_T thread;
+    assert_equal(InitThread(&thread, "level", level_worker, NULL), true, "InitThread failed");
+    assert_equal(WaitThreadComplete(&thread, 1000, NULL), true, "WaitThreadComplete failed");
+    LogMessage(LOG_LEVEL_INFO, "not the thread pool");
+    assert_greater_than(test_log_entries, 2, "thread pool debug entries");
+    assert_mem_equal(test_log_last_entry, "Waiting for thread success: level", 33, "last thread pool entry");
+
+    LogClearLevels();
+    test_log_config(LOG_LEVEL_INFO);
+}
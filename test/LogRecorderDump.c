@@ -0,0 +1,23 @@
+/**
+ * @file   LogRecorderDump.c
+ * @brief   Print the entries of a LogAppenderRecorder() file, oldest first
+ *
+ * Works on the file of a running process as well as on one left by a crash.
+ */
+
+#include <stdio.h>
+#include "Logger.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2 || argv[1][0] == '-') {
+        fprintf(stderr, "usage: %s FILE\n", argv[0]);
+        return 1;
+    }
+
+    if (LogRecorderRead(argv[1], stdout) < 0) {
+        fprintf(stderr, "%s: not a recorder file\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
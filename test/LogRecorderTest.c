@@ -0,0 +1,176 @@
+// LogAppenderRecorder() flight recorder: ring order, wrap, carry on, surviving a kill and a corrupt header
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "Eeyore.h"
+#include "Logger.h"
+#include "Threads.h"
+
+#define RECORDER_SLOT       128
+#define RECORDER_SLOTS      16
+#define RECORDER_SIZE       (4096 + RECORDER_SLOTS * RECORDER_SLOT)
+
+// the entries of path, NULL if it is not a recorder file
+static char* read_recorder(const char* path, long* entries){
+    char* text = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&text, &size);
+    *entries = LogRecorderRead(path, out);
+    fclose(out);
+    if(*entries < 0){
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+static void recorder_config(char* path){
+    int fd = mkstemp(path);
+    assert_not_equal(fd, -1, "mkstemp failed");
+    close(fd);
+    LogSetConfig(LOG_LEVEL_INFO, "%(message)s");
+    LogAddAppender(LogAppenderRecorder, true);
+}
+
+TEST(test_log_recorder_ring){
+
+    test_setup();
+
+    char path[] = "/tmp/log_recorder_XXXXXX";
+    recorder_config(path);
+    long entries = 0;
+    assert_null(read_recorder(path, &entries), "an empty file is not a recorder");
+
+    assert_equal(LogRecorderOpen(path, RECORDER_SIZE, RECORDER_SLOT), true, "LogRecorderOpen failed");
+    assert_equal(LogRecorderOpen(path, RECORDER_SIZE, RECORDER_SLOT), false, "a recorder is already open");
+    for(int i = 0; i < 5; i++){
+        LogMessage(LOG_LEVEL_INFO, "entry %d", i);
+    }
+    char* text = read_recorder(path, &entries);
+    assert_equal((int)entries, 5, "entries while open");
+    assert_str_equal(text, "entry 0\nentry 1\nentry 2\nentry 3\nentry 4\n", "entries in order");
+    free(text);
+    LogRecorderClose();
+
+    // reopened with the same sizes, the ring carries on and keeps the last RECORDER_SLOTS entries
+    assert_equal(LogRecorderOpen(path, RECORDER_SIZE, RECORDER_SLOT), true, "reopen failed");
+    for(int i = 5; i < 40; i++){
+        LogMessage(LOG_LEVEL_INFO, "entry %d", i);
+    }
+    char longEntry[RECORDER_SLOT * 2];
+    memset(longEntry, 'z', sizeof(longEntry) - 1);
+    longEntry[sizeof(longEntry) - 1] = 0;
+    LogMessage(LOG_LEVEL_INFO, "%s", longEntry);
+    LogRecorderClose();
+    LogMessage(LOG_LEVEL_INFO, "after close");
+
+    text = read_recorder(path, &entries);
+    assert_equal((int)entries, RECORDER_SLOTS, "a full ring");
+    assert_mem_equal(text, "entry 25\nentry 26\n", 18, "oldest entries kept");
+    char* last = strrchr(text, '\n');
+    *last = 0;
+    last = strrchr(text, '\n') + 1;
+    assert_equal((int)strlen(last), RECORDER_SLOT - 16, "long entry cut to the slot");
+    free(text);
+
+    // other sizes start a new ring
+    assert_equal(LogRecorderOpen(path, RECORDER_SIZE * 2, RECORDER_SLOT), true, "resized open failed");
+    LogRecorderClose();
+    text = read_recorder(path, &entries);
+    assert_equal((int)entries, 0, "a resized ring starts empty");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+// a slot count whose product with the slot size wraps to something small must not pass for a recorder
+TEST(test_log_recorder_corrupt_header){
+
+    test_setup();
+
+    char path[] = "/tmp/log_recorder_XXXXXX";
+    recorder_config(path);
+    assert_equal(LogRecorderOpen(path, RECORDER_SIZE, RECORDER_SLOT), true, "LogRecorderOpen failed");
+    LogMessage(LOG_LEVEL_INFO, "entry");
+    LogRecorderClose();
+
+    // slotCount follows the magic, the slot size and a reserved word
+    uint64_t slotCount = (1ull << 60) + RECORDER_SLOTS;
+    int fd = open(path, O_WRONLY);
+    assert_equal((int)pwrite(fd, &slotCount, sizeof(slotCount), 16), (int)sizeof(slotCount), "pwrite failed");
+    close(fd);
+
+    long entries = 0;
+    assert_null(read_recorder(path, &entries), "a wrapping slot count is not a recorder");
+    assert_equal((int)entries, -1, "read of a corrupt header");
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_recorder_survives_kill){
+
+    test_setup();
+
+    char path[] = "/tmp/log_recorder_XXXXXX";
+    recorder_config(path);
+
+    pid_t child = fork();
+    if(child == 0){
+        LogRecorderOpen(path, RECORDER_SIZE, RECORDER_SLOT);
+        for(int i = 0; i < 10; i++){
+            LogMessage(LOG_LEVEL_INFO, "before the kill %d", i);
+        }
+        raise(SIGKILL);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    assert_equal(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL, true, "child should be killed");
+
+    long entries = 0;
+    char* text = read_recorder(path, &entries);
+    assert_equal((int)entries, 10, "entries of the killed process");
+    assert_not_null(strstr(text, "before the kill 0\n"), "first entry");
+    assert_not_null(strstr(text, "before the kill 9\n"), "last entry");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+static void* recorder_worker(void* context){
+    return context;
+}
+
+TEST_WITH_THREAD_POOL(test_log_recorder_thread_pool_debug){
+
+    test_setup();
+
+    // the thread pool's DEBUG chatter into the recorder, nothing to stderr
+    char path[] = "/tmp/log_recorder_XXXXXX";
+    recorder_config(path);
+    LogSetConfig(LOG_LEVEL_DEBUG, "[%(levelname)s] %(message)s");
+    LogAddAppender(LogAppenderRecorder, true);
+    assert_equal(LogRecorderOpen(path, 0, 0), true, "LogRecorderOpen failed");
+
+    THREAD_T thread;
+    assert_equal(InitThread(&thread, "recorded", recorder_worker, NULL), true, "InitThread failed");
+    assert_equal(WaitThreadComplete(&thread, 1000, NULL), true, "WaitThreadComplete failed");
+    LogRecorderClose();
+
+    long entries = 0;
+    char* text = read_recorder(path, &entries);
+    assert_greater_than((int)entries, 2, "thread pool entries");
+    assert_not_null(strstr(text, "[DEBUG] >> handler running: (recorded)\n"), "handler start recorded");
+    assert_not_null(strstr(text, "[DEBUG] >> handler done: (recorded)\n"), "handler end recorded");
+    free(text);
+
+    unlink(path);
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,123 @@
+// Storm control: the per call site rate limit and folding of repeated messages
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "Eeyore.h"
+#include "Logger.h"
+
+static char summary_entry[LOG_BUFFER_MAX_SIZE];
+
+static void log_appender_summary(const char* entry, LOG_LEVEL level){
+    if(strstr(entry, "suppressed") != NULL || strstr(entry, "repeated") != NULL){
+        strncpy(summary_entry, entry, sizeof(summary_entry) - 1);
+    }
+}
+
+// the captured entries, and the last storm summary beside them
+static void storm_config(void){
+    test_log_capture(LOG_LEVEL_INFO, "%(message)s");
+    LogAddAppender(log_appender_summary, false);
+    summary_entry[0] = 0;
+}
+
+static void storm_call(int i){
+    LogMessage(LOG_LEVEL_WARNING, "storm %d", i);
+}
+
+static void repeat_call(const char* text){
+    LogMessage(LOG_LEVEL_WARNING, "%s", text);
+}
+
+TEST(test_log_rate_limit){
+
+    test_setup();
+
+    storm_config();
+    uint64_t limitedBefore = 0;
+    LogSuppressedCounts(&limitedBefore, NULL);
+
+    // 10 a second in bursts of 5: a storm of 100 lets the burst through
+    LogSetRateLimit(10, 5);
+    for(int i = 0; i < 100; i++){
+        storm_call(i);
+    }
+    assert_equal(test_log_entries, 5, "the burst gets through");
+    assert_str_equal(test_log_last_entry, "storm 4", "the last of the burst");
+
+    uint64_t limited = 0;
+    LogSuppressedCounts(&limited, NULL);
+    assert_equal((int)(limited - limitedBefore), 95, "rate limited count");
+
+    // once the bucket refills the site reports what it dropped first
+    usleep(250 * 1000);
+    storm_call(100);
+    assert_str_equal(summary_entry, "95 messages suppressed by the rate limit", "rate limit summary");
+    assert_str_equal(test_log_last_entry, "storm 100", "let through again");
+    assert_equal(test_log_entries, 7, "summary and message");
+
+    // other sites have buckets of their own
+    repeat_call("another site");
+    assert_str_equal(test_log_last_entry, "another site", "other sites unaffected");
+
+    LogSetRateLimit(0, 0);
+    test_log_entries = 0;
+    for(int i = 0; i < 100; i++){
+        storm_call(i);
+    }
+    assert_equal(test_log_entries, 100, "rate limit off");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_repeat_folding){
+
+    test_setup();
+
+    storm_config();
+    uint64_t foldedBefore = 0;
+    LogSuppressedCounts(NULL, &foldedBefore);
+
+    LogSetRepeatFolding(true);
+    for(int i = 0; i < 10; i++){
+        repeat_call("same again");
+    }
+    assert_equal(test_log_entries, 1, "repeats folded");
+    assert_str_equal(test_log_last_entry, "same again", "first of the repeats");
+
+    uint64_t folded = 0;
+    LogSuppressedCounts(NULL, &folded);
+    assert_equal((int)(folded - foldedBefore), 9, "folded count");
+
+    // a different message reports the repeats before itself
+    repeat_call("something else");
+    assert_equal(test_log_entries, 3, "summary and new message");
+    assert_str_equal(summary_entry, "last message repeated 9 times", "repeat summary");
+    assert_str_equal(test_log_last_entry, "something else", "new message");
+
+    // a format with changing arguments is not a repeat
+    for(int i = 0; i < 3; i++){
+        storm_call(i);
+    }
+    assert_equal(test_log_entries, 6, "different arguments are not repeats");
+
+    // LogReportSuppressed() reports what the sites still hold
+    repeat_call("something else");
+    repeat_call("something else");
+    summary_entry[0] = 0;
+    LogReportSuppressed();
+    assert_str_equal(summary_entry, "last message repeated 2 times", "reported on request");
+    test_log_entries = 0;
+    LogReportSuppressed();
+    assert_equal(test_log_entries, 0, "nothing left to report");
+    repeat_call("something else");
+    assert_equal(test_log_entries, 1, "a reported repeat starts again");
+
+    LogSetRepeatFolding(false);
+    test_log_entries = 0;
+    repeat_call("same again");
+    repeat_call("same again");
+    assert_equal(test_log_entries, 2, "folding off");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
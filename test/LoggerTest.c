@@ -0,0 +1,195 @@
+// LogSetConfig leader formats and the entries LogMessage builds from them
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Eeyore.h"
+#include "Logger.h"
+
+TEST(test_log_leader_format){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "<%(levelname)s> %(filename)s:%(funcName)s - %(message)s!");
+    LogMessage(LOG_LEVEL_WARNING, "value %d of %s", 42, "answers");
+    assert_str_equal(test_log_last_entry, "<WARNING> LoggerTest.c:test_log_leader_format - value 42 of answers!", "leader");
+    assert_equal(test_log_last_level, LOG_LEVEL_WARNING, "level passed to the appender");
+
+    test_log_capture(LOG_LEVEL_INFO, "%(message)s");
+    LogMessage(LOG_LEVEL_INFO, "bare");
+    assert_str_equal(test_log_last_entry, "bare", "message only");
+
+    // a format without %(message)s is reported in every entry
+    test_log_capture(LOG_LEVEL_INFO, "%(levelname)s");
+    LogMessage(LOG_LEVEL_INFO, "lost");
+    assert_str_equal(test_log_last_entry, LOG_INVALID_LEADER_CONFIG_MSG "lost", "invalid config");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_leader_is_not_a_format){
+
+    test_setup();
+
+    // file and function names are copied, never parsed: a % in them must not consume arguments
+    test_log_capture(LOG_LEVEL_INFO, "%(filename)s [%(funcName)s] %(message)s");
+    _LogMessageEx("100%s.c", "%n%s%d", LOG_LEVEL_INFO, "%d%%", 7);
+    assert_str_equal(test_log_last_entry, "100%s.c [%n%s%d] 7%", "leader text is literal");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_entry_truncated){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "%(levelname)s: %(message)s <end>");
+    char* longMessage = malloc(LOG_BUFFER_MAX_SIZE * 2);
+    memset(longMessage, 'y', LOG_BUFFER_MAX_SIZE * 2 - 1);
+    longMessage[LOG_BUFFER_MAX_SIZE * 2 - 1] = 0;
+
+    LogMessage(LOG_LEVEL_INFO, "%s", longMessage);
+    assert_equal((int)strlen(test_log_last_entry), LOG_BUFFER_MAX_SIZE - 1, "entry should fill the buffer");
+    assert_mem_equal(test_log_last_entry, "INFO: yyy", 9, "leader first");
+    free(longMessage);
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+// "YYYY-MM-DD HH:MM:SS:mmm " within a second of now
+static void check_timestamp(const char* entry, const char* msg){
+
+    struct tm info;
+    memset(&info, 0, sizeof(info));
+    int ms = -1, length = 0;
+    int fields = sscanf(entry, "%4d-%2d-%2d %2d:%2d:%2d:%3d%n", &info.tm_year, &info.tm_mon, &info.tm_mday,
+                        &info.tm_hour, &info.tm_min, &info.tm_sec, &ms, &length);
+    assert_equal(fields, 7, msg);
+    assert_equal(length, 23, msg);
+    assert_equal(ms >= 0 && ms <= 999, true, msg);
+
+    info.tm_year -= 1900;
+    info.tm_mon -= 1;
+    info.tm_isdst = -1;
+    long age = (long)(time(NULL) - mktime(&info));
+    assert_equal(age >= -1 && age <= 1, true, msg);
+}
+
+TEST(test_log_timestamp){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_INFO, "%(asctime)s %(message)s");
+    for(int i = 0; i < 3; i++){
+        LogMessage(LOG_LEVEL_INFO, "tick");
+        check_timestamp(test_log_last_entry, "cached timestamp");
+        usleep(400000);
+    }
+
+    LogSetCoarseClock(true);
+    LogMessage(LOG_LEVEL_INFO, "tick");
+    check_timestamp(test_log_last_entry, "coarse clock timestamp");
+    LogSetCoarseClock(false);
+
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+TEST(test_log_hex_dump){
+
+    test_setup();
+
+    test_log_capture(LOG_LEVEL_DEBUG, "%(message)s");
+    uint8_t data[4000];
+    for(int i = 0; i < (int)sizeof(data); i++){
+        data[i] = (uint8_t)(i + 0x3e);
+    }
+
+    // one entry for the whole dump, the last line padded so the text lines up
+    LogHex(LOG_LEVEL_DEBUG, "packet", data, 20);
+    assert_str_equal(test_log_last_entry, "packet 20 bytes\n"
+        "0000  3E 3F 40 41 42 43 44 45 46 47 48 49 4A 4B 4C 4D  |>?@ABCDEFGHIJKLM|\n"
+        "0010  4E 4F 50 51                                      |NOPQ|", "default dump");
+
+    LogSetHexDump(4, 10);
+    LogHex(LOG_LEVEL_DEBUG, NULL, data + 0x41, 12);
+    assert_str_equal(test_log_last_entry, "12 bytes\n"
+        "0000  7F 80 81 82  |....|\n"
+        "0004  83 84 85 86  |....|\n"
+        "0008  87 88        |..|\n"
+        "... 2 more bytes", "narrow dump cut at the byte cap");
+
+    // a large dump stays within one entry
+    LogSetHexDump(LOG_HEX_MAX_WIDTH, 100000);
+    LogHex(LOG_LEVEL_DEBUG, "big", data, 300);
+    int lines = 0;
+    for(char* c = test_log_last_entry; *c; c++){
+        lines += *c == '\n';
+    }
+    assert_equal(lines, 5, "300 bytes in lines of 64");
+    assert_null(strstr(test_log_last_entry, "more bytes"), "nothing cut");
+
+    LogHex(LOG_LEVEL_DEBUG, "huge", data, sizeof(data));
+    assert_not_null(strstr(test_log_last_entry, " more bytes"), "cut to the entry");
+    assert_greater_than((int)strlen(test_log_last_entry), LOG_BUFFER_MAX_SIZE / 2, "most of the entry used");
+
+    LogSetHexDump(0, 0);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+#define SWAP_WRITERS    4
+
+static int swap_running;
+static int swap_entries;
+static int swap_bad_entries;
+
+static void log_appender_swap_check(const char* entry, LOG_LEVEL level){
+    if(strcmp(entry, "A: swap") != 0 && strcmp(entry, "B [INFO] swap") != 0){
+        __atomic_add_fetch(&swap_bad_entries, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&swap_entries, 1, __ATOMIC_RELAXED);
+}
+
+static void* swap_writer(void* context){
+    while(__atomic_load_n(&swap_running, __ATOMIC_RELAXED)){
+        LogMessage(LOG_LEVEL_INFO, "swap");
+    }
+    return context;
+}
+
+TEST(test_log_config_swap_while_logging){
+
+    test_setup();
+
+    // every entry is built from one config or the other, never a config being freed
+    LogSetConfig(LOG_LEVEL_INFO, "A: %(message)s");
+    LogAddAppender(log_appender_swap_check, true);
+    swap_running = 1;
+    swap_entries = 0;
+    swap_bad_entries = 0;
+
+    pthread_t writers[SWAP_WRITERS];
+    for(int i = 0; i < SWAP_WRITERS; i++){
+        pthread_create(&writers[i], NULL, swap_writer, NULL);
+    }
+    for(int i = 0; i < 50; i++){
+        // each swap while the writers are logging
+        int seen = __atomic_load_n(&swap_entries, __ATOMIC_RELAXED);
+        while(__atomic_load_n(&swap_entries, __ATOMIC_RELAXED) == seen){
+            sched_yield();
+        }
+        LogSetConfig(LOG_LEVEL_INFO, i % 2 ? "A: %(message)s" : "B [%(levelname)s] %(message)s");
+        LogAddAppender(log_appender_swap_check, true);
+    }
+    __atomic_store_n(&swap_running, 0, __ATOMIC_RELAXED);
+    for(int i = 0; i < SWAP_WRITERS; i++){
+        pthread_join(writers[i], NULL);
+    }
+
+    assert_greater_than(swap_entries, 0, "entries logged during the swaps");
+    assert_equal(swap_bad_entries, 0, "entries from a torn config");
+
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,47 @@
+// Performance tests, compared with the baselines of this host class in perf_baselines.txt ("make baselines").
+// They run alone after the other tests; a host class with no baseline fails
+#include "Eeyore.h"
+#include "Threads.h"
+
+#define POOL_ROUND_TRIPS    500
+
+// ReverseBits on 64 bytes may run at half its baseline throughput before this fails
+TEST_PERF(test_reverse_throughput){
+
+    test_setup();
+
+    bench_run("reverse_bits_64");
+    assert_bench_throughput_at_least("reverse_bits_64", 64, "reverse_bits_64", 0.5);
+
+}
+
+static void* pool_round_trip_handler(void* context){
+    return context;
+}
+
+// time from InitThread until WaitThreadComplete returns for a thread doing nothing
+TEST_WITH_FLAGS(test_thread_pool_latency, TEST_EXCLUSIVE | TEST_NEEDS_THREAD_POOL){
+
+    test_setup();
+
+    static double samples[POOL_ROUND_TRIPS];
+    int count = 0;
+
+    for(int i = 0; i < POOL_ROUND_TRIPS; i++){
+        THREAD_T thread;
+        void* result = NULL;
+
+        uint64_t start = bench_now_ns();
+        if(!InitThread(&thread, "round trip", pool_round_trip_handler, &count)) break;
+        bool done = WaitThreadComplete(&thread, 1000, &result);
+        uint64_t end = bench_now_ns();
+
+        assert_equal(done, true, "round trip thread did not complete");
+        if(!done) break;
+        samples[count++] = (double)(end - start);
+    }
+
+    assert_equal(count, POOL_ROUND_TRIPS, "not every round trip completed");
+    assert_latency_p99_below(samples, count, "thread_pool_round_trip", 1.0);
+
+}
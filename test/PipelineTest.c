@@ -0,0 +1,185 @@
+// RunLinePipeline(): output identical to running the handler line by line, the batches it holds bounded and
+// input that trickles in answered without waiting for a full batch
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include "Eeyore.h"
+#include "Threads.h"
+#include "pipeline.h"
+
+#define PIPELINE_TEST_LINES     5000
+#define PIPELINE_TEST_LINE_SIZE 64
+
+// counts the lines handed to fgets and written out, to see how many the pipeline holds at once
+typedef struct{
+    const char* text;
+    size_t length;
+    size_t position;
+    long linesRead;
+    long linesWritten;
+    long maxHeld;
+    char* written;
+    size_t writtenLength;
+}PIPELINE_STREAMS_T;
+
+static ssize_t pipeline_test_read(void* cookie, char* buffer, size_t size){
+    PIPELINE_STREAMS_T* s = cookie;
+    if(size > s->length - s->position) size = s->length - s->position;
+    memcpy(buffer, s->text + s->position, size);
+    s->position += size;
+    for(size_t i = 0; i < size; i++){
+        if(buffer[i] == '\n'){
+            long held = __atomic_add_fetch(&s->linesRead, 1, __ATOMIC_SEQ_CST) -
+                        __atomic_load_n(&s->linesWritten, __ATOMIC_SEQ_CST);
+            if(held > s->maxHeld) s->maxHeld = held;
+        }
+    }
+    return size;
+}
+
+static ssize_t pipeline_test_write(void* cookie, const char* buffer, size_t size){
+    PIPELINE_STREAMS_T* s = cookie;
+    memcpy(s->written + s->writtenLength, buffer, size);
+    s->writtenLength += size;
+    long lines = 0;
+    for(size_t i = 0; i < size; i++){
+        lines += buffer[i] == '\n';
+    }
+    __atomic_add_fetch(&s->linesWritten, lines, __ATOMIC_SEQ_CST);
+    return size;
+}
+
+// a line of decimal numbers becomes their sum, with a yield now and then so the batches finish out of order
+static int pipeline_test_handler(char* line, char* out, int outSize, int worker){
+    long sum = 0;
+    for(char* at = line; *at != '\0' && *at != '\n';){
+        sum += strtol(at, &at, 10);
+    }
+    if(sum % 7 == 0){
+        sched_yield();
+    }
+    int length = snprintf(out, outSize, "%ld\n", sum);
+    return length < outSize ? length : outSize - 1;
+}
+
+static char* pipeline_test_input(size_t* length){
+    char* text = malloc(PIPELINE_TEST_LINES * PIPELINE_TEST_LINE_SIZE);
+    size_t used = 0;
+    srand(26);
+    for(int i = 0; i < PIPELINE_TEST_LINES; i++){
+        used += sprintf(text + used, "%d %d %d\n", i, rand() % 1000, rand() % 100000);
+    }
+    *length = used;
+    return text;
+}
+
+static char* pipeline_test_serial(const char* text, size_t length, size_t* outLength){
+    char* out = malloc(PIPELINE_TEST_LINES * PIPELINE_TEST_LINE_SIZE);
+    char line[PIPELINE_TEST_LINE_SIZE];
+    size_t used = 0;
+    for(const char* at = text; at < text + length;){
+        const char* end = strchr(at, '\n') + 1;
+        memcpy(line, at, end - at);
+        line[end - at] = 0;
+        used += pipeline_test_handler(line, out + used, PIPELINE_TEST_LINE_SIZE, 0);
+        at = end;
+    }
+    *outLength = used;
+    return out;
+}
+
+TEST_WITH_THREAD_POOL(test_pipeline_matches_serial){
+
+    test_setup();
+
+    size_t length, expectedLength;
+    char* text = pipeline_test_input(&length);
+    char* expected = pipeline_test_serial(text, length, &expectedLength);
+
+    static const struct { int workers; int batchLines; int batchesInFlight; } runs[] = {
+        { 1, 1, 2 }, { 1, 64, 2 }, { 2, 7, 3 }, { 4, 100, 5 }, { 4, 100, 16 }, { 8, 1024, 9 }, { 3, 5000, 4 },
+    };
+
+    for(size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++){
+        char message[96];
+        snprintf(message, sizeof(message), "workers %d batch %d in flight %d",
+                 runs[r].workers, runs[r].batchLines, runs[r].batchesInFlight);
+
+        PIPELINE_STREAMS_T streams = { text, length, 0, 0, 0, 0, malloc(expectedLength + 1), 0 };
+        cookie_io_functions_t inFunctions = { pipeline_test_read, NULL, NULL, NULL };
+        cookie_io_functions_t outFunctions = { NULL, pipeline_test_write, NULL, NULL };
+        FILE* in = fopencookie(&streams, "r", inFunctions);
+        FILE* out = fopencookie(&streams, "w", outFunctions);
+        // unbuffered, so the counts are of the lines the pipeline itself has taken and given back
+        setvbuf(in, NULL, _IONBF, 0);
+        setvbuf(out, NULL, _IONBF, 0);
+
+        PIPELINE_CONFIG_T config = { runs[r].workers, runs[r].batchLines, runs[r].batchesInFlight,
+                                     PIPELINE_TEST_LINE_SIZE, PIPELINE_TEST_LINE_SIZE, pipeline_test_handler };
+        assert_equal(RunLinePipeline(in, out, &config), true, message);
+        fclose(in);
+        fclose(out);
+
+        assert_equal((int)streams.writtenLength, (int)expectedLength, message);
+        assert_mem_equal(streams.written, expected, expectedLength, message);
+        assert_equal((int)streams.linesWritten, PIPELINE_TEST_LINES, message);
+        assert_equal(streams.maxHeld <= (long)runs[r].batchesInFlight * runs[r].batchLines, true, message);
+        free(streams.written);
+    }
+
+    free(expected);
+    free(text);
+    test_log_config(LOG_LEVEL_INFO);
+}
+
+typedef struct{
+    int fd;
+    PIPELINE_STREAMS_T* streams;
+    bool answered;
+}PIPELINE_FEEDER_T;
+
+// writes a few lines and keeps the pipe open until they come back, or two seconds pass
+static void* pipeline_test_feeder(void* arg){
+    PIPELINE_FEEDER_T* feeder = arg;
+    const char lines[] = "1 2\n3 4\n5 6\n";
+    if(write(feeder->fd, lines, sizeof(lines) - 1) == sizeof(lines) - 1){
+        for(int i = 0; i < 200 && !feeder->answered; i++){
+            feeder->answered = __atomic_load_n(&feeder->streams->linesWritten, __ATOMIC_SEQ_CST) == 3;
+            usleep(10000);
+        }
+    }
+    close(feeder->fd);
+    return NULL;
+}
+
+TEST_WITH_THREAD_POOL(test_pipeline_partial_batch){
+
+    test_setup();
+
+    int fds[2];
+    assert_equal(pipe(fds), 0, "pipe failed");
+    FILE* in = fdopen(fds[0], "r");
+
+    char written[64];
+    PIPELINE_STREAMS_T streams = { NULL, 0, 0, 0, 0, 0, written, 0 };
+    cookie_io_functions_t outFunctions = { NULL, pipeline_test_write, NULL, NULL };
+    FILE* out = fopencookie(&streams, "w", outFunctions);
+
+    PIPELINE_FEEDER_T feeder = { fds[1], &streams, false };
+    THREAD_T thread;
+    assert_equal(InitThread(&thread, "pipeline feeder", pipeline_test_feeder, &feeder), true, "feeder not started");
+
+    PIPELINE_CONFIG_T config = { 2, PIPELINE_DEFAULT_BATCH_LINES, 4,
+                                 PIPELINE_TEST_LINE_SIZE, PIPELINE_TEST_LINE_SIZE, pipeline_test_handler };
+    assert_equal(RunLinePipeline(in, out, &config), true, "pipeline failed");
+    WaitThreadComplete(&thread, 0, NULL);
+    fclose(in);
+    fclose(out);
+
+    assert_equal(feeder.answered, true, "lines held back until the input ended");
+    assert_mem_equal(written, "3\n7\n11\n", 8, "output");
+    test_log_config(LOG_LEVEL_INFO);
+}
@@ -0,0 +1,390 @@
+/**
+ * @file   ReverseBench.c
+ * @brief   Benchmark of every ReverseBits kernel
+ *
+ * Measures each kernel in ReverseKernels across buffer sizes, aligned and unaligned, with the buffer hot
+ * in cache and cold. Prints a table on stdout and writes the same results as JSON.
+ *
+ *  hot   the same buffer is reversed over and over, so it stays in cache when it fits
+ *  cold  every call works on the next buffer of an arena larger than the caches, so each call starts
+ *        from memory. Buffers too large for the arena are cold by size alone.
+ *
+ * Each case is timed as a set of samples; a sample covers enough back to back calls to last at least
+ * --min-sample-us so timer overhead does not dominate small sizes. Statistics are over the samples.
+ * Cycles are TSC reference cycles and are only reported on x86. Timing and statistics come from the
+ * Eeyore bench helpers.
+ *
+ * --counters also reads the hardware counters around every sample and adds IPC and cache and branch misses
+ * per byte, e.g. to see that the reference bit loop is limited by branch misses. Without access to the
+ * counters the columns read n/a.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "reverse.h"
+#include "Bench.h"
+
+#define BENCH_MAX_SAMPLES 1000
+
+typedef struct {
+    long long minBytes;
+    long long maxBytes;
+    long long evictBytes;       /* arena size used to keep cold buffers out of cache */
+    int reps;                   /* samples per case, reduced by budgetMs for slow cases */
+    int minReps;
+    int budgetMs;               /* target time spent sampling one case */
+    int maxCallMs;              /* skip cases whose single call is projected to take longer */
+    int minSampleUs;
+    const char *kernel;         /* run only this kernel when not NULL */
+    const char *jsonPath;
+    BENCH_COUNTERS_T *counters; /* hardware counters read around each sample when not NULL */
+} BENCH_OPTIONS_T;
+
+typedef struct {
+    const char *kernel;
+    long long bytes;
+    bool aligned;
+    bool cold;
+    bool skipped;
+    const char *skipReason;     /* why the case was not run, when skipped */
+    int reps;
+    long inner;                 /* calls per sample */
+    double minNs;               /* statistics of ns per call over the samples */
+    double medianNs;
+    double madNs;
+    double meanNs;
+    double stddevNs;
+    double cyclesPerByte;       /* median, negative when not available */
+    double gbPerSec;            /* from the median */
+    double ipc;                 /* medians over the samples, negative when not counted */
+    double cacheMissesPerByte;
+    double branchMissesPerByte;
+} CASE_RESULT_T;
+
+static void fill_random(unsigned char *buf, size_t len)
+{
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        buf[i] = (unsigned char)x;
+    }
+}
+
+/* median of counter samples, negative if any sample went uncounted */
+static double counter_median(double *values, int count)
+{
+    double median = bench_median(values, count);
+    return values[0] < 0 ? -1 : median;
+}
+
+/*
+ * Run one case. The arena holds one buffer per slot; hot cases use a single slot, cold cases as many
+ * slots as fit in evictBytes so a buffer has been pushed out of cache before it comes around again.
+ */
+static void run_case(const BENCH_OPTIONS_T *opt, const REVERSE_KERNEL_T *kernel, long long bytes,
+                     bool aligned, bool cold, CASE_RESULT_T *r)
+{
+    size_t offset = aligned ? 0 : 1;
+    size_t stride = ((size_t)bytes + offset + 63) / 64 * 64 + 64;
+    size_t slots = 1;
+    if (cold && stride * 2 <= (size_t)opt->evictBytes)
+        slots = opt->evictBytes / stride;
+
+    unsigned char *arena = NULL;
+    if (posix_memalign((void **)&arena, 4096, slots * stride) != 0) {
+        fprintf(stderr, "failed to allocate %zu bytes\n", slots * stride);
+        r->skipped = true;
+        r->skipReason = "buffer allocation failed";
+        return;
+    }
+    fill_random(arena, slots * stride);
+
+    /* warm up, and a first estimate of one call */
+    size_t slot = 0;
+    uint64_t t = bench_now_ns();
+    kernel->fn(arena + offset, (int)bytes);
+    uint64_t once = bench_now_ns() - t;
+    if (once == 0)
+        once = 1;
+
+    long inner = (long)((uint64_t)opt->minSampleUs * 1000 / once);
+    if (inner < 1)
+        inner = 1;
+
+    int reps = opt->reps;
+    uint64_t budget = (uint64_t)opt->budgetMs * 1000000ULL;
+    if (once * inner * reps > budget)
+        reps = (int)(budget / (once * inner));
+    if (reps < opt->minReps)
+        reps = opt->minReps;
+    if (reps > BENCH_MAX_SAMPLES)
+        reps = BENCH_MAX_SAMPLES;
+
+    double ns[BENCH_MAX_SAMPLES];
+    double cycles[BENCH_MAX_SAMPLES];
+    double ipc[BENCH_MAX_SAMPLES];
+    double cacheMisses[BENCH_MAX_SAMPLES];
+    double branchMisses[BENCH_MAX_SAMPLES];
+
+    for (int rep = 0; rep < reps; rep++) {
+        if (opt->counters != NULL)
+            bench_counters_start(opt->counters);
+        uint64_t c0 = bench_now_cycles();
+        uint64_t t0 = bench_now_ns();
+        for (long i = 0; i < inner; i++) {
+            kernel->fn(arena + slot * stride + offset, (int)bytes);
+            if (++slot == slots)
+                slot = 0;
+        }
+        uint64_t t1 = bench_now_ns();
+        uint64_t c1 = bench_now_cycles();
+        double counts[BENCH_COUNTER_COUNT] = {-1, -1, -1, -1};
+        if (opt->counters != NULL)
+            bench_counters_stop(opt->counters, counts);
+        ns[rep] = (double)(t1 - t0) / inner;
+        cycles[rep] = (double)(c1 - c0) / inner;
+        ipc[rep] = counts[BENCH_COUNTER_CYCLES] > 0 && counts[BENCH_COUNTER_INSTRUCTIONS] >= 0 ?
+                   counts[BENCH_COUNTER_INSTRUCTIONS] / counts[BENCH_COUNTER_CYCLES] : -1;
+        cacheMisses[rep] = counts[BENCH_COUNTER_CACHE_MISSES] / ((double)inner * bytes);
+        branchMisses[rep] = counts[BENCH_COUNTER_BRANCH_MISSES] / ((double)inner * bytes);
+    }
+
+    double sum = 0, sumSq = 0;
+    for (int rep = 0; rep < reps; rep++) {
+        sum += ns[rep];
+        sumSq += ns[rep] * ns[rep];
+    }
+
+    r->reps = reps;
+    r->inner = inner;
+    r->meanNs = sum / reps;
+    r->stddevNs = reps > 1 ? sqrt(fmax(0, (sumSq - sum * sum / reps) / (reps - 1))) : 0;
+    r->medianNs = bench_median(ns, reps);
+    r->madNs = bench_mad(ns, reps, r->medianNs);
+    r->minNs = ns[0];
+    r->cyclesPerByte = BENCH_HAVE_CYCLES ? bench_median(cycles, reps) / bytes : -1;
+    r->gbPerSec = r->medianNs > 0 ? bytes / r->medianNs : 0;
+    r->ipc = counter_median(ipc, reps);
+    r->cacheMissesPerByte = counter_median(cacheMisses, reps);
+    r->branchMissesPerByte = counter_median(branchMisses, reps);
+
+    free(arena);
+}
+
+static void print_header(const BENCH_OPTIONS_T *opt)
+{
+    printf("%-10s %12s %-9s %-5s %5s %14s %10s %10s %14s %8s %8s", "kernel", "bytes", "align", "cache", "reps",
+           "ns/call(med)", "MAD", "stddev", "min", "cyc/B", "GB/s");
+    if (opt->counters != NULL)
+        printf(" %6s %10s %10s", "IPC", "cmiss/B", "brmiss/B");
+    printf("\n");
+}
+
+static void print_counter(double value, int width, int precision)
+{
+    if (value >= 0)
+        printf(" %*.*f", width, precision, value);
+    else
+        printf(" %*s", width, "n/a");
+}
+
+static void print_result(const BENCH_OPTIONS_T *opt, const CASE_RESULT_T *r)
+{
+    printf("%-10s %12lld %-9s %-5s ", r->kernel, r->bytes, r->aligned ? "aligned" : "unaligned",
+           r->cold ? "cold" : "hot");
+    if (r->skipped) {
+        printf("%5s  skipped, %s\n", "-", r->skipReason);
+        return;
+    }
+    printf("%5d %14.1f %10.1f %10.1f %14.1f ", r->reps, r->medianNs, r->madNs, r->stddevNs, r->minNs);
+    if (r->cyclesPerByte >= 0)
+        printf("%8.3f ", r->cyclesPerByte);
+    else
+        printf("%8s ", "n/a");
+    printf("%8.3f", r->gbPerSec);
+    if (opt->counters != NULL) {
+        print_counter(r->ipc, 6, 2);
+        print_counter(r->cacheMissesPerByte, 10, 5);
+        print_counter(r->branchMissesPerByte, 10, 5);
+    }
+    printf("\n");
+}
+
+static void write_json_counter(FILE *f, const char *name, double value)
+{
+    if (value >= 0)
+        fprintf(f, ", \"%s\": %.6f", name, value);
+    else
+        fprintf(f, ", \"%s\": null", name);
+}
+
+static bool write_json(const BENCH_OPTIONS_T *opt, const CASE_RESULT_T *results, int count)
+{
+    FILE *f = fopen(opt->jsonPath, "w");
+    if (f == NULL) {
+        perror(opt->jsonPath);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"benchmark\": \"ReverseBits\",\n  \"cpus\": %ld,\n  \"tsc\": %s,\n  \"results\": [\n",
+            sysconf(_SC_NPROCESSORS_ONLN), BENCH_HAVE_CYCLES ? "true" : "false");
+
+    for (int i = 0; i < count; i++) {
+        const CASE_RESULT_T *r = results + i;
+        fprintf(f, "    {\"kernel\": \"%s\", \"bytes\": %lld, \"aligned\": %s, \"cache\": \"%s\", \"skipped\": %s",
+                r->kernel, r->bytes, r->aligned ? "true" : "false", r->cold ? "cold" : "hot",
+                r->skipped ? "true" : "false");
+        if (r->skipped) {
+            fprintf(f, ", \"skip_reason\": \"%s\"", r->skipReason);
+        } else {
+            fprintf(f, ", \"reps\": %d, \"calls_per_rep\": %ld, \"ns_per_call\": {\"min\": %.3f, \"median\": %.3f, "
+                    "\"mad\": %.3f, \"mean\": %.3f, \"stddev\": %.3f}, \"gb_per_s\": %.4f",
+                    r->reps, r->inner, r->minNs, r->medianNs, r->madNs, r->meanNs, r->stddevNs, r->gbPerSec);
+            if (r->cyclesPerByte >= 0)
+                fprintf(f, ", \"cycles_per_byte\": %.4f", r->cyclesPerByte);
+            else
+                fprintf(f, ", \"cycles_per_byte\": null");
+            if (opt->counters != NULL) {
+                write_json_counter(f, "ipc", r->ipc);
+                write_json_counter(f, "cache_misses_per_byte", r->cacheMissesPerByte);
+                write_json_counter(f, "branch_misses_per_byte", r->branchMissesPerByte);
+            }
+        }
+        fprintf(f, "}%s\n", i + 1 < count ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static long long parse_size(const char *s)
+{
+    char *end;
+    long long v = strtoll(s, &end, 10);
+    if (*end == 'K' || *end == 'k')
+        v <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        v <<= 20;
+    else if (*end == 'G' || *end == 'g')
+        v <<= 30;
+    return v;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --min-bytes=N       smallest buffer (default 1)\n"
+            "  --max-bytes=N       largest buffer, K/M/G suffixes allowed (default 1G)\n"
+            "  --evict-bytes=N     arena used for cold buffers (default 256M)\n"
+            "  --reps=N            samples per case (default 15)\n"
+            "  --budget-ms=N       target sampling time per case (default 1000)\n"
+            "  --max-call-ms=N     skip cases whose single call is projected over N ms (default 3000)\n"
+            "  --min-sample-us=N   minimum duration of a sample (default 20)\n"
+            "  --kernel=NAME       run a single kernel\n"
+            "  --json=PATH         JSON output (default reverse_bench.json)\n"
+            "  --counters          add IPC and cache and branch misses per byte from the hardware counters\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    BENCH_OPTIONS_T opt = {1, 1LL << 30, 256LL << 20, 15, 3, 1000, 3000, 20, NULL, "reverse_bench.json", NULL};
+    BENCH_COUNTERS_T counters;
+    bool useCounters = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strncmp(a, "--min-bytes=", 12) == 0) opt.minBytes = parse_size(a + 12);
+        else if (strncmp(a, "--max-bytes=", 12) == 0) opt.maxBytes = parse_size(a + 12);
+        else if (strncmp(a, "--evict-bytes=", 14) == 0) opt.evictBytes = parse_size(a + 14);
+        else if (strncmp(a, "--reps=", 7) == 0) opt.reps = atoi(a + 7);
+        else if (strncmp(a, "--budget-ms=", 12) == 0) opt.budgetMs = atoi(a + 12);
+        else if (strncmp(a, "--max-call-ms=", 14) == 0) opt.maxCallMs = atoi(a + 14);
+        else if (strncmp(a, "--min-sample-us=", 16) == 0) opt.minSampleUs = atoi(a + 16);
+        else if (strncmp(a, "--kernel=", 9) == 0) opt.kernel = a + 9;
+        else if (strncmp(a, "--json=", 7) == 0) opt.jsonPath = a + 7;
+        else if (strcmp(a, "--counters") == 0) useCounters = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opt.minBytes < 1 || opt.maxBytes < opt.minBytes || opt.maxBytes > 0x7FFFFFFF || opt.reps < 1) {
+        fprintf(stderr, "invalid sizes or repetitions\n");
+        return 1;
+    }
+    if (opt.minReps > opt.reps)
+        opt.minReps = opt.reps;
+    /* the columns stay when the counters cannot be opened, so the output says they were asked for */
+    if (useCounters) {
+        bench_counters_open(&counters);
+        opt.counters = &counters;
+    }
+
+    int sizeCount = 0;
+    long long sizes[40];
+    for (long long s = opt.minBytes; s < opt.maxBytes && sizeCount < 39; s *= 4)
+        sizes[sizeCount++] = s;
+    sizes[sizeCount++] = opt.maxBytes;
+
+    int kernelCount = 0;
+    for (const REVERSE_KERNEL_T *k = ReverseKernels; k->name != NULL; k++)
+        kernelCount++;
+
+    CASE_RESULT_T *results = calloc((size_t)kernelCount * sizeCount * 4, sizeof(CASE_RESULT_T));
+    if (results == NULL)
+        return 1;
+    int count = 0;
+
+    print_header(&opt);
+    for (const REVERSE_KERNEL_T *k = ReverseKernels; k->name != NULL; k++) {
+        if (opt.kernel != NULL && strcmp(opt.kernel, k->name) != 0)
+            continue;
+
+        double nsPerByte = 0;   /* slowest rate at the previous size, to project the next one */
+        for (int s = 0; s < sizeCount; s++) {
+            double sizeNsPerByte = 0;
+            for (int mode = 0; mode < 4; mode++) {
+                CASE_RESULT_T *r = results + count++;
+                r->kernel = k->name;
+                r->bytes = sizes[s];
+                r->aligned = (mode & 1) == 0;
+                r->cold = (mode & 2) != 0;
+
+                if (nsPerByte * sizes[s] > opt.maxCallMs * 1e6) {
+                    r->skipped = true;
+                    r->skipReason = "projected call over the time limit";
+                }
+                else
+                    run_case(&opt, k, sizes[s], r->aligned, r->cold, r);
+
+                if (r->skipped)
+                    sizeNsPerByte = INFINITY;
+                else if (r->medianNs / sizes[s] > sizeNsPerByte)
+                    sizeNsPerByte = r->medianNs / sizes[s];
+                print_result(&opt, r);
+                fflush(stdout);
+            }
+            nsPerByte = sizeNsPerByte;
+        }
+    }
+
+    bool ok = write_json(&opt, results, count);
+    if (ok)
+        printf("results written to %s\n", opt.jsonPath);
+
+    if (opt.counters != NULL)
+        bench_counters_close(opt.counters);
+    free(results);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+/**
+ * @file   ReverseFuzz.c
+ * @brief   Differential fuzz test of the ReverseBits kernels
+ *
+ * Every kernel in ReverseKernels is run on the same input as the reference bit loop and the results are
+ * compared. A mismatch is shrunk to a minimal input and reported as hex with a command line to replay it.
+ *
+ * Built with -DREVERSE_FUZZ_LIBFUZZER this file only provides LLVMFuzzerTestOneInput for libFuzzer. The
+ * first input byte selects the buffer alignment and the rest is the data to reverse. Otherwise main() is
+ * a standalone driver generating random lengths, alignments and contents.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "reverse.h"
+#include "ReverseTest.h"
+
+#define FUZZ_ALIGN          64          /* inputs are placed at 0..FUZZ_ALIGN-1 bytes past an aligned address */
+#define FUZZ_MAX_LEN        (1 << 20)   /* longest input accepted, bounded to keep the reference loop quick */
+
+static unsigned char *fuzz_expected;
+static unsigned char *fuzz_actual;
+
+static bool fuzz_alloc(void)
+{
+    if (fuzz_expected != NULL)
+        return true;
+    if (posix_memalign((void **)&fuzz_expected, FUZZ_ALIGN, FUZZ_MAX_LEN + FUZZ_ALIGN) != 0)
+        return false;
+    if (posix_memalign((void **)&fuzz_actual, FUZZ_ALIGN, FUZZ_MAX_LEN + FUZZ_ALIGN) != 0)
+        return false;
+    return true;
+}
+
+/* Run kernel and the reference on data at the given alignment. Returns true if both agree. */
+static bool fuzz_check(const REVERSE_KERNEL_T *kernel, const unsigned char *data, int len, int offset)
+{
+    unsigned char *expected = fuzz_expected + offset;
+    unsigned char *actual = fuzz_actual + offset;
+
+    memcpy(expected, data, len);
+    memcpy(actual, data, len);
+    ReverseBitsReference(expected, len);
+    kernel->fn(actual, len);
+
+    return memcmp(expected, actual, len) == 0;
+}
+
+/*
+ * Shrink a failing input: trim both ends together (reversal pairs byte i with byte len-1-i, so this keeps
+ * the pairs in the middle intact), drop chunks of halving size while the mismatch persists, then clear the
+ * bytes that do not matter and finally try alignment 0.
+ */
+static int fuzz_minimize(const REVERSE_KERNEL_T *kernel, unsigned char *data, int len, int *offset)
+{
+    unsigned char *trial = malloc(len > 0 ? len : 1);
+    if (trial == NULL)
+        return len;
+
+    for (int trim = len / 2; trim >= 1; trim /= 2) {
+        while (len >= 2 * trim && !fuzz_check(kernel, data + trim, len - 2 * trim, *offset)) {
+            len -= 2 * trim;
+            memmove(data, data + trim, len);
+        }
+    }
+
+    for (int chunk = len / 2; chunk >= 1; chunk /= 2) {
+        for (int at = 0; at + chunk <= len; ) {
+            memcpy(trial, data, at);
+            memcpy(trial + at, data + at + chunk, len - at - chunk);
+            if (!fuzz_check(kernel, trial, len - chunk, *offset)) {
+                len -= chunk;
+                memcpy(data, trial, len);
+            } else {
+                at += chunk;
+            }
+        }
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (data[i] == 0)
+            continue;
+        unsigned char keep = data[i];
+        data[i] = 0;
+        if (fuzz_check(kernel, data, len, *offset))
+            data[i] = keep;
+    }
+
+    if (*offset != 0 && !fuzz_check(kernel, data, len, 0))
+        *offset = 0;
+
+    free(trial);
+    return len;
+}
+
+static void fuzz_print_hex(const char *label, const unsigned char *data, int len)
+{
+    char *hex = malloc((size_t)len * 2 + 1);
+    if (hex == NULL)
+        return;
+    hex[0] = 0;
+    BinaryToHex(hex, (unsigned char *)data, len);
+    fprintf(stderr, "  %-9s%s\n", label, hex);
+    free(hex);
+}
+
+static void fuzz_report(const REVERSE_KERNEL_T *kernel, const unsigned char *data, int len, int offset)
+{
+    unsigned char *input = malloc(len > 0 ? len : 1);
+    if (input == NULL)
+        return;
+    memcpy(input, data, len);
+
+    fprintf(stderr, "MISMATCH kernel '%s' len=%d offset=%d\n", kernel->name, len, offset);
+    len = fuzz_minimize(kernel, input, len, &offset);
+    fuzz_check(kernel, input, len, offset);
+
+    fprintf(stderr, "minimized to len=%d offset=%d\n", len, offset);
+    fuzz_print_hex("input", input, len);
+    fuzz_print_hex("expected", fuzz_expected + offset, len);
+    fuzz_print_hex("actual", fuzz_actual + offset, len);
+
+    char *hex = malloc((size_t)len * 2 + 1);
+    if (hex != NULL) {
+        hex[0] = 0;
+        BinaryToHex(hex, input, len);
+        fprintf(stderr, "replay: ./ReverseFuzz.out --repro=%d:%s\n", offset, hex);
+        free(hex);
+    }
+    free(input);
+}
+
+/* Check every kernel on one input. Returns the number of kernels that disagree with the reference. */
+static int fuzz_one(const unsigned char *data, int len, int offset)
+{
+    int failures = 0;
+
+    for (const REVERSE_KERNEL_T *kernel = ReverseKernels; kernel->name != NULL; kernel++) {
+        if (kernel->fn == ReverseBitsReference)
+            continue;
+        if (!fuzz_check(kernel, data, len, offset)) {
+            fuzz_report(kernel, data, len, offset);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 1 || size - 1 > FUZZ_MAX_LEN || !fuzz_alloc())
+        return 0;
+
+    if (fuzz_one(data + 1, (int)(size - 1), data[0] % FUZZ_ALIGN) != 0)
+        abort();
+    return 0;
+}
+
+#ifndef REVERSE_FUZZ_LIBFUZZER
+
+static uint64_t fuzz_state;
+
+static uint64_t fuzz_random(void)
+{
+    fuzz_state ^= fuzz_state << 13;
+    fuzz_state ^= fuzz_state >> 7;
+    fuzz_state ^= fuzz_state << 17;
+    return fuzz_state;
+}
+
+/* Lengths are mostly short, with extra weight around the word and block boundaries kernels care about */
+static int fuzz_random_length(int maxLen)
+{
+    int len;
+    switch (fuzz_random() % 4) {
+        case 0:
+            len = fuzz_random() % 33;
+            break;
+        case 1:
+            len = (int)(fuzz_random() % 16) * 8 + (int)(fuzz_random() % 3) - 1;
+            break;
+        case 2:
+            len = fuzz_random() % 4097;
+            break;
+        default:
+            len = fuzz_random() % (maxLen + 1);
+            break;
+    }
+    if (len < 0)
+        len = 0;
+    return len > maxLen ? maxLen : len;
+}
+
+static void fuzz_random_content(unsigned char *data, int len)
+{
+    int pattern = fuzz_random() % 4;
+    for (int i = 0; i < len; i++) {
+        switch (pattern) {
+            case 0:
+                data[i] = 0;
+                break;
+            case 1:
+                data[i] = 0xFF;
+                break;
+            case 2:
+                data[i] = (unsigned char)(1u << (fuzz_random() % 8));
+                break;
+            default:
+                data[i] = (unsigned char)fuzz_random();
+                break;
+        }
+    }
+}
+
+static int fuzz_repro(char *arg)
+{
+    char *colon = strchr(arg, ':');
+    if (colon == NULL) {
+        fprintf(stderr, "--repro expects OFFSET:HEX\n");
+        return 1;
+    }
+    *colon = 0;
+    int offset = atoi(arg) % FUZZ_ALIGN;
+    char *hex = colon + 1;
+    int len = (strlen(hex) + 1) / 2;
+
+    unsigned char *data = malloc(len > 0 ? len : 1);
+    if (data == NULL)
+        return 1;
+    len = HexToBinary(hex, data, len);
+
+    int failures = fuzz_one(data, len, offset);
+    free(data);
+    printf("replay of %d bytes at offset %d: %s\n", len, offset, failures ? "MISMATCH" : "ok");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = 20000;
+    int maxLen = 65536;
+    uint64_t seed = (uint64_t)time(NULL);
+
+    if (!fuzz_alloc()) {
+        fprintf(stderr, "failed to allocate fuzz buffers\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0)
+            iterations = atol(argv[i] + 13);
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoull(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "--max-len=", 10) == 0)
+            maxLen = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--repro=", 8) == 0)
+            return fuzz_repro(argv[i] + 8);
+        else {
+            fprintf(stderr, "usage: %s [--iterations=N] [--seed=S] [--max-len=N] [--repro=OFFSET:HEX]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (maxLen < 0 || maxLen > FUZZ_MAX_LEN)
+        maxLen = FUZZ_MAX_LEN;
+
+    fuzz_state = seed ? seed : 1;
+    printf("differential fuzz: %ld iterations, max length %d, seed %llu\n", iterations, maxLen,
+           (unsigned long long)seed);
+
+    unsigned char *data = malloc(maxLen > 0 ? maxLen : 1);
+    if (data == NULL)
+        return 1;
+
+    long failures = 0;
+    for (long i = 0; i < iterations && failures == 0; i++) {
+        int len = fuzz_random_length(maxLen);
+        int offset = fuzz_random() % FUZZ_ALIGN;
+        fuzz_random_content(data, len);
+        failures += fuzz_one(data, len, offset);
+    }
+
+    free(data);
+    if (failures) {
+        printf("FAILED, replay the whole run with --seed=%llu\n", (unsigned long long)seed);
+        return 1;
+    }
+    printf("all kernels match the reference\n");
+    return 0;
+}
+
+#endif // REVERSE_FUZZ_LIBFUZZER
@@ -50,7 +50,7 @@ void BinaryToHex(char *hex, unsigned char *binary, int len)
 }
 
 
-void test_reverse(void)
+TEST(test_reverse)
 {
 
     test_setup();
@@ -93,3 +93,89 @@ void test_reverse(void)
     assert_str_equal(result_buffer, "A8", "Reversed bits of 550130 should be A8");
 
 }
+
+
+TEST(test_reverse_kernels)
+{
+
+    test_setup();
+
+    unsigned char bits[40];
+    char result_buffer[81];
+    int len;
+
+    for (const REVERSE_KERNEL_T *kernel = ReverseKernels; kernel->name != NULL; kernel++)
+    {
+        char *testStr = "550130";
+        len = HexToBinary(testStr, bits, sizeof(bits));
+        kernel->fn(bits, len);
+        BinaryToHex(result_buffer, bits, len);
+        assert_str_equal(result_buffer, "0C80AA", kernel->name);
+
+        char testStr2[] = "0123456789ABCDEF0123456789ABCDEF0123";
+        len = HexToBinary(testStr2, bits, sizeof(bits));
+        kernel->fn(bits, len);
+        BinaryToHex(result_buffer, bits, len);
+        assert_str_equal(result_buffer, "C480F7B3D591E6A2C480F7B3D591E6A2C480", kernel->name);
+    }
+
+    /* Every length up to a few words, against the reference kernel */
+    unsigned char expected[100];
+    unsigned char actual[100];
+    for (len = 0; len <= (int)sizeof(expected); len++)
+    {
+        for (int i = 0; i < len; i++)
+            expected[i] = (unsigned char)(i * 37 + len);
+
+        for (const REVERSE_KERNEL_T *kernel = ReverseKernels; kernel->name != NULL; kernel++)
+        {
+            memcpy(actual, expected, len);
+            kernel->fn(actual, len);
+            ReverseBitsReference(actual, len);
+            assert_mem_equal(actual, expected, len, kernel->name);
+        }
+    }
+}
+
+
+static unsigned char bench_buffer[4096];
+
+BENCH(reverse_bits_64)
+{
+    bench->bytes = 64;
+    bench_loop(bench)
+    {
+        ReverseBits(bench_buffer, 64);
+        bench_do_not_optimize(bench_buffer);
+    }
+}
+
+BENCH(reverse_bits_reference_4k)
+{
+    bench->bytes = sizeof(bench_buffer);
+    bench_loop(bench)
+    {
+        ReverseBitsReference(bench_buffer, sizeof(bench_buffer));
+        bench_do_not_optimize(bench_buffer);
+    }
+}
+
+BENCH(reverse_bits_table_4k)
+{
+    bench->bytes = sizeof(bench_buffer);
+    bench_loop(bench)
+    {
+        ReverseBitsTable(bench_buffer, sizeof(bench_buffer));
+        bench_do_not_optimize(bench_buffer);
+    }
+}
+
+BENCH(reverse_bits_word64_4k)
+{
+    bench->bytes = sizeof(bench_buffer);
+    bench_loop(bench)
+    {
+        ReverseBitsWord64(bench_buffer, sizeof(bench_buffer));
+        bench_do_not_optimize(bench_buffer);
+    }
+}
@@ -1,7 +1,9 @@
 #ifndef ReveseTests_H
 #define ReveseTests_H
 
-void test_reverse(void);
+// hex helpers shared with the fuzz driver
+int HexToBinary(char *hex, unsigned char *binary, int lenBinary);
+void BinaryToHex(char *hex, unsigned char *binary, int len);
 
 void NewFunction(int len, char result_buffer[40], unsigned char bits[40]);
 
@@ -1,10 +1,9 @@
 // Compiler: GCC 11.2
-#include "SpinupTests.h"
 #include "Eeyore.h"
 #include "sky.h"
 
 
-void test_sky(void){
+TEST(test_sky){
 
     test_setup();
 
@@ -1,9 +0,0 @@
-#ifndef SpinupTests_H
-#define SpinupTests_H
-
-
-
-void test_sky(void);
-
-
-#endif // SpinupTests_H
@@ -16,19 +16,71 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#include "SpinupTests.h"
-#include "ReverseTest.h"
+static void usage(const char* prog){
+    fprintf(stderr, "usage: %s [--filter=glob] [--list] [--jobs=N] [--timeout=MSEC] [--no-fork] [--bench[=glob]]\n"
+                    "       [--counters] [--baselines=FILE] [--update-baselines] [--host-class=NAME]\n"
+                    "  --filter=glob     run only the tests whose name matches, e.g. 'test_reverse*'\n"
+                    "  --list            print the names of the tests --filter selects and exit\n"
+                    "  --jobs=N          tests run in parallel processes, default one per CPU\n"
+                    "  --timeout=MSEC    kill and fail a test running longer, default %d, 0 for none\n"
+                    "  --no-fork         run tests one after another in this process, for debuggers\n"
+                    "  --bench[=glob]    after the tests, run the registered benchmarks\n"
+                    "  --counters        measure benchmarks with the hardware counters: IPC, cache and branch misses\n"
+                    "  --baselines=FILE  performance baselines, default %s\n"
+                    "  --update-baselines  store the performance measurements as the new baselines\n"
+                    "  --host-class=NAME   baselines of NAME instead of this machine's CPU model and count\n",
+                    prog, TEST_DEFAULT_TIMEOUT_MSEC, TEST_DEFAULT_BASELINE_FILE);
+}
 
-int main(void){
+int main(int argc, char* argv[]){
 
-    test_initialize(LOG_LEVEL_INFO);
-    sleep(1);
+    TEST_RUN_OPTIONS_T options = { 0, TEST_DEFAULT_TIMEOUT_MSEC, true, NULL };
+    bool list = false;
+    const char* benchFilter = NULL;
+    bool runBench = false;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--bench") == 0){
+            runBench = true;
+        } else if(strncmp(argv[i], "--bench=", 8) == 0){
+            runBench = true;
+            benchFilter = argv[i] + 8;
+        } else if(strcmp(argv[i], "--counters") == 0){
+            bench_set_counters(true);
+        } else if(strncmp(argv[i], "--filter=", 9) == 0){
+            options.filter = argv[i] + 9;
+        } else if(strcmp(argv[i], "--list") == 0){
+            list = true;
+        } else if(strncmp(argv[i], "--jobs=", 7) == 0){
+            options.jobs = atoi(argv[i] + 7);
+        } else if(strncmp(argv[i], "--timeout=", 10) == 0){
+            options.timeoutMsec = atoi(argv[i] + 10);
+        } else if(strcmp(argv[i], "--no-fork") == 0){
+            options.isolate = false;
+        } else if(strncmp(argv[i], "--baselines=", 12) == 0){
+            test_set_baseline_file(argv[i] + 12);
+        } else if(strcmp(argv[i], "--update-baselines") == 0){
+            test_set_baseline_update(true);
+        } else if(strncmp(argv[i], "--host-class=", 13) == 0){
+            test_set_host_class(argv[i] + 13);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
-    test_sky();
+    if(list){
+        test_list(stdout, options.filter);
+        return 0;
+    }
+
+    test_initialize(LOG_LEVEL_INFO);
 
-    test_reverse();
+    test_run(&options);
 
-    sleep(1);
+    if(runBench){
+        bench_run(benchFilter);
+    }
 
     return test_result();
 
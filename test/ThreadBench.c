@@ -0,0 +1,476 @@
+/**
+ * @file   ThreadBench.c
+ * @brief   Latency and throughput of the Eeyore threading primitives across thread counts
+ *
+ *  dispatch     each client thread starts a pool thread with InitThread() and joins it with
+ *               WaitThreadComplete(), back to back. Reports the InitThread() call, the time from the
+ *               call to the handler running, and the whole round trip.
+ *  bsem_wake    pairs of threads bounce a token through two binary semaphores; latency from BSemPost()
+ *               to the waiter running
+ *  isem_update  every thread hammers ISemUpdate() on one shared integer semaphore. Calls are timed in
+ *               groups of ISEM_GROUP, so the percentiles are of the group average per call
+ *  event_wake   pairs of threads bounce a token through two events; latency from SignalEvent() to
+ *               WaitForEvent() returning
+ *
+ * Clients are plain pthreads, so only dispatch is limited by the pool size. Latencies go into one
+ * histogram per thread, merged per run. The table is printed as the runs finish and every histogram is
+ * written to a JSON file, to compare runs before and after a change to the pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include "Threads.h"
+#include "Semaphores.h"
+#include "Events.h"
+#include "Logger.h"
+#include "Bench.h"
+#include "Histogram.h"
+
+#define MAX_COUNTS      32
+#define MAX_SERIES      3           /* latency histograms reported by one benchmark */
+#define ISEM_GROUP      16
+#define WAIT_MSEC       5000
+
+typedef struct {
+    int threads;
+    long ops;                       /* per thread */
+} RUN_CONFIG_T;
+
+typedef struct {
+    const char *bench;
+    int threads;
+    long ops;                       /* all threads together */
+    uint64_t elapsedNs;
+    bool ok;
+    int seriesCount;
+    const char *series[MAX_SERIES];
+    HISTOGRAM_T *latency[MAX_SERIES];
+} RUN_RESULT_T;
+
+typedef struct WORKER WORKER_T;
+
+/* State of one run, shared by its threads */
+typedef struct {
+    const RUN_CONFIG_T *config;
+    pthread_barrier_t start;
+    volatile bool failed;
+    B_SEMAPHORE_T *bsems;           /* two per pair */
+    EVENT_T *events;                /* two per pair */
+    I_SEMAPHORE_T isem;
+    volatile uint64_t *stamps;      /* per pair: when the token was posted */
+} RUN_STATE_T;
+
+struct WORKER {
+    RUN_STATE_T *state;
+    int id;
+    uint64_t startNs;               /* when it left the start barrier and when it finished */
+    uint64_t endNs;
+    HISTOGRAM_T latency[MAX_SERIES];
+};
+
+/* Every worker begins with this. Workers time themselves: on few CPUs they may all be done before the
+   thread that started them runs again */
+static void worker_start(WORKER_T *w)
+{
+    pthread_barrier_wait(&w->state->start);
+    w->startNs = bench_now_ns();
+}
+
+static void *worker_end(WORKER_T *w)
+{
+    w->endNs = bench_now_ns();
+    return NULL;
+}
+
+typedef void *(*WORKER_FN)(void *arg);
+
+/* Start config->threads workers running fn, wait for them all and collect their histograms. Exits the
+   program when the threads or their memory cannot be had, a benchmark without them means nothing */
+static void run_workers(RUN_STATE_T *state, WORKER_FN fn, RUN_RESULT_T *r)
+{
+    int n = state->config->threads;
+    WORKER_T *workers = calloc(n, sizeof(WORKER_T));
+    pthread_t *threads = calloc(n, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    pthread_barrier_init(&state->start, NULL, n + 1);
+    for (int i = 0; i < n; i++) {
+        workers[i].state = state;
+        workers[i].id = i;
+        for (int s = 0; s < MAX_SERIES; s++)
+            HistogramInit(&workers[i].latency[s]);
+        if (pthread_create(&threads[i], NULL, fn, &workers[i]) != 0) {
+            fprintf(stderr, "could not start %d threads\n", n);
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&state->start);
+    uint64_t first = UINT64_MAX, last = 0;
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        if (workers[i].startNs < first)
+            first = workers[i].startNs;
+        if (workers[i].endNs > last)
+            last = workers[i].endNs;
+    }
+    r->elapsedNs = last > first ? last - first : 0;
+    pthread_barrier_destroy(&state->start);
+
+    for (int s = 0; s < r->seriesCount; s++) {
+        r->latency[s] = malloc(sizeof(HISTOGRAM_T));
+        if (r->latency[s] == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        HistogramInit(r->latency[s]);
+        for (int i = 0; i < n; i++)
+            HistogramMerge(r->latency[s], &workers[i].latency[s]);
+    }
+    r->ok = !state->failed;
+
+    free(workers);
+    free(threads);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+
+typedef struct {
+    uint64_t called;
+    uint64_t started;
+} DISPATCH_TIMES_T;
+
+static void *dispatch_handler(void *context)
+{
+    DISPATCH_TIMES_T *times = context;
+    times->started = bench_now_ns();
+    return NULL;
+}
+
+static void *dispatch_worker(void *arg)
+{
+    WORKER_T *w = arg;
+    RUN_STATE_T *state = w->state;
+    worker_start(w);
+
+    for (long i = 0; i < state->config->ops && !state->failed; i++) {
+        DISPATCH_TIMES_T times;
+        THREAD_T thread;
+        times.called = bench_now_ns();
+        if (!InitThread(&thread, "bench dispatch", dispatch_handler, &times)) {
+            state->failed = true;
+            break;
+        }
+        uint64_t returned = bench_now_ns();
+        if (!WaitThreadComplete(&thread, WAIT_MSEC, NULL)) {
+            state->failed = true;
+            break;
+        }
+        uint64_t joined = bench_now_ns();
+        HistogramRecord(&w->latency[0], returned - times.called);
+        HistogramRecord(&w->latency[1], times.started - times.called);
+        HistogramRecord(&w->latency[2], joined - times.called);
+    }
+    return worker_end(w);
+}
+
+static void bench_dispatch(const RUN_CONFIG_T *config, RUN_RESULT_T *r)
+{
+    RUN_STATE_T state = { config };
+    r->seriesCount = 3;
+    r->series[0] = "InitThread";
+    r->series[1] = "to start";
+    r->series[2] = "round trip";
+    r->ops = config->ops * config->threads;
+    run_workers(&state, dispatch_worker, r);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Pair p is workers 2p and 2p+1. The even one serves first; each waits on its own semaphore */
+static void *bsem_worker(void *arg)
+{
+    WORKER_T *w = arg;
+    RUN_STATE_T *state = w->state;
+    int pair = w->id / 2, side = w->id % 2;
+    B_SEMAPHORE_T *mine = state->bsems + w->id;
+    B_SEMAPHORE_T *other = state->bsems + (w->id ^ 1);
+    volatile uint64_t *stamp = state->stamps + pair;
+    worker_start(w);
+
+    for (long i = 0; i < state->config->ops && !state->failed; i++) {
+        if (side == 1 || i > 0) {
+            if (!BSemWait(mine, WAIT_MSEC)) {
+                state->failed = true;
+                break;
+            }
+            HistogramRecord(&w->latency[0], bench_now_ns() - *stamp);
+        }
+        *stamp = bench_now_ns();
+        BSemPost(other);
+    }
+    /* the last token of the odd side is never taken, which is fine: the semaphores are destroyed */
+    return worker_end(w);
+}
+
+static void bench_bsem_wake(const RUN_CONFIG_T *config, RUN_RESULT_T *r)
+{
+    RUN_STATE_T state = { config };
+    int n = config->threads;
+    state.bsems = calloc(n, sizeof(B_SEMAPHORE_T));
+    state.stamps = calloc(n / 2, sizeof(uint64_t));
+    for (int i = 0; i < n; i++)
+        BSemInit(state.bsems + i, false);
+
+    r->seriesCount = 1;
+    r->series[0] = "post to wake";
+    r->ops = config->ops * n;
+    run_workers(&state, bsem_worker, r);
+
+    for (int i = 0; i < n; i++)
+        BSemDestroy(state.bsems + i);
+    free(state.bsems);
+    free((void *)state.stamps);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void *isem_worker(void *arg)
+{
+    WORKER_T *w = arg;
+    RUN_STATE_T *state = w->state;
+    worker_start(w);
+
+    for (long i = 0; i < state->config->ops; i += ISEM_GROUP) {
+        uint64_t t0 = bench_now_ns();
+        for (int g = 0; g < ISEM_GROUP; g++)
+            ISemUpdate(&state->isem, ADD, (g & 1) ? -1 : 1);
+        HistogramRecord(&w->latency[0], (bench_now_ns() - t0) / ISEM_GROUP);
+    }
+    return worker_end(w);
+}
+
+static void bench_isem_update(const RUN_CONFIG_T *config, RUN_RESULT_T *r)
+{
+    RUN_STATE_T state = { config };
+    ISemInit(&state.isem, 0);
+
+    r->seriesCount = 1;
+    r->series[0] = "ISemUpdate";
+    r->ops = (config->ops + ISEM_GROUP - 1) / ISEM_GROUP * ISEM_GROUP * config->threads;
+    run_workers(&state, isem_worker, r);
+
+    if (ISemValue(&state.isem) != 0)
+        r->ok = false;
+    ISemDestroy(&state.isem);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void *event_worker(void *arg)
+{
+    WORKER_T *w = arg;
+    RUN_STATE_T *state = w->state;
+    int pair = w->id / 2, side = w->id % 2;
+    EVENT_T *mine = state->events + w->id;
+    EVENT_T *other = state->events + (w->id ^ 1);
+    volatile uint64_t *stamp = state->stamps + pair;
+    worker_start(w);
+
+    for (long i = 0; i < state->config->ops && !state->failed; i++) {
+        if (side == 1 || i > 0) {
+            if (!WaitForEvent(mine, WAIT_MSEC)) {
+                state->failed = true;
+                break;
+            }
+            HistogramRecord(&w->latency[0], bench_now_ns() - *stamp);
+        }
+        *stamp = bench_now_ns();
+        SignalEvent(other);
+    }
+    return worker_end(w);
+}
+
+static void bench_event_wake(const RUN_CONFIG_T *config, RUN_RESULT_T *r)
+{
+    RUN_STATE_T state = { config };
+    int n = config->threads;
+    state.events = calloc(n, sizeof(EVENT_T));
+    state.stamps = calloc(n / 2, sizeof(uint64_t));
+    for (int i = 0; i < n; i++)
+        InitEvent(state.events + i, "bench event");
+
+    r->seriesCount = 1;
+    r->series[0] = "signal to wake";
+    r->ops = config->ops * n;
+    run_workers(&state, event_worker, r);
+
+    for (int i = 0; i < n; i++)
+        DestroyEvent(state.events + i);
+    free(state.events);
+    free((void *)state.stamps);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+
+typedef struct {
+    const char *name;
+    void (*fn)(const RUN_CONFIG_T *config, RUN_RESULT_T *r);
+    bool pairs;                     /* runs on an even number of threads */
+    bool pool;                      /* needs a pool thread per client */
+} BENCHMARK_T;
+
+static const BENCHMARK_T benchmarks[] = {
+    { "dispatch",    bench_dispatch,    false, true  },
+    { "bsem_wake",   bench_bsem_wake,   true,  false },
+    { "isem_update", bench_isem_update, false, false },
+    { "event_wake",  bench_event_wake,  true,  false },
+    { NULL, NULL, false, false }
+};
+
+static void print_result(const RUN_RESULT_T *r)
+{
+    for (int s = 0; s < r->seriesCount; s++) {
+        const HISTOGRAM_T *h = r->latency[s];
+        char rate[16] = "";
+        if (s == 0 && r->elapsedNs > 0)
+            snprintf(rate, sizeof(rate), "%.0f", r->ops * 1e9 / r->elapsedNs);
+        printf("%-12s %7d %-15s %12s %9.2f %9.2f %9.2f %9.2f %10.2f %s\n", s == 0 ? r->bench : "",
+               r->threads, r->series[s], rate,
+               HistogramPercentile(h, 50) / 1000.0, HistogramPercentile(h, 90) / 1000.0,
+               HistogramPercentile(h, 99) / 1000.0, HistogramPercentile(h, 99.9) / 1000.0, h->max / 1000.0,
+               r->ok ? "" : "FAILED");
+    }
+}
+
+static bool write_json(const char *path, const RUN_RESULT_T *results, int count, long ops)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"benchmark\": \"threads\",\n  \"pool\": %d,\n  \"ops_per_thread\": %ld,\n  \"results\": [\n",
+            THREAD_POOL_SIZE, ops);
+    for (int i = 0; i < count; i++) {
+        const RUN_RESULT_T *r = results + i;
+        fprintf(f, "    {\"bench\": \"%s\", \"threads\": %d, \"ok\": %s, \"ops\": %ld, \"ops_per_s\": %.1f, "
+                "\"latency_ns\": [", r->bench, r->threads, r->ok ? "true" : "false", r->ops,
+                r->elapsedNs ? r->ops * 1e9 / r->elapsedNs : 0);
+        for (int s = 0; s < r->seriesCount; s++) {
+            fprintf(f, "%s", s ? ", " : "");
+            HistogramWriteJson(f, r->latency[s], r->series[s]);
+        }
+        fprintf(f, "]}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static int parse_counts(char *list, int *counts)
+{
+    int n = 0;
+    for (char *tok = strtok(list, ","); tok != NULL && n < MAX_COUNTS; tok = strtok(NULL, ","))
+        counts[n++] = atoi(tok);
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --threads=N,N,...   thread counts to run, default 1,2,4,8,16\n"
+            "  --ops=N             operations per thread, default 20000\n"
+            "  --bench=glob        run only matching benchmarks: dispatch, bsem_wake, isem_update, event_wake\n"
+            "  --json=PATH         JSON output (default thread_bench.json)\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int counts[MAX_COUNTS] = { 1, 2, 4, 8, 16 };
+    int countCount = 5;
+    long ops = 20000;
+    const char *filter = NULL;
+    const char *jsonPath = "thread_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        char *a = argv[i];
+        if (strncmp(a, "--threads=", 10) == 0) countCount = parse_counts(a + 10, counts);
+        else if (strncmp(a, "--ops=", 6) == 0) ops = atol(a + 6);
+        else if (strncmp(a, "--bench=", 8) == 0) filter = a + 8;
+        else if (strncmp(a, "--json=", 7) == 0) jsonPath = a + 7;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (ops < 1) {
+        fprintf(stderr, "invalid operation count\n");
+        return 1;
+    }
+
+    LogSetConfig(LOG_LEVEL_WARNING, "%(asctime)s [%(levelname)s] [%(funcName)s]: %(message)s");
+    LogAddAppender(LogAppenderStderr, true);
+    if (!InitThreadPool()) {
+        fprintf(stderr, "failed to initialize the thread pool\n");
+        return 1;
+    }
+
+    int benchCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    RUN_RESULT_T *results = calloc((size_t)benchCount * countCount, sizeof(RUN_RESULT_T));
+    int count = 0, failures = 0;
+    if (results == NULL)
+        return 1;
+
+    printf("%-12s %7s %-15s %12s %9s %9s %9s %9s %10s\n", "bench", "threads", "latency", "ops/s", "p50 us",
+           "p90 us", "p99 us", "p99.9 us", "max us");
+    for (const BENCHMARK_T *b = benchmarks; b->name != NULL; b++) {
+        if (filter != NULL && fnmatch(filter, b->name, 0) != 0)
+            continue;
+        int previous = 0;
+        for (int c = 0; c < countCount; c++) {
+            RUN_CONFIG_T config = { counts[c], ops };
+            if (b->pairs)
+                config.threads = (config.threads + 1) / 2 * 2;
+            /* counts rounded up to pairs may repeat */
+            if (config.threads < 1 || config.threads == previous)
+                continue;
+            previous = config.threads;
+            if (b->pool && config.threads > THREAD_POOL_SIZE) {
+                printf("%-12s %7d skipped, needs THREAD_POOL_SIZE >= %d\n", b->name, config.threads,
+                       config.threads);
+                continue;
+            }
+            RUN_RESULT_T *r = results + count++;
+            r->bench = b->name;
+            r->threads = config.threads;
+            b->fn(&config, r);
+            print_result(r);
+            fflush(stdout);
+            if (!r->ok)
+                failures++;
+        }
+    }
+
+    DestroyThreadPool(5000);
+
+    bool written = write_json(jsonPath, results, count, ops);
+    if (written)
+        printf("results written to %s\n", jsonPath);
+    for (int i = 0; i < count; i++)
+        for (int s = 0; s < results[i].seriesCount; s++)
+            free(results[i].latency[s]);
+    free(results);
+    return written && failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,653 @@
+/**
+ * @file   ThreadStress.c
+ * @brief   Load scenarios for the Eeyore threading primitives
+ *
+ *  producer_consumer   bounded ring guarded by two integer semaphores (items and free space), half the
+ *                      threads produce and half consume. Every item must be taken once and in order.
+ *  ping_pong           pairs of threads bounce a counter through two binary semaphores
+ *  fan_out_in          the caller releases all threads at once through one event each and waits on an
+ *                      integer semaphore for all of them to check in, round after round
+ *  pool_churn          half the threads start and join short pool threads back to back
+ *
+ * All waits are timed, so a lost post shows up as a failed run instead of a hang. Threads optionally
+ * yield or spin at random points to shake out orderings. Wake-up latency is the time from a post or
+ * signal to the woken thread running.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include "ThreadStress.h"
+#include "Eeyore.h"
+#include "Threads.h"
+#include "Semaphores.h"
+#include "Events.h"
+#include "Histogram.h"
+
+#define STRESS_WAIT_MSEC        5000    /* longest a post may take to arrive before the run fails */
+#define STRESS_RING_SIZE        64
+
+/* Shared by every thread of a run. First member of each scenario's state. */
+typedef struct {
+    const STRESS_CONFIG_T *config;
+    atomic_bool failed;
+    char error[160];
+} STRESS_STATE_T;
+
+typedef struct {
+    STRESS_STATE_T *state;
+    void *scenario;
+    int id;
+    long ops;
+    uint64_t rng;
+    HISTOGRAM_T wake;           /* wake-up latency in ns */
+} STRESS_WORKER_T;
+
+static void stress_fail(STRESS_STATE_T *state, const char *format, ...)
+{
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&state->failed, &expected, true))
+        return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(state->error, sizeof(state->error), format, args);
+    va_end(args);
+}
+
+static bool stress_failed(STRESS_STATE_T *state)
+{
+    return atomic_load_explicit(&state->failed, memory_order_relaxed);
+}
+
+static uint64_t stress_random(STRESS_WORKER_T *w)
+{
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    return w->rng;
+}
+
+/* Perturb the timing of the calling thread now and then */
+static void stress_jitter(STRESS_WORKER_T *w)
+{
+    int oneIn = w->state->config->yieldOneIn;
+    if (oneIn <= 0 || stress_random(w) % oneIn != 0)
+        return;
+    if (stress_random(w) & 1) {
+        sched_yield();
+    } else {
+        for (volatile int spin = stress_random(w) % 512; spin > 0; spin--)
+            ;
+    }
+}
+
+static void stress_sample(STRESS_WORKER_T *w, uint64_t postedNs)
+{
+    HistogramRecord(&w->wake, bench_now_ns() - postedNs);
+}
+
+static STRESS_WORKER_T *stress_workers(STRESS_STATE_T *state, void *scenario, int count, long ops)
+{
+    STRESS_WORKER_T *workers = calloc(count, sizeof(STRESS_WORKER_T));
+    if (workers == NULL)
+        return NULL;
+
+    for (int i = 0; i < count; i++) {
+        STRESS_WORKER_T *w = workers + i;
+        w->state = state;
+        w->scenario = scenario;
+        w->id = i;
+        w->ops = ops / count + (i < ops % count ? 1 : 0);
+        w->rng = state->config->seed * 2654435761ULL + i + 1;
+        HistogramInit(&w->wake);
+    }
+    return workers;
+}
+
+/* Start one pool thread per worker and wait for all of them. The caller may do its part in between. */
+static int stress_start(STRESS_WORKER_T *workers, int count, void *(*handler)(void *), THREAD_T *threads)
+{
+    int started = 0;
+    for (; started < count; started++) {
+        if (!InitThread(threads + started, "stress", handler, workers + started)) {
+            stress_fail(workers[0].state, "could not start thread %d of %d", started + 1, count);
+            break;
+        }
+    }
+    return started;
+}
+
+static void stress_join(STRESS_STATE_T *state, THREAD_T *threads, int started)
+{
+    for (int i = 0; i < started; i++) {
+        if (!WaitThreadComplete(threads + i, 0, NULL))
+            stress_fail(state, "thread %d did not complete", i);
+    }
+}
+
+static void stress_finish(STRESS_STATE_T *state, STRESS_WORKER_T *workers, int count, uint64_t start,
+                          STRESS_RESULT_T *result)
+{
+    result->elapsedNs = bench_now_ns() - start;
+    result->ok = !stress_failed(state);
+    snprintf(result->error, sizeof(result->error), "%s", result->ok ? "" : state->error);
+
+    result->wakeCount = 0;
+    result->wakeP50Ns = result->wakeP99Ns = result->wakeMaxNs = 0;
+    HISTOGRAM_T *wake = malloc(sizeof(HISTOGRAM_T));
+    if (wake == NULL)
+        return;
+    HistogramInit(wake);
+    for (int i = 0; i < count; i++)
+        HistogramMerge(wake, &workers[i].wake);
+
+    result->wakeCount = wake->totalCount;
+    result->wakeP50Ns = HistogramPercentile(wake, 50);
+    result->wakeP99Ns = HistogramPercentile(wake, 99);
+    result->wakeMaxNs = wake->max;
+    free(wake);
+}
+
+/*---------------------------------------------------------------------------------------------
+ producer / consumer
+---------------------------------------------------------------------------------------------
+*/
+
+typedef struct {
+    int producer;
+    long seq;
+    uint64_t postedNs;
+} STRESS_ITEM_T;
+
+typedef struct {
+    STRESS_STATE_T state;
+    I_SEMAPHORE_T items;
+    I_SEMAPHORE_T space;
+    pthread_mutex_t putLock;    /* a wait and its decrement are not atomic, so each side takes them under a lock */
+    pthread_mutex_t takeLock;
+    long head;
+    long tail;
+    STRESS_ITEM_T ring[STRESS_RING_SIZE];
+    int producers;
+    long *lastSeq;              /* last sequence number taken from each producer */
+    atomic_long taken;
+    atomic_long claimed;
+    long total;
+} STRESS_PC_T;
+
+static void *stress_producer(void *context)
+{
+    STRESS_WORKER_T *w = context;
+    STRESS_PC_T *pc = w->scenario;
+    int producer = w->id;
+
+    for (long seq = 0; seq < w->ops && !stress_failed(w->state); seq++) {
+        stress_jitter(w);
+        pthread_mutex_lock(&pc->putLock);
+        if (stress_failed(w->state)) {
+            pthread_mutex_unlock(&pc->putLock);
+            break;
+        }
+        if (!ISemWaitValue(&pc->space, GRTR, 0, STRESS_WAIT_MSEC)) {
+            pthread_mutex_unlock(&pc->putLock);
+            stress_fail(w->state, "producer %d timed out waiting for space", producer);
+            break;
+        }
+        ISemUpdate(&pc->space, DECR);
+        STRESS_ITEM_T *item = pc->ring + pc->head++ % STRESS_RING_SIZE;
+        item->producer = producer;
+        item->seq = seq;
+        item->postedNs = bench_now_ns();
+        pthread_mutex_unlock(&pc->putLock);
+
+        stress_jitter(w);
+        ISemUpdate(&pc->items, INCR);
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *context)
+{
+    STRESS_WORKER_T *w = context;
+    STRESS_PC_T *pc = w->scenario;
+
+    // claim items up front so every consumer knows when to stop
+    while (!stress_failed(w->state) && atomic_fetch_add(&pc->claimed, 1) < pc->total) {
+        stress_jitter(w);
+        pthread_mutex_lock(&pc->takeLock);
+        if (stress_failed(w->state)) {     // do not queue up one timeout per waiting consumer
+            pthread_mutex_unlock(&pc->takeLock);
+            break;
+        }
+        if (!ISemWaitValue(&pc->items, GRTR, 0, STRESS_WAIT_MSEC)) {
+            pthread_mutex_unlock(&pc->takeLock);
+            stress_fail(w->state, "consumer %d timed out waiting for an item, %ld of %ld taken", w->id,
+                        atomic_load(&pc->taken), pc->total);
+            break;
+        }
+        ISemUpdate(&pc->items, DECR);
+        STRESS_ITEM_T item = pc->ring[pc->tail++ % STRESS_RING_SIZE];
+        stress_sample(w, item.postedNs);
+
+        if (item.producer < 0 || item.producer >= pc->producers) {
+            stress_fail(w->state, "item from unknown producer %d", item.producer);
+        } else if (item.seq != pc->lastSeq[item.producer] + 1) {
+            stress_fail(w->state, "producer %d: took item %ld after %ld", item.producer, item.seq,
+                        pc->lastSeq[item.producer]);
+        } else {
+            pc->lastSeq[item.producer] = item.seq;
+        }
+        pthread_mutex_unlock(&pc->takeLock);
+
+        atomic_fetch_add(&pc->taken, 1);
+        ISemUpdate(&pc->space, INCR);
+    }
+    return NULL;
+}
+
+static void stress_producer_consumer(const STRESS_CONFIG_T *config, STRESS_RESULT_T *result)
+{
+    int producers = config->threads / 2 > 0 ? config->threads / 2 : 1;
+    int consumers = config->threads - producers > 0 ? config->threads - producers : 1;
+
+    STRESS_PC_T *pc = calloc(1, sizeof(STRESS_PC_T));
+    THREAD_T *threads = calloc(producers + consumers, sizeof(THREAD_T));
+    STRESS_WORKER_T *made = NULL, *takers = NULL;
+    if (pc == NULL || threads == NULL)
+        goto out;
+
+    pc->state.config = config;
+    pc->producers = producers;
+    pc->lastSeq = calloc(producers, sizeof(long));
+    made = stress_workers(&pc->state, pc, producers, config->ops);
+    takers = stress_workers(&pc->state, pc, consumers, config->ops);
+    if (pc->lastSeq == NULL || made == NULL || takers == NULL)
+        goto out;
+    for (int p = 0; p < producers; p++)
+        pc->lastSeq[p] = -1;
+    pc->total = config->ops;
+
+    ISemInit(&pc->items, 0);
+    ISemInit(&pc->space, STRESS_RING_SIZE);
+    pthread_mutex_init(&pc->putLock, NULL);
+    pthread_mutex_init(&pc->takeLock, NULL);
+
+    uint64_t start = bench_now_ns();
+    int started = stress_start(takers, consumers, stress_consumer, threads);
+    if (started == consumers)
+        started += stress_start(made, producers, stress_producer, threads + consumers);
+    else
+        atomic_store(&pc->claimed, pc->total);  // release consumers already waiting
+    stress_join(&pc->state, threads, started);
+    stress_finish(&pc->state, takers, consumers, start, result);
+
+    result->ops = atomic_load(&pc->taken);
+    if (result->ok) {
+        for (int p = 0; p < producers; p++) {
+            if (pc->lastSeq[p] != made[p].ops - 1) {
+                result->ok = false;
+                snprintf(result->error, sizeof(result->error), "producer %d: %ld of %ld items taken", p,
+                         pc->lastSeq[p] + 1, made[p].ops);
+            }
+        }
+        if (ISemValue(&pc->items) != 0 || ISemValue(&pc->space) != STRESS_RING_SIZE) {
+            result->ok = false;
+            snprintf(result->error, sizeof(result->error), "counts do not balance: items %d, space %d of %d",
+                     ISemValue(&pc->items), ISemValue(&pc->space), STRESS_RING_SIZE);
+        }
+    }
+
+    ISemDestroy(&pc->items);
+    ISemDestroy(&pc->space);
+    pthread_mutex_destroy(&pc->putLock);
+    pthread_mutex_destroy(&pc->takeLock);
+
+out:
+    if (pc != NULL)
+        free(pc->lastSeq);
+    free(made);
+    free(takers);
+    free(threads);
+    free(pc);
+}
+
+/*---------------------------------------------------------------------------------------------
+ ping pong
+---------------------------------------------------------------------------------------------
+*/
+
+typedef struct {
+    B_SEMAPHORE_T ping;
+    B_SEMAPHORE_T pong;
+    long ball;                  /* odd after a ping, even after a pong */
+    uint64_t postedNs;
+} STRESS_PAIR_T;
+
+typedef struct {
+    STRESS_STATE_T state;
+    STRESS_PAIR_T *pairs;
+} STRESS_PP_T;
+
+/* even workers serve, odd workers return */
+static void *stress_player(void *context)
+{
+    STRESS_WORKER_T *w = context;
+    STRESS_PP_T *pp = w->scenario;
+    STRESS_PAIR_T *pair = pp->pairs + w->id / 2;
+    bool server = w->id % 2 == 0;
+    B_SEMAPHORE_T *mine = server ? &pair->pong : &pair->ping;
+    B_SEMAPHORE_T *theirs = server ? &pair->ping : &pair->pong;
+
+    for (long i = 0; i < w->ops && !stress_failed(w->state); i++) {
+        if (server) {
+            pair->ball = 2 * i + 1;
+            pair->postedNs = bench_now_ns();
+            BSemPost(theirs);
+        }
+        if (!BSemWait(mine, STRESS_WAIT_MSEC)) {
+            stress_fail(w->state, "pair %d: %s lost ball %ld", w->id / 2, server ? "server" : "returner", i);
+            break;
+        }
+        stress_sample(w, pair->postedNs);
+        if (pair->ball != 2 * i + (server ? 2 : 1)) {
+            stress_fail(w->state, "pair %d: ball %ld out of order at exchange %ld", w->id / 2, pair->ball, i);
+            break;
+        }
+        stress_jitter(w);
+        if (!server) {
+            pair->ball++;
+            pair->postedNs = bench_now_ns();
+            BSemPost(theirs);
+        }
+    }
+    return NULL;
+}
+
+static void stress_ping_pong(const STRESS_CONFIG_T *config, STRESS_RESULT_T *result)
+{
+    int pairs = config->threads / 2 > 0 ? config->threads / 2 : 1;
+    long exchanges = config->ops / pairs > 0 ? config->ops / pairs : 1;
+
+    STRESS_PP_T pp = { .state = { .config = config } };
+    pp.pairs = calloc(pairs, sizeof(STRESS_PAIR_T));
+    THREAD_T *threads = calloc(pairs * 2, sizeof(THREAD_T));
+    STRESS_WORKER_T *players = stress_workers(&pp.state, &pp, pairs * 2, exchanges * pairs * 2);
+    if (pp.pairs == NULL || threads == NULL || players == NULL)
+        goto out;
+
+    for (int p = 0; p < pairs; p++) {
+        BSemInit(&pp.pairs[p].ping, false);
+        BSemInit(&pp.pairs[p].pong, false);
+    }
+
+    uint64_t start = bench_now_ns();
+    int started = stress_start(players, pairs * 2, stress_player, threads);
+    stress_join(&pp.state, threads, started);
+    stress_finish(&pp.state, players, pairs * 2, start, result);
+    result->ops = 0;
+    for (int p = 0; p < pairs; p++) {
+        result->ops += pp.pairs[p].ball / 2;
+        BSemDestroy(&pp.pairs[p].ping);
+        BSemDestroy(&pp.pairs[p].pong);
+    }
+
+out:
+    free(players);
+    free(threads);
+    free(pp.pairs);
+}
+
+/*---------------------------------------------------------------------------------------------
+ fan out / fan in
+---------------------------------------------------------------------------------------------
+*/
+
+typedef struct {
+    STRESS_STATE_T state;
+    EVENT_T *go;                /* one per worker: a worker not yet waiting when a round is signaled still gets it */
+    I_SEMAPHORE_T finished;     /* check-ins over all rounds */
+    atomic_long arrivals;
+    atomic_ullong signalNs;
+} STRESS_FAN_T;
+
+static void *stress_fan_worker(void *context)
+{
+    STRESS_WORKER_T *w = context;
+    STRESS_FAN_T *fan = w->scenario;
+
+    for (long r = 0; r < w->ops && !stress_failed(w->state); r++) {
+        if (!WaitForEvent(&fan->go[w->id], STRESS_WAIT_MSEC)) {
+            stress_fail(w->state, "worker %d missed the release of round %ld", w->id, r);
+            break;
+        }
+        if (stress_failed(w->state))
+            break;
+        stress_sample(w, atomic_load(&fan->signalNs));
+        stress_jitter(w);
+        atomic_fetch_add(&fan->arrivals, 1);
+        ISemUpdate(&fan->finished, INCR);
+    }
+    return NULL;
+}
+
+static void stress_fan_out_in(const STRESS_CONFIG_T *config, STRESS_RESULT_T *result)
+{
+    int workers = config->threads > 0 ? config->threads : 1;
+    long rounds = config->ops / workers > 0 ? config->ops / workers : 1;
+
+    STRESS_FAN_T *fan = calloc(1, sizeof(STRESS_FAN_T));
+    THREAD_T *threads = calloc(workers, sizeof(THREAD_T));
+    STRESS_WORKER_T *fanned = NULL;
+    if (fan == NULL || threads == NULL)
+        goto out;
+    fan->state.config = config;
+    fan->go = calloc(workers, sizeof(EVENT_T));
+    fanned = stress_workers(&fan->state, fan, workers, rounds * workers);
+    if (fan->go == NULL || fanned == NULL)
+        goto out;
+
+    for (int i = 0; i < workers; i++)
+        InitEvent(&fan->go[i], "fan out");
+    ISemInit(&fan->finished, 0);
+
+    uint64_t start = bench_now_ns();
+    int started = stress_start(fanned, workers, stress_fan_worker, threads);
+
+    for (long r = 0; r < rounds && started == workers && !stress_failed(&fan->state); r++) {
+        atomic_store(&fan->signalNs, bench_now_ns());
+        for (int i = 0; i < workers; i++)
+            SignalEvent(&fan->go[i]);
+
+        long expected = (r + 1) * workers;
+        if (!ISemWaitValue(&fan->finished, GRTR, (int)expected - 1, STRESS_WAIT_MSEC)) {
+            stress_fail(&fan->state, "round %ld: %d of %d workers checked in", r,
+                        ISemValue(&fan->finished) - (int)(r * workers), workers);
+        } else if (atomic_load(&fan->arrivals) != expected) {
+            stress_fail(&fan->state, "round %ld: %ld arrivals, expected %ld", r, atomic_load(&fan->arrivals),
+                        expected);
+        }
+    }
+    if (stress_failed(&fan->state)) {
+        // wake anything still waiting so it sees the failure
+        for (int i = 0; i < workers; i++)
+            SignalEvent(&fan->go[i]);
+    }
+
+    stress_join(&fan->state, threads, started);
+    stress_finish(&fan->state, fanned, workers, start, result);
+    result->ops = atomic_load(&fan->arrivals);
+
+    for (int i = 0; i < workers; i++)
+        DestroyEvent(&fan->go[i]);
+    ISemDestroy(&fan->finished);
+
+out:
+    if (fan != NULL)
+        free(fan->go);
+    free(fanned);
+    free(threads);
+    free(fan);
+}
+
+/*---------------------------------------------------------------------------------------------
+ pool churn
+---------------------------------------------------------------------------------------------
+*/
+
+typedef struct {
+    STRESS_STATE_T state;
+    atomic_long ran;
+} STRESS_CHURN_T;
+
+static void *stress_churn_task(void *context)
+{
+    STRESS_CHURN_T *churn = context;
+    atomic_fetch_add(&churn->ran, 1);
+    return context;
+}
+
+static void *stress_submitter(void *context)
+{
+    STRESS_WORKER_T *w = context;
+    STRESS_CHURN_T *churn = w->scenario;
+
+    for (long i = 0; i < w->ops && !stress_failed(w->state); i++) {
+        THREAD_T task;
+        void *ret = NULL;
+        uint64_t postedNs = bench_now_ns();
+
+        stress_jitter(w);
+        if (!InitThread(&task, "churn", stress_churn_task, churn)) {
+            stress_fail(w->state, "submitter %d could not start task %ld", w->id, i);
+            break;
+        }
+        if (!WaitThreadComplete(&task, STRESS_WAIT_MSEC, &ret) || ret != churn) {
+            stress_fail(w->state, "submitter %d: task %ld did not complete", w->id, i);
+            break;
+        }
+        stress_sample(w, postedNs);
+    }
+    return NULL;
+}
+
+static void stress_pool_churn(const STRESS_CONFIG_T *config, STRESS_RESULT_T *result)
+{
+    int submitters = config->threads / 2 > 0 ? config->threads / 2 : 1;
+
+    STRESS_CHURN_T churn = { .state = { .config = config } };
+    THREAD_T *threads = calloc(submitters, sizeof(THREAD_T));
+    STRESS_WORKER_T *workers = stress_workers(&churn.state, &churn, submitters, config->ops);
+    if (threads == NULL || workers == NULL)
+        goto out;
+
+    uint64_t start = bench_now_ns();
+    int started = stress_start(workers, submitters, stress_submitter, threads);
+    stress_join(&churn.state, threads, started);
+    stress_finish(&churn.state, workers, submitters, start, result);
+    result->ops = atomic_load(&churn.ran);
+
+    // every thread must find its way back to the pool. they get there just after they are joined
+    int available = GetAvailableThreadsInThreadPool();
+    for (int i = 0; i < 10000 && available != THREAD_POOL_SIZE; i++) {
+        sched_yield();
+        available = GetAvailableThreadsInThreadPool();
+    }
+    if (result->ok && available != THREAD_POOL_SIZE) {
+        result->ok = false;
+        snprintf(result->error, sizeof(result->error), "pool has %d of %d threads available", available,
+                 THREAD_POOL_SIZE);
+    }
+
+out:
+    free(workers);
+    free(threads);
+}
+
+const STRESS_SCENARIO_T StressScenarios[] = {
+    { "producer_consumer", stress_producer_consumer },
+    { "ping_pong", stress_ping_pong },
+    { "fan_out_in", stress_fan_out_in },
+    { "pool_churn", stress_pool_churn },
+    { NULL, NULL },
+};
+
+void StressReport(FILE *f, const char *name, const STRESS_CONFIG_T *config, const STRESS_RESULT_T *result)
+{
+    double seconds = result->elapsedNs / 1e9;
+    fprintf(f, "%-18s threads %3d  ops %9ld  %10.0f ops/s  wake p50 %8.1f us  p99 %8.1f us  max %8.1f us  %s%s\n",
+            name, config->threads, result->ops, seconds > 0 ? result->ops / seconds : 0, result->wakeP50Ns / 1e3,
+            result->wakeP99Ns / 1e3, result->wakeMaxNs / 1e3, result->ok ? "ok" : "FAILED: ", result->error);
+}
+
+// every scenario at a few threads with plenty of injected yields
+TEST_WITH_THREAD_POOL(test_thread_stress)
+{
+    test_setup();
+
+    STRESS_CONFIG_T config = { 8, 4000, 4, 1 };
+
+    for (const STRESS_SCENARIO_T *s = StressScenarios; s->name != NULL; s++) {
+        STRESS_RESULT_T result;
+        s->fn(&config, &result);
+        StressReport(stdout, s->name, &config, &result);
+        assert_equal(result.ok, true, result.error);
+        assert_greater_than(result.ops, 0, "stress run did no work");
+    }
+}
+
+static void *stress_slow_task(void *context)
+{
+    struct timespec pause = { 0, 100 * 1000000L };
+    nanosleep(&pause, NULL);
+    return context;
+}
+
+// a thread whose wait timed out goes back to the pool once its handler is done
+TEST_WITH_THREAD_POOL(test_thread_timeout_returns_to_pool)
+{
+    test_setup();
+
+    THREAD_T task;
+    assert_equal(InitThread(&task, "slow", stress_slow_task, NULL), true, "InitThread failed");
+    assert_equal(WaitThreadComplete(&task, 1, NULL), false, "the wait did not time out");
+
+    int available = GetAvailableThreadsInThreadPool();
+    for (int i = 0; i < 500 && available != THREAD_POOL_SIZE; i++) {
+        struct timespec pause = { 0, 1000000L };
+        nanosleep(&pause, NULL);
+        available = GetAvailableThreadsInThreadPool();
+    }
+    assert_equal(available, THREAD_POOL_SIZE, "the timed out thread did not return to the pool");
+}
+
+static void *stress_event_waiter(void *context)
+{
+    return WaitForEvent(context, STRESS_WAIT_MSEC) ? context : NULL;
+}
+
+// one SignalEvent releases every thread blocked on the event
+TEST_WITH_THREAD_POOL(test_event_wakes_every_waiter)
+{
+    test_setup();
+
+    EVENT_T event;
+    THREAD_T waiters[4];
+    InitEvent(&event, "every waiter");
+    for (int i = 0; i < 4; i++)
+        assert_equal(InitThread(waiters + i, "waiter", stress_event_waiter, &event), true, "InitThread failed");
+
+    // let them all block before the one signal
+    struct timespec pause = { 0, 50 * 1000000L };
+    nanosleep(&pause, NULL);
+    SignalEvent(&event);
+
+    for (int i = 0; i < 4; i++) {
+        void *ret = NULL;
+        assert_equal(WaitThreadComplete(waiters + i, STRESS_WAIT_MSEC + 1000, &ret), true, "waiter did not finish");
+        assert_equal(ret == &event, true, "waiter missed the signal");
+    }
+    DestroyEvent(&event);
+}
@@ -0,0 +1,38 @@
+#ifndef ThreadStress_H
+#define ThreadStress_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    int threads;                /* pool threads taking part in a run */
+    long ops;                   /* operations per run, shared out between the threads */
+    int yieldOneIn;             /* yield or spin before about one in this many operations, 0 never */
+    uint64_t seed;
+} STRESS_CONFIG_T;
+
+typedef struct {
+    bool ok;                    /* every invariant held and no wait timed out */
+    char error[160];            /* first failure when not ok */
+    long ops;
+    uint64_t elapsedNs;
+    long wakeCount;             /* wake-up latency samples, from a post to the waiter running */
+    double wakeP50Ns;
+    double wakeP99Ns;
+    double wakeMaxNs;
+} STRESS_RESULT_T;
+
+typedef void (*STRESS_SCENARIO_FN)(const STRESS_CONFIG_T *config, STRESS_RESULT_T *result);
+
+typedef struct {
+    const char *name;
+    STRESS_SCENARIO_FN fn;
+} STRESS_SCENARIO_T;
+
+/* NULL terminated. Every scenario needs the thread pool and uses at most config->threads of its threads */
+extern const STRESS_SCENARIO_T StressScenarios[];
+
+void StressReport(FILE *f, const char *name, const STRESS_CONFIG_T *config, const STRESS_RESULT_T *result);
+
+#endif // ThreadStress_H
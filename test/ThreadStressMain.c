@@ -0,0 +1,102 @@
+/**
+ * @file   ThreadStressMain.c
+ * @brief   Runs the thread stress scenarios across thread counts
+ *
+ * Every scenario in StressScenarios runs once per thread count and prints its throughput, wake-up latency
+ * and whether its invariants held. Thread counts need as many pool threads; build with a bigger pool for
+ * more, e.g. make clean stress THREAD_POOL_SIZE=130 STRESS_ARGS=--threads=64,128
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fnmatch.h>
+#include <time.h>
+#include "ThreadStress.h"
+#include "Threads.h"
+#include "Logger.h"
+
+#define STRESS_MAX_COUNTS 32
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --threads=N,N,...   thread counts to run, default 2,4,8,16,32\n"
+            "  --ops=N             operations per run, default 100000\n"
+            "  --yield=N           yield or spin before about one in N operations, 0 never, default 16\n"
+            "  --scenario=glob     run only matching scenarios\n"
+            "  --seed=S\n",
+            prog);
+}
+
+static int parse_counts(char *list, int *counts)
+{
+    int n = 0;
+    for (char *tok = strtok(list, ","); tok != NULL && n < STRESS_MAX_COUNTS; tok = strtok(NULL, ","))
+        counts[n++] = atoi(tok);
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    int counts[STRESS_MAX_COUNTS] = { 2, 4, 8, 16, 32 };
+    int countCount = 5;
+    STRESS_CONFIG_T config = { 0, 100000, 16, (uint64_t)time(NULL) };
+    const char *filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        char *a = argv[i];
+        if (strncmp(a, "--threads=", 10) == 0) countCount = parse_counts(a + 10, counts);
+        else if (strncmp(a, "--ops=", 6) == 0) config.ops = atol(a + 6);
+        else if (strncmp(a, "--yield=", 8) == 0) config.yieldOneIn = atoi(a + 8);
+        else if (strncmp(a, "--scenario=", 11) == 0) filter = a + 11;
+        else if (strncmp(a, "--seed=", 7) == 0) config.seed = strtoull(a + 7, NULL, 0);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    LogSetConfig(LOG_LEVEL_WARNING, "%(asctime)s [%(levelname)s] [%(funcName)s]: %(message)s");
+    LogAddAppender(LogAppenderStderr, true);
+    if (!InitThreadPool()) {
+        fprintf(stderr, "failed to initialize the thread pool\n");
+        return 1;
+    }
+
+    printf("thread stress: %ld ops per run, yield one in %d, seed %llu, pool of %d threads\n", config.ops,
+           config.yieldOneIn, (unsigned long long)config.seed, THREAD_POOL_SIZE);
+
+    int failures = 0;
+    for (const STRESS_SCENARIO_T *s = StressScenarios; s->name != NULL; s++) {
+        if (filter != NULL && fnmatch(filter, s->name, 0) != 0)
+            continue;
+        for (int c = 0; c < countCount; c++) {
+            config.threads = counts[c];
+            if (config.threads < 1)
+                continue;
+            if (config.threads > THREAD_POOL_SIZE) {
+                printf("%-18s threads %3d  skipped, needs THREAD_POOL_SIZE >= %d\n", s->name, config.threads,
+                       config.threads);
+                continue;
+            }
+            STRESS_RESULT_T result;
+            s->fn(&config, &result);
+            StressReport(stdout, s->name, &config, &result);
+            fflush(stdout);
+            if (!result.ok)
+                failures++;
+        }
+    }
+
+    DestroyThreadPool(5000);
+    if (failures) {
+        printf("FAILED, %d runs broke an invariant. replay with --seed=%llu\n", failures,
+               (unsigned long long)config.seed);
+        return 1;
+    }
+    return 0;
+}
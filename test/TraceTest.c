@@ -0,0 +1,111 @@
+// Trace rings and their Chrome trace event JSON
+#include <stdlib.h>
+#include <string.h>
+#include "Eeyore.h"
+#include "Threads.h"
+#include "Trace.h"
+
+// occurrences of needle in haystack
+static int count_of(const char* haystack, const char* needle){
+    int count = 0;
+    for(const char* p = strstr(haystack, needle); p != NULL; p = strstr(p + 1, needle)){
+        count++;
+    }
+    return count;
+}
+
+static char* dump_trace(void){
+    char* text = NULL;
+    size_t size = 0;
+    FILE* f = open_memstream(&text, &size);
+    TraceDumpJson(f);
+    fclose(f);
+    return text;
+}
+
+static void* trace_task(void* context){
+    TraceBegin(TRACE_CATEGORY_USER, "work", "inside", 7);
+    TraceEnd(TRACE_CATEGORY_USER, "work");
+    return context;
+}
+
+TEST_WITH_THREAD_POOL(test_trace_thread_pool){
+
+    test_setup();
+
+    TraceReset();
+    TraceSetThreadName("test \"main\"");
+    TraceEnable(TRACE_CATEGORY_ALL & ~TRACE_CATEGORY_LOG);
+
+    for(int i = 0; i < 3; i++){
+        THREAD_T thread;
+        assert_equal(InitThread(&thread, "traced", trace_task, NULL), true, "InitThread failed");
+        assert_equal(WaitThreadComplete(&thread, 1000, NULL), true, "thread did not complete");
+    }
+
+    TraceEnable(0);
+    TraceBegin(TRACE_CATEGORY_USER, "not recorded", NULL, 0);
+
+    char* text = dump_trace();
+    assert_not_null(strstr(text, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), "JSON header");
+    assert_not_null(strstr(text, "\"name\":\"test \\\"main\\\"\""), "thread name should be escaped");
+    assert_not_null(strstr(text, "\"name\":\"pool thread "), "pool threads should be named");
+    // idle pool threads are still blocked in a wait, so some spans are open, but no end comes without its begin
+    assert_less_than(count_of(text, "\"ph\":\"E\","), count_of(text, "\"ph\":\"B\",") + 1, "unmatched span end");
+    assert_equal(count_of(text, "\"name\":\"task\""), 6, "every run should be a task span");
+    assert_equal(count_of(text, "\"name\":\"work\""), 6, "user spans inside the tasks");
+    assert_equal(count_of(text, "\"ph\":\"s\","), 3, "a flow should start at every InitThread");
+    assert_equal(count_of(text, "\"ph\":\"f\","), 3, "and end in the task it started");
+    assert_equal(count_of(text, "\"name\":\"completed\""), 3, "completion instants");
+    assert_not_null(strstr(text, "\"args\":{\"label\":\"inside\",\"value\":7}"), "label and value");
+    assert_null(strstr(text, "not recorded"), "nothing is recorded while disabled");
+    free(text);
+
+    TraceReset();
+}
+
+TEST(test_trace_ring_wraps){
+
+    test_setup();
+
+    TraceReset();
+    TraceEnable(TRACE_CATEGORY_USER);
+
+    // the begin of the outer span is overwritten, its end must not be written alone
+    TraceBegin(TRACE_CATEGORY_USER, "outer", NULL, 0);
+    for(int i = 0; i < TRACE_RING_EVENTS; i++){
+        TraceInstant(TRACE_CATEGORY_USER, "tick", NULL, i);
+    }
+    TraceEnd(TRACE_CATEGORY_USER, "outer");
+    TraceEnable(0);
+
+    char* text = dump_trace();
+    assert_null(strstr(text, "\"name\":\"outer\""), "orphan end should be dropped");
+    assert_equal(count_of(text, "\"name\":\"tick\""), TRACE_RING_EVENTS - 1, "the newest events are kept");
+    assert_null(strstr(text, "\"value\":0}"), "the oldest tick is overwritten");
+    free(text);
+
+    TraceReset();
+}
+
+// a reset leaves a live thread's ring to it and only hides the events it had written
+TEST(test_trace_reset_live_ring){
+
+    test_setup();
+
+    TraceReset();
+    TraceEnable(TRACE_CATEGORY_USER);
+
+    TraceInstant(TRACE_CATEGORY_USER, "before", NULL, 1);
+    TraceInstant(TRACE_CATEGORY_USER, "before", NULL, 2);
+    TraceReset();
+    TraceInstant(TRACE_CATEGORY_USER, "after", NULL, 3);
+    TraceEnable(0);
+
+    char* text = dump_trace();
+    assert_null(strstr(text, "\"name\":\"before\""), "events before the reset should be dropped");
+    assert_equal(count_of(text, "\"name\":\"after\""), 1, "events after the reset are kept");
+    free(text);
+
+    TraceReset();
+}
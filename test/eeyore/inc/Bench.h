@@ -0,0 +1,205 @@
+/**
+ * @file   Bench.h
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Microbenchmarks for Eeyore. Even slower than expected, probably...
+ *
+ * A benchmark is declared with BENCH(name) anywhere in a test source and registers itself at start up.
+ * The body runs its measured code bench->iterations times; bench_run() calibrates the iteration count,
+ * warms up, takes samples and reports median, MAD and min per iteration in ns and cycles.
+ *
+ * @code
+
+    BENCH(reverse_64)
+    {
+        unsigned char buf[64] = {0};
+        bench_loop(bench) {
+            ReverseBits(buf, sizeof(buf));
+            bench_do_not_optimize(buf);
+        }
+    }
+
+ * @endcode
+ */
+
+#ifndef Bench_H
+#define Bench_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLES 1
+#else
+#define BENCH_HAVE_CYCLES 0
+#endif
+
+#define BENCH_MAX_COUNT         128
+#define BENCH_DEFAULT_SAMPLES   25
+#define BENCH_DEFAULT_SAMPLE_US 2000
+#define BENCH_WARMUP_SAMPLES    3
+
+/**
+ * @brief  Benchmark state handed to a BENCH body
+ */
+typedef struct {
+    uint64_t iterations;        /**< @brief number of times the body must run the measured code */
+    const char* name;           /**< @brief benchmark name */
+    uint64_t bytes;             /**< @brief optional, set by the body: bytes processed per iteration */
+} BENCH_T;
+
+typedef void (*BENCH_FN_T)(BENCH_T* bench);
+
+/**
+ * @brief  Hardware counters
+ */
+typedef enum {
+    BENCH_COUNTER_CYCLES = 0,           /**< @brief core cycles, unlike the TSC these follow frequency scaling */
+    BENCH_COUNTER_INSTRUCTIONS,
+    BENCH_COUNTER_CACHE_MISSES,         /**< @brief last level cache misses */
+    BENCH_COUNTER_BRANCH_MISSES,
+    BENCH_COUNTER_COUNT
+} BENCH_COUNTER_ID_T;
+
+/**
+ * @brief  Open hardware counters of the calling thread. fd is -1 for a counter that could not be opened
+ */
+typedef struct {
+    int fd[BENCH_COUNTER_COUNT];
+} BENCH_COUNTERS_T;
+
+/**
+ * @brief  Statistics of one benchmark, per iteration
+ */
+typedef struct {
+    const char* name;
+    uint64_t iterations;        /**< @brief calibrated iterations per sample */
+    int samples;
+    double medianNs;
+    double madNs;               /**< @brief median absolute deviation */
+    double minNs;
+    double medianCycles;        /**< @brief TSC reference cycles; negative when not available */
+    double madCycles;
+    double minCycles;
+    uint64_t bytes;             /**< @brief bytes per iteration as set by the body, 0 if not */
+    double counters[BENCH_COUNTER_COUNT];   /**< @brief median hardware counts per iteration; negative when not counted */
+} BENCH_RESULT_T;
+
+/**
+ * @brief  Declare and register a benchmark
+ *
+ * Expands to the head of a function taking BENCH_T* bench. The registration runs before main().
+ */
+#define BENCH(name) \
+    static void bench_##name(BENCH_T* bench); \
+    static void __attribute__((constructor)) bench_register_##name(void){ bench_register(#name, bench_##name); } \
+    static void bench_##name(BENCH_T* bench)
+
+/**
+ * @brief  Loop the measured code bench->iterations times
+ */
+#define bench_loop(bench)   for(uint64_t bench_iteration_ = 0; bench_iteration_ < (bench)->iterations; bench_iteration_++)
+
+/**
+ * @brief  Keep the compiler from optimizing away the computation that produced the memory at p
+ */
+static inline void bench_do_not_optimize(const void* p){
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+/**
+ * @brief  Compiler barrier: memory is assumed to be read and written here
+ */
+static inline void bench_clobber(void){
+    __asm__ volatile("" : : : "memory");
+}
+
+static inline uint64_t bench_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t bench_now_cycles(void){
+#if BENCH_HAVE_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief  Register a benchmark. Normally done by BENCH()
+ */
+void bench_register(const char* name, BENCH_FN_T fn);
+
+/**
+ * @brief  Set the number of samples and the target duration of one sample
+ *
+ * @param samples   measured samples per benchmark
+ * @param sampleUs  the iteration count is calibrated so one sample lasts at least this long
+ */
+void bench_configure(int samples, int sampleUs);
+
+/**
+ * @brief  Measure the hardware counters of every sample in bench_run(). Off by default
+ */
+void bench_set_counters(bool enable);
+
+/**
+ * @brief  Open the hardware counters for the calling thread, disabled and at zero
+ *
+ * Falls back quietly: counters the kernel refuses are left at fd -1. A warning naming the reason is
+ * printed the first time none can be opened.
+ *
+ * @return   true if at least one counter is open
+ */
+bool bench_counters_open(BENCH_COUNTERS_T* counters);
+
+/**
+ * @brief  Zero and enable the open counters
+ */
+void bench_counters_start(BENCH_COUNTERS_T* counters);
+
+/**
+ * @brief  Disable the open counters and read them
+ *
+ * @param values   counts since bench_counters_start(), scaled up if the kernel multiplexed the counters;
+ *                 -1 for a counter that is not open
+ */
+void bench_counters_stop(BENCH_COUNTERS_T* counters, double values[BENCH_COUNTER_COUNT]);
+
+void bench_counters_close(BENCH_COUNTERS_T* counters);
+
+/**
+ * @brief  Short name of a counter, e.g. "branch-misses"
+ */
+const char* bench_counter_name(BENCH_COUNTER_ID_T id);
+
+/**
+ * @brief  Run registered benchmarks
+ *
+ * @param filter   fnmatch() glob on the benchmark name; NULL runs all of them
+ *
+ * @return   number of benchmarks run
+ */
+int bench_run(const char* filter);
+
+/**
+ * @brief  Result of a benchmark that has run, or NULL
+ */
+const BENCH_RESULT_T* bench_result(const char* name);
+
+/**
+ * @brief  Print a table of every benchmark result. Prints nothing if no benchmark has run.
+ */
+void bench_report(FILE* f);
+
+// statistics helpers. values is sorted in place
+double bench_median(double* values, int count);
+double bench_mad(const double* values, int count, double median);
+
+#endif   // Bench_H
@@ -16,12 +16,58 @@
 #include<errno.h>
 #include<string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include "Logger.h"
+#include "Bench.h"
 
 
-extern int unit_test_count;
-extern int unit_test_fail_count;
-extern int unit_test_current_test_fail_count;
+// atomic so asserts may be hit from several threads of a test
+extern atomic_int unit_test_count;
+extern atomic_int unit_test_fail_count;
+extern atomic_int unit_test_current_test_fail_count;
+
+#define TEST_MAX_COUNT              256
+#define TEST_DEFAULT_TIMEOUT_MSEC   60000
+
+typedef void (*UNIT_TEST_FN_T)(void);
+
+#define TEST_NEEDS_THREAD_POOL      0x01    /**< @brief the test uses InitThread, so a pool is set up around it */
+#define TEST_EXCLUSIVE              0x02    /**< @brief the test measures time, so it runs alone after the parallel tests */
+
+/**
+ * @brief  Declare and register a test
+ *
+ * Expands to the head of the test function. The registration runs before main(), so a test only has to be
+ * compiled and linked in to be run.
+ *
+ * @code
+
+    TEST(test_sky)
+    {
+        test_setup();
+        assert_str_equal(getSkyColor(), "azure", "sky color is not azure");
+    }
+
+ * @endcode
+ */
+#define TEST_WITH_FLAGS(name, flags) \
+    static void name(void); \
+    static void __attribute__((constructor)) test_register_##name(void){ test_register(#name, name, flags); } \
+    static void name(void)
+
+#define TEST(name)                  TEST_WITH_FLAGS(name, 0)
+#define TEST_WITH_THREAD_POOL(name) TEST_WITH_FLAGS(name, TEST_NEEDS_THREAD_POOL)
+#define TEST_PERF(name)             TEST_WITH_FLAGS(name, TEST_EXCLUSIVE)
+
+/**
+ * @brief  Options for test_run()
+ */
+typedef struct {
+    int jobs;           /**< @brief tests run at the same time; 0 uses one per CPU */
+    int timeoutMsec;    /**< @brief a test running longer is killed and failed; 0 for no limit */
+    bool isolate;       /**< @brief run each test in its own forked process. if false tests run serially in process */
+    const char* filter; /**< @brief fnmatch() glob on the test name; NULL runs every test */
+} TEST_RUN_OPTIONS_T;
 
 // Series of hackish asserts to look sorta like a unit test
 void unit_assert_equal( int actual, int expected, const char*msg, const char* file, const char* func, int line );
@@ -35,10 +81,50 @@ void unit_assert_str_equal( const char* actual, const char* expected, const char
 void unit_assert_mem_equal(void* actual, void* expected, size_t size, const char*msg, const char* file, const char* func, int line  );
 bool unit_assert_not_null( void* ptr, const char*msg, const char* file, const char* func, int line );
 bool unit_assert_null( void* ptr, const char*msg, const char* file, const char* func, int line );
+void unit_assert_throughput_at_least( double bytes, double ns, double noise, const char* key, double tolerance, const char* file, const char* func, int line );
+void unit_assert_bench_throughput_at_least( const char* bench, double bytesPerIteration, const char* key, double tolerance, const char* file, const char* func, int line );
+void unit_assert_latency_p99_below( const double* samplesNs, int count, const char* key, double tolerance, const char* file, const char* func, int line );
 void test_initialize(LOG_LEVEL level);
+// the test framework's own log format and stderr appender, for tests that change them
+void test_log_config(LOG_LEVEL level);
+
+// what test_log_capture() routes the log to: the newest entry, its level and a count of entries
+extern char test_log_last_entry[LOG_BUFFER_MAX_SIZE];
+extern LOG_LEVEL test_log_last_level;
+extern atomic_int test_log_entries;
+void test_log_appender_capture(const char* entry, LOG_LEVEL level);
+// format as the leader, the capture appender alone and nothing captured yet. test_log_config() undoes it
+void test_log_capture(LOG_LEVEL level, const char* format);
 void unit_test_setup( const char* func);
 int test_result(void);
 
+/**
+ * @brief  Add a test function to the set run by test_run(). Normally done by TEST()
+ *
+ * @param flags   TEST_NEEDS_THREAD_POOL or 0
+ */
+void test_register(const char* name, UNIT_TEST_FN_T fn, int flags);
+
+/**
+ * @brief  Print the names of the registered tests matching filter (NULL for all), one per line
+ */
+void test_list(FILE* f, const char* filter);
+
+/**
+ * @brief  Run the registered tests
+ *
+ * With isolation every test runs in a forked child process, up to options->jobs at a time, so a crash, a
+ * hang or a leak stays within its test. Tests flagged TEST_NEEDS_THREAD_POOL get a thread pool initialized
+ * before and destroyed after them; the others skip spawning its threads.
+ * The output of each test is collected and printed in one piece when it ends, followed by its wall-clock
+ * time. Counts are added to the totals reported by test_result().
+ *
+ * @param options   run options; NULL runs isolated with one job per CPU and the default timeout
+ *
+ * @return   number of tests that failed
+ */
+int test_run(const TEST_RUN_OPTIONS_T* options);
+
 
 #define assert_equal( actual, expected, msg)  {unit_assert_equal( actual, expected, msg, __FILE__, __func__, __LINE__);}
 
@@ -58,6 +144,34 @@ int test_result(void);
 #define assert_null( ptr, msg)  unit_assert_null( ptr, msg, __FILE__, __func__, __LINE__)
 
 
+/*
+ * Performance assertions compare a measurement with the value stored under key in the baseline file and fail
+ * on a regression larger than tolerance (0.5 = 50%) that is also clear of the measurement noise. Baselines are
+ * kept per host class, the CPU model and count, so one file serves several machines; a key with no baseline
+ * for this host class fails. In update mode (test_set_baseline_update) the measurement is written to the
+ * baseline file instead of being checked.
+ */
+#define assert_throughput_at_least( bytes, ns, key, tolerance)  {unit_assert_throughput_at_least( bytes, ns, 0, key, tolerance, __FILE__, __func__, __LINE__);}
+#define assert_bench_throughput_at_least( bench, bytesPerIteration, key, tolerance)  {unit_assert_bench_throughput_at_least( bench, bytesPerIteration, key, tolerance, __FILE__, __func__, __LINE__);}
+#define assert_latency_p99_below( samplesNs, count, key, tolerance)  {unit_assert_latency_p99_below( samplesNs, count, key, tolerance, __FILE__, __func__, __LINE__);}
+
+#define TEST_DEFAULT_BASELINE_FILE  "perf_baselines.txt"
+
+/**
+ * @brief  Select the baseline file used by the performance assertions
+ */
+void test_set_baseline_file(const char* path);
+
+/**
+ * @brief  When update is true the performance assertions rewrite their baselines instead of checking them
+ */
+void test_set_baseline_update(bool update);
+
+/**
+ * @brief  Look up and record baselines under name instead of the CPU model and count of this machine
+ */
+void test_set_host_class(const char* name);
+
 #define test_setup() {unit_test_setup(__func__);}
 
 #endif   // Eeyore_H
@@ -22,6 +22,7 @@
  */
 typedef struct {
     bool flag;                          /**< @brief flag that determines if the event is called or not */
+    unsigned generation;                /**< @brief count of signals, so every waiter blocked at a signal sees it */
     pthread_mutex_t mutex;              /**< @brief event mutex lock */
     pthread_condattr_t attr;            /**< @brief attribute for condition  */
     pthread_cond_t cond;                /**< @brief event conditional var */
@@ -56,7 +57,8 @@ void DestroyEvent(EVENT_T *e);
 /**
  * @brief  Signal an event
  *
- * The event is signaled. All thatwait will be signaled
+ * The event is signaled. All that wait will be signaled. If nobody is waiting, the signal is kept for the
+ * next WaitForEvent(), which clears it
  *
  * @param e            pointer to a EVENT_T type that represents the event instance
  *
@@ -0,0 +1,112 @@
+/**
+ * @file   Histogram.h
+ * @date   October 2026
+ * @version 0.1
+ * @brief   HDR style latency histogram
+ *
+ * Values below 128 are counted exactly. Above that every power of two range is split into 64 linear
+ * buckets, so a value is kept to within 1/64 (1.6%) across the whole 64 bit range. The histogram is a
+ * fixed size struct: recording is a shift, a count increment and a max update, with no allocation.
+ *
+ * A histogram has a single writer. Counts are stored with relaxed atomics so another thread may merge or
+ * query it while it is recorded into. Keep one per thread and merge them when reading.
+ *
+ * @code
+
+    HISTOGRAM_T h;
+    HistogramInit(&h);
+    HistogramRecord(&h, end - start);
+    ...
+    HistogramPrint(stdout, &h, "dispatch", 1000.0, "us");
+
+ * @endcode
+ */
+
+#ifndef Histogram_H
+#define Histogram_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BUCKET_BITS   7
+#define HISTOGRAM_SUB_BUCKETS       (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_HALF_BUCKETS      (HISTOGRAM_SUB_BUCKETS / 2)
+#define HISTOGRAM_COUNTS            ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_HALF_BUCKETS + HISTOGRAM_HALF_BUCKETS)
+
+/**
+ * @brief  Histogram of unsigned 64 bit values, typically nanoseconds
+ */
+typedef struct {
+    uint64_t totalCount;
+    uint64_t sum;                           /**< @brief for the mean; wraps after 2^64 */
+    uint64_t min;                           /**< @brief UINT64_MAX while empty */
+    uint64_t max;
+    uint64_t counts[HISTOGRAM_COUNTS];
+} HISTOGRAM_T;
+
+/**
+ * @brief  Index of the bucket counting value
+ */
+static inline int HistogramIndex(uint64_t value){
+    if(value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    return shift * HISTOGRAM_HALF_BUCKETS + (int)(value >> shift);
+}
+
+#define HISTOGRAM_ADD(field, n)  __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+/**
+ * @brief  Count one value. Only the thread owning h may call this
+ */
+static inline void HistogramRecord(HISTOGRAM_T* h, uint64_t value){
+    HISTOGRAM_ADD(h->counts[HistogramIndex(value)], 1);
+    HISTOGRAM_ADD(h->totalCount, 1);
+    HISTOGRAM_ADD(h->sum, value);
+    if(value < h->min) __atomic_store_n(&h->min, value, __ATOMIC_RELAXED);
+    if(value > h->max) __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  Empty a histogram. A zero filled histogram must be initialized before use
+ */
+void HistogramInit(HISTOGRAM_T* h);
+
+/**
+ * @brief  Add the counts of from into into. from may be recorded into meanwhile
+ */
+void HistogramMerge(HISTOGRAM_T* into, const HISTOGRAM_T* from);
+
+/**
+ * @brief  Value at or below which percentile percent of the values fall
+ *
+ * The result is the highest value its bucket stands for, capped at the maximum seen. 0 when empty.
+ *
+ * @param percentile   0 to 100
+ */
+uint64_t HistogramPercentile(const HISTOGRAM_T* h, double percentile);
+
+double HistogramMean(const HISTOGRAM_T* h);
+
+/**
+ * @brief  Print one line: count, min, mean, p50, p90, p99, p99.9 and max
+ *
+ * @param label     printed first
+ * @param scale     values are divided by scale, e.g. 1000.0 to print nanoseconds as microseconds
+ * @param unit      printed after the values
+ */
+void HistogramPrint(FILE* f, const HISTOGRAM_T* h, const char* label, double scale, const char* unit);
+
+/**
+ * @brief  Print the percentile distribution as text, one percentile per line, halving the distance to 100%
+ */
+void HistogramPrintDistribution(FILE* f, const HISTOGRAM_T* h, double scale, const char* unit);
+
+/**
+ * @brief  Write the histogram as one JSON object
+ *
+ * Holds name, count, min, mean, max, the usual percentiles and the non empty buckets as
+ * [lowest value, highest value, count] triples so it can be merged or plotted later. Values are unscaled.
+ */
+void HistogramWriteJson(FILE* f, const HISTOGRAM_T* h, const char* name);
+
+#endif   // Histogram_H
@@ -0,0 +1,138 @@
+/**
+ * @file   LogBinary.h
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Binary logging with deferred formatting
+ *
+ * LogBinary() takes a level, a printf format and up to LOG_BINARY_MAX_ARGS arguments like LogMessage(), but
+ * formats nothing. Every call site gets a static descriptor holding its file, function, line, format and the
+ * argument types, picked at compile time with _Generic. A call copies the site id, the time, the thread and
+ * the raw argument values into the binary log; strings are copied, up to LOG_BINARY_STRING_MAX bytes.
+ * A '*' width or precision takes the next argument, an integer, as printf does.
+ * The first call of a site also writes its descriptor into the log, so the log alone is enough to decode.
+ *
+ * LogBinaryDecode(), or the LogDecode tool, turns a log back into text through the LogSetConfig() leader
+ * format. Without an open binary log LogBinary() formats the message and hands it to LogMessage().
+ *
+ * @code
+
+    LogBinaryOpen("debug.bin");
+    LogBinary(LOG_LEVEL_DEBUG, "packet %u from %s took %.3f ms", id, peer, ms);
+    ...
+    LogBinaryClose();
+
+    $ test/LogDecode.out --format="%(asctime)s [%(levelname)s] %(message)s" debug.bin
+
+ * @endcode
+ *
+ * The log is written in the byte order of the machine, decode it on the same architecture.
+ */
+
+#ifndef LogBinary_H
+#define LogBinary_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Logger.h"
+
+#define LOG_BINARY_MAX_ARGS     8
+#define LOG_BINARY_STRING_MAX   1024
+#ifndef LOG_BINARY_BUFFER_SIZE
+#define LOG_BINARY_BUFFER_SIZE  (64 * 1024)    // written out when full, at LogBinaryFlush() and at close
+#endif
+
+typedef enum{
+    LOG_BINARY_TYPE_END = 0,
+    LOG_BINARY_TYPE_INT,                // any signed integer, 8 bytes
+    LOG_BINARY_TYPE_UINT,               // any unsigned integer, 8 bytes
+    LOG_BINARY_TYPE_DOUBLE,             // float, double and long double, as 8 byte double
+    LOG_BINARY_TYPE_STRING,             // 2 byte length and the characters
+    LOG_BINARY_TYPE_POINTER,            // any other pointer, 8 bytes
+}LOG_BINARY_TYPE;
+
+typedef union{
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char* s;
+    const void* p;
+}LOG_BINARY_VALUE;
+
+typedef struct{
+    uint32_t id;                        // number in the log named by generation
+    uint32_t generation;                // the log the site was last written to, 0 for none
+    const char* file;
+    const char* funcName;
+    int line;
+    const char* format;
+    unsigned char types[LOG_BINARY_MAX_ARGS + 1];   // ends with LOG_BINARY_TYPE_END
+}LOG_BINARY_SITE;
+
+/**
+ * @brief  Start a binary log, replacing the file
+ * @return false if the file could not be created or a log is open
+ */
+bool LogBinaryOpen(const char* path);
+
+/**
+ * @brief  Write the buffered records to the file
+ */
+void LogBinaryFlush(void);
+
+/**
+ * @brief  Flush and close the binary log. Later LogBinary() calls go to LogMessage()
+ */
+void LogBinaryClose(void);
+
+/**
+ * @brief  Write every record of a binary log as a text entry through the current LogSetConfig() format,
+ *         one per line
+ * @return   number of entries, or -1 if the input is not a binary log or is cut short
+ */
+long LogBinaryDecode(FILE* in, FILE* out);
+
+#define LogBinary(_level, ...)  {LOG_SITE_DEFINE(_logSite); if(LOG_SITE_ENABLED(_logSite, _level)){ \
+    static LOG_BINARY_SITE _logBinarySite = { 0, 0, __FILE__, __func__, __LINE__, LOG_BINARY_FIRST(__VA_ARGS__), \
+        { LOG_BINARY_EACH(LOG_BINARY_TYPE_OF, __VA_ARGS__) LOG_BINARY_TYPE_END } }; \
+    LOG_BINARY_VALUE _logBinaryValues[] = { LOG_BINARY_EACH(LOG_BINARY_VALUE_OF, __VA_ARGS__) {0} }; \
+    _LogBinaryEx(&_logBinarySite, _level, _logBinaryValues);}}
+
+void _LogBinaryEx(LOG_BINARY_SITE* site, LOG_LEVEL level, const LOG_BINARY_VALUE* values);
+
+static inline LOG_BINARY_VALUE _LogBinaryInt(int64_t v){ LOG_BINARY_VALUE value; value.i = v; return value; }
+static inline LOG_BINARY_VALUE _LogBinaryUint(uint64_t v){ LOG_BINARY_VALUE value; value.u = v; return value; }
+static inline LOG_BINARY_VALUE _LogBinaryDouble(double v){ LOG_BINARY_VALUE value; value.d = v; return value; }
+static inline LOG_BINARY_VALUE _LogBinaryString(const char* v){ LOG_BINARY_VALUE value; value.s = v; return value; }
+static inline LOG_BINARY_VALUE _LogBinaryPointer(const void* v){ LOG_BINARY_VALUE value; value.p = v; return value; }
+
+#define LOG_BINARY_GENERIC(_x, _int, _uint, _double, _string, _pointer) _Generic((_x), \
+    _Bool: _uint, char: _int, signed char: _int, unsigned char: _uint, short: _int, unsigned short: _uint, \
+    int: _int, unsigned: _uint, long: _int, unsigned long: _uint, long long: _int, unsigned long long: _uint, \
+    float: _double, double: _double, long double: _double, char*: _string, const char*: _string, \
+    default: _pointer)
+
+#define LOG_BINARY_TYPE_OF(_x)  LOG_BINARY_GENERIC(_x, LOG_BINARY_TYPE_INT, LOG_BINARY_TYPE_UINT, \
+    LOG_BINARY_TYPE_DOUBLE, LOG_BINARY_TYPE_STRING, LOG_BINARY_TYPE_POINTER),
+#define LOG_BINARY_VALUE_OF(_x) LOG_BINARY_GENERIC(_x, _LogBinaryInt, _LogBinaryUint, _LogBinaryDouble, \
+    _LogBinaryString, _LogBinaryPointer)(_x),
+
+// the format, then apply _m to every argument after it
+#define LOG_BINARY_FIRST(...)                   LOG_BINARY_FIRST_(__VA_ARGS__, 0)
+#define LOG_BINARY_FIRST_(_f, ...)              _f
+#define LOG_BINARY_COUNT(...)                   LOG_BINARY_COUNT_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_BINARY_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _n, ...)  _n
+#define LOG_BINARY_CAT(_a, _b)                  LOG_BINARY_CAT_(_a, _b)
+#define LOG_BINARY_CAT_(_a, _b)                 _a##_b
+#define LOG_BINARY_EACH(_m, ...)                LOG_BINARY_CAT(LOG_BINARY_EACH_, LOG_BINARY_COUNT(__VA_ARGS__))(_m, __VA_ARGS__)
+#define LOG_BINARY_EACH_1(_m, _f)
+#define LOG_BINARY_EACH_2(_m, _f, _a)           _m(_a)
+#define LOG_BINARY_EACH_3(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_2(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_4(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_3(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_5(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_4(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_6(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_5(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_7(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_6(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_8(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_7(_m, _f, __VA_ARGS__)
+#define LOG_BINARY_EACH_9(_m, _f, _a, ...)      _m(_a) LOG_BINARY_EACH_8(_m, _f, __VA_ARGS__)
+
+#endif   // LogBinary_H
@@ -0,0 +1,98 @@
+/**
+ * @file   LogKV.h
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Structured logging: typed key value fields written as logfmt or JSON
+ *
+ * LogKV() takes a level, an event name and any number of typed fields. The fields are written straight into
+ * the message as logfmt or JSON, with no format string to parse and no printf: integers through a table of
+ * digit pairs, keys copied as they are and only string values escaped. The message then goes through the
+ * LogSetConfig() leader and the appenders like any LogMessage(), and has the same call site level, rate
+ * limit and repeat folding.
+ *
+ * @code
+
+    LogKV(LOG_LEVEL_INFO, "thread_start", KV_INT("thread", i), KV_STR("name", name), KV_BOOL("pooled", true));
+
+    event=thread_start thread=3 name="pool worker" pooled=true                  LOG_KV_LOGFMT
+    {"event":"thread_start","thread":3,"name":"pool worker","pooled":true}      LOG_KV_JSON
+
+ * @endcode
+ *
+ * Keys must be string literals that need no escaping in either format, e.g. identifiers: they are measured at
+ * compile time and copied. A NULL string is an empty value in logfmt and null in JSON.
+ */
+
+#ifndef LogKV_H
+#define LogKV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Logger.h"
+
+typedef enum{
+    LOG_KV_LOGFMT = 0,              // event=name key=value key="quoted value", the default
+    LOG_KV_JSON,                    // one JSON object, the event as "event"
+}LOG_KV_FORMAT;
+
+typedef enum{
+    LOG_KV_TYPE_END = 0,
+    LOG_KV_TYPE_INT,
+    LOG_KV_TYPE_UINT,
+    LOG_KV_TYPE_STRING,
+    LOG_KV_TYPE_BOOL,
+}LOG_KV_TYPE;
+
+typedef struct{
+    const char* key;
+    uint16_t keyLength;
+    uint16_t type;                  // LOG_KV_TYPE
+    union{
+        int64_t i;
+        uint64_t u;
+        const char* s;
+        bool b;
+    }value;
+}LOG_KV;
+
+/**
+ * @brief  Write later LogKV() calls as format
+ */
+void LogKVSetFormat(LOG_KV_FORMAT format);
+
+/**
+ * @brief  The message LogKV() logs for event and fields, ending with a LOG_KV_TYPE_END field. Too long for size,
+ *         it ends after the last field that fits whole, with the JSON object or the event's quote still closed
+ * @return   length of the message
+ */
+int LogKVFormat(char* buffer, size_t size, const char* event, const LOG_KV* fields);
+
+#define KV_INT(_key, _value)    _LogKVInt("" _key, sizeof(_key) - 1, _value)
+#define KV_UINT(_key, _value)   _LogKVUint("" _key, sizeof(_key) - 1, _value)
+#define KV_STR(_key, _value)    _LogKVString("" _key, sizeof(_key) - 1, _value)
+#define KV_BOOL(_key, _value)   _LogKVBool("" _key, sizeof(_key) - 1, _value)
+
+// the event, then the fields after it
+#define LogKV(_level, ...)  {LOG_SITE_DEFINE(_logSite); if(LOG_SITE_ENABLED(_logSite, _level)){ \
+    const LOG_KV _logKVFields[] = { LOG_KV_REST(__VA_ARGS__, {0}) }; \
+    _LogKVEx(&_logSite, _level, LOG_KV_FIRST(__VA_ARGS__, 0), _logKVFields);}}
+
+#define LOG_KV_FIRST(_event, ...)   _event
+#define LOG_KV_REST(_event, ...)    __VA_ARGS__
+
+void _LogKVEx(LOG_SITE* site, LOG_LEVEL level, const char* event, const LOG_KV* fields);
+
+static inline LOG_KV _LogKVInt(const char* key, size_t keyLength, int64_t v){
+    LOG_KV kv = { key, (uint16_t)keyLength, LOG_KV_TYPE_INT, { 0 } }; kv.value.i = v; return kv;
+}
+static inline LOG_KV _LogKVUint(const char* key, size_t keyLength, uint64_t v){
+    LOG_KV kv = { key, (uint16_t)keyLength, LOG_KV_TYPE_UINT, { 0 } }; kv.value.u = v; return kv;
+}
+static inline LOG_KV _LogKVString(const char* key, size_t keyLength, const char* v){
+    LOG_KV kv = { key, (uint16_t)keyLength, LOG_KV_TYPE_STRING, { 0 } }; kv.value.s = v; return kv;
+}
+static inline LOG_KV _LogKVBool(const char* key, size_t keyLength, bool v){
+    LOG_KV kv = { key, (uint16_t)keyLength, LOG_KV_TYPE_BOOL, { 0 } }; kv.value.b = v; return kv;
+}
+
+#endif   // LogKV_H
@@ -10,6 +10,9 @@
 #include <syslog.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
 
 typedef enum{
     LOG_LEADER_VAR_TYPE_NONE = 0,
@@ -30,9 +33,12 @@ typedef enum{
 #define LOG_LEADER_VAR_TYPE_TAG_MESSAGE     "message"
 
 
+// LogSetConfig() compiles its format into the preamble and a list of these: a variable and the literal
+// text up to the next one, emitted as they are
 typedef struct{
     LOG_LEADER_VAR_TYPE type;
     const char* trailer;
+    size_t trailerLength;
 }LOG_LEADER_ENTRY;
 
 // this enum cross defines a subset of syslog error levels.
@@ -51,7 +57,9 @@ typedef enum{
 #define LOG_BUFFER_MAX_SIZE  4096
 #define LOG_INVALID_LEADER_CONFIG_MSG "INVALID LEADER CONFIG: "
 #define LOG_MAX_APPENDERS  10
-#define LOG_HEX_MAX_LINE_CHARS 30
+#define LOG_HEX_DEFAULT_WIDTH 16
+#define LOG_HEX_MAX_WIDTH 64
+#define LOG_HEX_DEFAULT_MAX_BYTES 512
 #define LOG_HEX_MAX_HEADER_LEN 50
 
 #define KNRM  "\x1B[0m"
@@ -66,26 +74,259 @@ typedef enum{
 
 typedef struct{
     LOG_LEVEL thresholdLevel;
-    const char* configString;
+    const char* format;             // as given to LogSetConfig(), NULL for the default
+    const char* configString;       // format cut into the preamble and trailers
     const char* preamble;
+    size_t preambleLength;
     LOG_LEADER_ENTRY leaderEntry[LOG_LEADER_VAR_MAX];
     void (*logAppender[LOG_MAX_APPENDERS])(const char* entry, LOG_LEVEL level);
 }LOG_CONFIG;
 
-extern LOG_CONFIG current_log_config;
+// where and when an entry was logged, for the leader
+typedef struct{
+    const char* file;
+    const char* funcName;
+    LOG_LEVEL level;
+    const struct timespec* time;    // CLOCK_REALTIME, NULL for now
+    long thread;                    // as %(thread)s shows it, -1 for the calling thread
+}LOG_ENTRY_ORIGIN;
+
+// every LogMessage(), LogHex() and LogBinary() call has one of these. Its threshold is resolved from the level
+// rules on the first call and again whenever the rules or the LogSetConfig() level change, so a disabled
+// call costs one load and a compare
+typedef struct LOG_SITE{
+    const char* module;             // LOG_MODULE_NAME where the call is
+    const char* file;
+    const char* funcName;
+    int line;
+    int threshold;                  // highest level logged here, LOG_SITE_UNRESOLVED before the first call
+    struct LOG_SITE* next;          // resolved sites, for the next rule change
+    // storm control, see LogSetRateLimit() and LogSetRepeatFolding()
+    uint64_t rateTat;               // theoretical arrival time of the next message, CLOCK_MONOTONIC ns
+    uint64_t rateSuppressed;        // dropped by the rate limit since the last summary
+    uint64_t lastHash;              // of the last message let through
+    uint64_t repeats;               // folded since the last summary
+}LOG_SITE;
+
+#define LOG_SITE_UNRESOLVED     0x7fffffff
+#define LOG_MAX_LEVEL_RULES     16
+
+#define LOG_SITE_DEFINE(_site)  static LOG_SITE _site = { LOG_MODULE_NAME, __FILE__, __func__, __LINE__, LOG_SITE_UNRESOLVED, NULL, 0, 0, 0, 0 }
+#define LOG_SITE_ENABLED(_site, _level)  ((int)(_level) <= __atomic_load_n(&(_site).threshold, __ATOMIC_RELAXED) && \
+    (__atomic_load_n(&(_site).threshold, __ATOMIC_RELAXED) != LOG_SITE_UNRESOLVED || _LogSiteResolve(&(_site), _level)))
 
-#define LogMessage(_level, ...)  {if(_level <= current_log_config.thresholdLevel)_LogMessageEx( __FILE__, __func__, _level,  __VA_ARGS__ );}
-#define LogHex(_level, _header, _data, _length)  {if(_level <= current_log_config.thresholdLevel)_LogHexEx( __FILE__, __func__, _level, _header, _data, _length );}
+#define LogMessage(_level, ...)  {LOG_SITE_DEFINE(_logSite); if(LOG_SITE_ENABLED(_logSite, _level))_LogSiteMessageEx( &_logSite, _level,  __VA_ARGS__ );}
+#define LogHex(_level, _header, _data, _length)  {LOG_SITE_DEFINE(_logSite); if(LOG_SITE_ENABLED(_logSite, _level))_LogHexEx( __FILE__, __func__, _level, _header, _data, _length );}
 
+/**
+ * LogSetConfig() and LogAddAppender() publish a new config while other threads log, which goes on with the
+ * old one until it returns: logging takes no lock for it. Neither may be called from an appender
+ */
 void LogSetConfig(LOG_LEVEL level, const char* format );
 void LogAddAppender(void (*appender)(const char*, LOG_LEVEL), bool clearAppenders);
 
+/**
+ * @brief  Log calls in modules matching the glob up to level, in place of the LogSetConfig() level. The module
+ *         is the LOG_MODULE_NAME defined before Logger.h is included. Takes effect at once, in every thread
+ * @return false if LOG_MAX_LEVEL_RULES rules are set
+ */
+bool LogSetModuleLevel(const char* moduleGlob, LOG_LEVEL level);
+
+/**
+ * @brief  As LogSetModuleLevel() for calls in source files matching the glob, by path as compiled or by name
+ */
+bool LogSetFileLevel(const char* fileGlob, LOG_LEVEL level);
+
+/**
+ * @brief  Drop the module and file rules: every call goes back to the LogSetConfig() level
+ */
+void LogClearLevels(void);
+
+/**
+ * Storm control, per LogMessage() call site and off by default. Both only count with lock free operations on
+ * the site, and what they hold back is reported, never dropped silently: a site logs "N messages suppressed
+ * by the rate limit" when it is let through again and "last message repeated N times" before its next
+ * different message. LogReportSuppressed() reports what every site still holds.
+ */
+
+/**
+ * @brief  Let each call site log perSecond messages a second on average, in bursts of up to burst.
+ *         perSecond 0 turns the limit off
+ */
+void LogSetRateLimit(int perSecond, int burst);
+
+/**
+ * @brief  Fold a message identical to the last one from the same call site into a count
+ */
+void LogSetRepeatFolding(bool fold);
+
+/**
+ * @brief  Log the summaries of the messages every call site has held back so far
+ */
+void LogReportSuppressed(void);
+
+/**
+ * @brief  Messages held back since the start, by the rate limit and by folding. Either pointer may be NULL
+ */
+void LogSuppressedCounts(uint64_t* rateLimited, uint64_t* folded);
+
+/**
+ * @brief  Take %(asctime)s from CLOCK_REALTIME_COARSE where there is one: no system call, but only as
+ *         fine as the kernel tick, typically 1 to 4 ms. Off by default
+ */
+void LogSetCoarseClock(bool coarse);
+
+/**
+ * @brief  LogHex() layout: bytesPerLine bytes in each line of the dump, up to LOG_HEX_MAX_WIDTH, and at most
+ *         maxBytes of the data, further cut to what fits in one entry. 0 keeps the default
+ *
+ * In asynchronous mode an entry is LOG_ASYNC_ENTRY_SIZE, so a dump there keeps to the whole lines that fit beside
+ * the leader and ends with the count of bytes left out
+ */
+void LogSetHexDump(int bytesPerLine, int maxBytes);
+
+/**
+ * @brief  Build an entry as LogMessage() would, with the current config, for a message logged elsewhere or
+ *         earlier. Cut to size - 1 characters
+ * @return   length of the entry
+ */
+int LogFormatEntry(char* buffer, size_t size, const LOG_ENTRY_ORIGIN* origin, const char* format, ...);
+
+/**
+ * @brief  The calling thread as %(thread)s shows it
+ */
+unsigned LogThreadTag(void);
+
+/**
+ * Asynchronous mode. LogMessage() still formats on the calling thread, then copies the entry into a lock free
+ * multi producer ring and returns; a flusher thread hands the entries to the appenders in batches, in the
+ * order they were claimed. Entries longer than LOG_ASYNC_ENTRY_SIZE - 1 are cut and end in "...".
+ * Messages logged by the appenders themselves, on the flusher thread, go out synchronously.
+ */
+#ifndef LOG_ASYNC_ENTRY_SIZE
+#define LOG_ASYNC_ENTRY_SIZE        512
+#endif
+#define LOG_ASYNC_DEFAULT_CAPACITY  1024    // entries
+#define LOG_ASYNC_BATCH             64      // entries the flusher drains between checks
+
+// what LogMessage() does when the ring is full
+typedef enum{
+    LOG_ASYNC_BLOCK = 0,            // wait for the flusher to make room
+    LOG_ASYNC_DROP,                 // drop the message, only counted in LogAsyncDropped()
+    LOG_ASYNC_DROP_COUNT,           // drop it and log a warning with the number dropped once there is room
+}LOG_ASYNC_POLICY;
+
+/**
+ * @brief  Start the flusher. capacity is rounded up to a power of two, 0 takes LOG_ASYNC_DEFAULT_CAPACITY.
+ *         The ring is drained at exit; flushOnCrash also drains it from SIGSEGV, SIGBUS, SIGILL, SIGFPE and
+ *         SIGABRT handlers, best effort, before the signal takes its default action.
+ * @return false if async mode is already on or the ring or thread could not be made
+ */
+bool LogAsyncStart(int capacity, LOG_ASYNC_POLICY policy, bool flushOnCrash);
+
+/**
+ * @brief  Deliver everything queued, stop the flusher and go back to synchronous logging
+ */
+void LogAsyncStop(void);
+
+/**
+ * @brief  Return once every message logged before the call has reached the appenders. No-op when synchronous
+ */
+void LogFlush(void);
+
+/**
+ * @brief  Messages dropped on a full ring since LogAsyncStart()
+ */
+uint64_t LogAsyncDropped(void);
+
+/**
+ * Buffered file appender. LogAppenderFile() copies the entry into one of LOG_FILE_CHUNKS chunks of the buffer
+ * and returns; a writer thread hands the filled chunks to the kernel with a single writev once half of them are
+ * full, every flushMsec, at LogFileFlush() and at close. It waits only when every chunk is full. Rotation and
+ * fdatasync happen on the writer thread as well.
+ */
+#define LOG_FILE_CHUNKS                 4
+#define LOG_FILE_DEFAULT_BUFFER         (256 * 1024)
+#define LOG_FILE_DEFAULT_FLUSH_MSEC     1000
+
+typedef enum{
+    LOG_FILE_SYNC_NONE = 0,         // leave it to the kernel
+    LOG_FILE_SYNC_ERRORS,           // an entry of LOG_LEVEL_ERROR or worse is written out and synced at once
+    LOG_FILE_SYNC_ALWAYS,           // fdatasync after every write out
+}LOG_FILE_SYNC;
+
+typedef struct{
+    const char* path;               // appended to if it exists
+    size_t bufferSize;              // 0 for LOG_FILE_DEFAULT_BUFFER, at least LOG_FILE_CHUNKS entries
+    int flushMsec;                  // longest an entry waits in the buffer, 0 for LOG_FILE_DEFAULT_FLUSH_MSEC
+    LOG_FILE_SYNC sync;
+    size_t maxBytes;                // start a new file before a write out would take it past this, 0 never
+    int maxFiles;                   // rotated files kept as path.1 (newest) to path.maxFiles
+    bool colour;                    // wrap entries in an ANSI colour per level
+}LOG_FILE_CONFIG;
+
+/**
+ * @brief  Open the file LogAppenderFile() writes to and start its writer thread. Add the appender with
+ *         LogAddAppender(LogAppenderFile, ...)
+ * @return false if a file is open or the file, buffer or thread could not be made
+ */
+bool LogFileOpen(const LOG_FILE_CONFIG* config);
+
+/**
+ * @brief  Return once every entry appended before the call has been written to the file
+ */
+void LogFileFlush(void);
+
+/**
+ * @brief  Write out the buffer and close the file. LogAppenderFile() drops entries until the next open
+ */
+void LogFileClose(void);
+
+/**
+ * Flight recorder. LogAppenderRecorder() copies entries into fixed size slots of a memory mapped circular
+ * file: a slot is reserved with one atomic add on a counter kept in the file, and nothing else is shared, so
+ * there is no lock and no system call. The mapping is shared with the page cache, so the last entries survive
+ * a crash or SIGKILL of the process, though not of the machine. An entry being written when the process
+ * died is left out. Entries longer than the slot are cut.
+ */
+#define LOG_RECORDER_DEFAULT_SIZE   (4 * 1024 * 1024)
+#define LOG_RECORDER_DEFAULT_SLOT   256
+
+/**
+ * @brief  Map the recorder file, creating it as size bytes of slotSize byte slots; 0 takes the defaults. A file
+ *         left by an earlier run with the same sizes is carried on, so its entries stay until overwritten
+ * @return false if a recorder is open or the file could not be mapped
+ */
+bool LogRecorderOpen(const char* path, size_t size, size_t slotSize);
+
+/**
+ * @brief  Unmap the recorder once the log calls writing to it have returned. LogAppenderRecorder() drops entries
+ *         until the next open. Not from an appender
+ */
+void LogRecorderClose(void);
+
+/**
+ * @brief  Write the entries of a recorder file to out, oldest first, one per line. Safe while it is written
+ * @return   number of entries, or -1 if the file is not a recorder
+ */
+long LogRecorderRead(const char* path, FILE* out);
+
 void _LogMessageEx(const char* file, const char* func, LOG_LEVEL level, const char * format, ... );
+bool _LogSiteResolve(LOG_SITE* site, LOG_LEVEL level);
+void _LogSiteMessageEx(LOG_SITE* site, LOG_LEVEL level, const char * format, ... );
+void _LogSiteTextEx(LOG_SITE* site, LOG_LEVEL level, const char* text);
+bool _LogAsyncPost(const char* entry, LOG_LEVEL level);
+bool _LogAsyncActive(void);
+const LOG_CONFIG* _LogConfigEnter(unsigned* epoch);
+void _LogConfigExit(unsigned epoch);
+void _LogConfigDrain(void);
 void _LogHexEx(const char* file, const char* funcName, LOG_LEVEL level, char *header, uint8_t *data, int length);
 
 void LogAppenderStdout ( const char* entry, LOG_LEVEL level);
 void LogAppenderStderr ( const char* entry, LOG_LEVEL level);
 void LogAppenderSyslog ( const char* entry, LOG_LEVEL level);
+void LogAppenderFile ( const char* entry, LOG_LEVEL level);
+void LogAppenderRecorder ( const char* entry, LOG_LEVEL level);
 
 
 #ifndef LOG_MODULE_NAME
@@ -13,7 +13,9 @@
 #include <stdbool.h>
 #include "Events.h"
 
-#define THREAD_POOL_SIZE 50
+#ifndef THREAD_POOL_SIZE
+#define THREAD_POOL_SIZE 50     /* build with -DTHREAD_POOL_SIZE=N for more */
+#endif
 
 /**
  * @brief  Thread
@@ -55,6 +57,9 @@ bool DestroyThreadPool(int timeout);
  * @brief  Initialize a Thread and begin processing
  *
  * The Thread is created and handler begins processing after completion of this routine.
+ * Every thread started must be waited for with WaitThreadComplete(): the thread returns to the pool only once
+ * its completion has been collected, so a thread that is never waited for keeps its pool slot until
+ * DestroyThreadPool().
  *
  * @param t         pointer to a THREAD_T type that represents the thread instance
  * @param name      name that we will call the thread for log purposes
@@ -93,6 +98,8 @@ bool InitThread(THREAD_T *t, const char* name, void* (*handler)(void*), void* co
  * @brief  Wait completion of an thread object
  *
  * This routine will return after handler function (provided at InitThread) has completed  or the timeout has expired
+ * On a timeout the thread is given up: it returns to the pool when the handler finishes, its result is dropped,
+ * and t must not be waited for again.
  *
  * @param t       pointer to a THREAD_T type that represents the thread instance
  * @param msec    number of milliseconds to wait upon thread completion
@@ -0,0 +1,109 @@
+/**
+ * @file   Trace.h
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Timeline tracing into per thread ring buffers, dumped as Chrome trace event JSON
+ *
+ * Spans and instants are recorded into a ring buffer owned by the recording thread, so recording takes no
+ * lock: a clock read and a store. A disabled category costs one load and a branch at the call site, like a
+ * LogMessage() below the threshold. Once full, a ring overwrites its oldest events.
+ *
+ * The pool threads record allocation, handler runs and completion of their tasks, the semaphores and
+ * events record the waits that actually block, and the logger can record every LogMessage() call.
+ * TraceDumpJson() writes the rings in the Chrome trace event format; load the file in chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * @code
+
+    TraceEnable(TRACE_CATEGORY_ALL);
+    ...
+    TraceBegin(TRACE_CATEGORY_USER, "decode", NULL, 0);
+    ...
+    TraceEnd(TRACE_CATEGORY_USER, "decode");
+    ...
+    TraceDumpJsonFile("trace.json");
+
+ * @endcode
+ */
+
+#ifndef Trace_H
+#define Trace_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS       8192        /* per thread, a power of two. 56 bytes each */
+#endif
+#define TRACE_LABEL_LENGTH      30
+
+#define TRACE_CATEGORY_THREADS  0x01        /* thread pool task allocation, runs and completion */
+#define TRACE_CATEGORY_WAITS    0x02        /* semaphore and event waits that block */
+#define TRACE_CATEGORY_LOG      0x04        /* LogMessage() calls */
+#define TRACE_CATEGORY_USER     0x08        /* application spans */
+#define TRACE_CATEGORY_ALL      0xFF
+
+/**
+ * @brief  Kind of a trace event, the Chrome trace event phase
+ */
+typedef enum {
+    TRACE_PHASE_BEGIN       = 'B',
+    TRACE_PHASE_END         = 'E',
+    TRACE_PHASE_INSTANT     = 'i',
+    TRACE_PHASE_FLOW_START  = 's',          /* an arrow from here to the span holding the matching flow end */
+    TRACE_PHASE_FLOW_END    = 'f',
+} TRACE_PHASE;
+
+extern unsigned trace_categories;
+
+#define TRACE_ON(_category)     ((_category) & __atomic_load_n(&trace_categories, __ATOMIC_RELAXED))
+
+/**
+ * @brief  Record events. name must be a string literal or otherwise outlive the trace; label is copied,
+ *         up to TRACE_LABEL_LENGTH characters, and may be NULL.
+ *
+ * value is shown with the label in the event's arguments. Flow events pair by id.
+ */
+#define TraceBegin(_category, _name, _label, _value)    {if(TRACE_ON(_category))_TraceEventEx(TRACE_PHASE_BEGIN, _name, _label, _value, _category);}
+#define TraceEnd(_category, _name)                      {if(TRACE_ON(_category))_TraceEventEx(TRACE_PHASE_END, _name, NULL, 0, _category);}
+#define TraceInstant(_category, _name, _label, _value)  {if(TRACE_ON(_category))_TraceEventEx(TRACE_PHASE_INSTANT, _name, _label, _value, _category);}
+#define TraceFlowStart(_category, _name, _id)           {if(TRACE_ON(_category))_TraceEventEx(TRACE_PHASE_FLOW_START, _name, NULL, _id, _category);}
+#define TraceFlowEnd(_category, _name, _id)             {if(TRACE_ON(_category))_TraceEventEx(TRACE_PHASE_FLOW_END, _name, NULL, _id, _category);}
+
+/**
+ * @brief  Select the categories recorded from now on. 0 stops tracing; recorded events are kept
+ */
+void TraceEnable(unsigned categories);
+
+/**
+ * @brief  Name the calling thread in the timeline. The name is copied
+ */
+void TraceSetThreadName(const char* name);
+
+/**
+ * @brief  Write every ring as a Chrome trace event JSON object
+ *
+ * Rings are read while their threads may still record: stop tracing or let the threads go quiet first,
+ * or the newest events of a busy thread may be torn. An end whose begin was overwritten is left out.
+ *
+ * @return   number of events written
+ */
+long TraceDumpJson(FILE* f);
+
+/**
+ * @brief  TraceDumpJson() into a new file
+ *
+ * @return   true if the file was written
+ */
+bool TraceDumpJsonFile(const char* path);
+
+/**
+ * @brief  Drop every recorded event. Rings of exited threads are freed; the others are left to their threads and
+ *         only their events from before the reset are hidden
+ */
+void TraceReset(void);
+
+void _TraceEventEx(TRACE_PHASE phase, const char* name, const char* label, uint64_t value, unsigned category);
+
+#endif   // Trace_H
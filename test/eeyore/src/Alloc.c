@@ -7,6 +7,8 @@
 
 
 
+#define LOG_MODULE_NAME     "Alloc"
+
 #include "Alloc.h"
 #include "Logger.h"
 #include <stdio.h>
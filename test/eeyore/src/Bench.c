@@ -0,0 +1,354 @@
+/**
+ * @file   Bench.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Microbenchmarks for Eeyore. Even slower than expected, probably...
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "Bench.h"
+#include "Logger.h"
+
+typedef struct {
+    const char* name;
+    BENCH_FN_T fn;
+    bool ran;
+    BENCH_RESULT_T result;
+} BENCH_ENTRY_T;
+
+static BENCH_ENTRY_T bench_entries[BENCH_MAX_COUNT];
+static int bench_count = 0;
+static int bench_samples = BENCH_DEFAULT_SAMPLES;
+static int bench_sample_us = BENCH_DEFAULT_SAMPLE_US;
+static bool bench_use_counters = false;
+static bool bench_counters_warned = false;
+
+static const char* bench_counter_names[BENCH_COUNTER_COUNT] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+};
+
+#ifdef __linux__
+static const uint64_t bench_counter_configs[BENCH_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// user space counter of the calling thread on any CPU, created disabled
+static int bench_perf_event_open(uint64_t config){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static int bench_compare_double(const void* a, const void* b){
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+double bench_median(double* values, int count){
+    if(count <= 0) return 0;
+    qsort(values, count, sizeof(double), bench_compare_double);
+    if(count % 2) return values[count / 2];
+    return (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+double bench_mad(const double* values, int count, double median){
+    if(count <= 0) return 0;
+    double* deviations = malloc(count * sizeof(double));
+    if(deviations == NULL) return 0;
+    for(int i = 0; i < count; i++){
+        deviations[i] = values[i] > median ? values[i] - median : median - values[i];
+    }
+    double mad = bench_median(deviations, count);
+    free(deviations);
+    return mad;
+}
+
+void bench_register(const char* name, BENCH_FN_T fn){
+    if(bench_count >= BENCH_MAX_COUNT){
+        fprintf(stderr, "%sERROR! too many benchmarks, %s not registered%s\n", KMAG, name, KNRM);
+        return;
+    }
+    bench_entries[bench_count].name = name;
+    bench_entries[bench_count].fn = fn;
+    bench_entries[bench_count].ran = false;
+    bench_count++;
+}
+
+void bench_configure(int samples, int sampleUs){
+    if(samples > 0) bench_samples = samples;
+    if(sampleUs > 0) bench_sample_us = sampleUs;
+}
+
+void bench_set_counters(bool enable){
+    bench_use_counters = enable;
+}
+
+const char* bench_counter_name(BENCH_COUNTER_ID_T id){
+    return id >= 0 && id < BENCH_COUNTER_COUNT ? bench_counter_names[id] : "?";
+}
+
+bool bench_counters_open(BENCH_COUNTERS_T* counters){
+
+    bool any = false;
+    int error = ENOSYS;
+
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+        counters->fd[i] = -1;
+#ifdef __linux__
+        counters->fd[i] = bench_perf_event_open(bench_counter_configs[i]);
+        if(counters->fd[i] >= 0){
+            any = true;
+        } else {
+            error = errno;
+        }
+#endif
+    }
+
+    if(!any && !bench_counters_warned){
+        bench_counters_warned = true;
+        fprintf(stderr, "%sWARNING: hardware counters not available: %s%s%s\n", KYEL, strerror(error),
+                error == EACCES || error == EPERM ? ", see /proc/sys/kernel/perf_event_paranoid" : "", KNRM);
+    }
+    return any;
+}
+
+void bench_counters_start(BENCH_COUNTERS_T* counters){
+#ifdef __linux__
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+        if(counters->fd[i] < 0) continue;
+        ioctl(counters->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void bench_counters_stop(BENCH_COUNTERS_T* counters, double values[BENCH_COUNTER_COUNT]){
+
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+        values[i] = -1;
+    }
+#ifdef __linux__
+    // stop them all before reading so each covers the same region
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+        if(counters->fd[i] >= 0) ioctl(counters->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+        uint64_t data[3];       // value, time enabled, time running
+        if(counters->fd[i] < 0 || read(counters->fd[i], data, sizeof(data)) != sizeof(data)) continue;
+        if(data[2] == 0) continue;
+        // with more counters than the PMU has, the kernel time shares them; extrapolate to the whole region
+        values[i] = data[2] < data[1] ? (double)data[0] * data[1] / data[2] : (double)data[0];
+    }
+#endif
+}
+
+void bench_counters_close(BENCH_COUNTERS_T* counters){
+    for(int i = 0; i < BENCH_COUNTER_COUNT; i++){
+#ifdef __linux__
+        if(counters->fd[i] >= 0) close(counters->fd[i]);
+#endif
+        counters->fd[i] = -1;
+    }
+}
+
+// time one sample of the given number of iterations. counters may be NULL, otherwise their counts are read into values
+static void bench_sample(BENCH_ENTRY_T* entry, uint64_t iterations, double* ns, double* cycles,
+                         BENCH_COUNTERS_T* counters, double values[BENCH_COUNTER_COUNT]){
+
+    BENCH_T bench = { iterations, entry->name, 0 };
+
+    // the counters are started outside the timed region so the ioctls do not count as benchmark time
+    if(counters != NULL) bench_counters_start(counters);
+    bench_clobber();
+    uint64_t c0 = bench_now_cycles();
+    uint64_t t0 = bench_now_ns();
+    entry->fn(&bench);
+    uint64_t t1 = bench_now_ns();
+    uint64_t c1 = bench_now_cycles();
+    bench_clobber();
+    if(counters != NULL) bench_counters_stop(counters, values);
+
+    *ns = (double)(t1 - t0);
+    *cycles = (double)(c1 - c0);
+    entry->result.bytes = bench.bytes;
+}
+
+// double the iteration count until one sample lasts the target time
+static uint64_t bench_calibrate(BENCH_ENTRY_T* entry){
+
+    double target = bench_sample_us * 1000.0;
+    uint64_t iterations = 1;
+    double ns, cycles;
+
+    for(;;){
+        bench_sample(entry, iterations, &ns, &cycles, NULL, NULL);
+        if(ns >= target || iterations >= (1ULL << 40)) break;
+        if(ns < target / 64){
+            iterations *= 16;
+        } else {
+            iterations *= 2;
+        }
+    }
+    return iterations;
+}
+
+static void bench_run_entry(BENCH_ENTRY_T* entry, BENCH_COUNTERS_T* counters){
+
+    uint64_t iterations = bench_calibrate(entry);
+    double* ns = malloc(bench_samples * sizeof(double));
+    double* cycles = malloc(bench_samples * sizeof(double));
+    double* counts = malloc(bench_samples * BENCH_COUNTER_COUNT * sizeof(double));
+    double unused_ns, unused_cycles;
+
+    if(ns == NULL || cycles == NULL || counts == NULL){
+        free(ns);
+        free(cycles);
+        free(counts);
+        return;
+    }
+
+    for(int i = 0; i < BENCH_WARMUP_SAMPLES; i++){
+        bench_sample(entry, iterations, &unused_ns, &unused_cycles, NULL, NULL);
+    }
+
+    // counts holds one column of samples per counter
+    double values[BENCH_COUNTER_COUNT];
+    for(int i = 0; i < bench_samples; i++){
+        bench_sample(entry, iterations, &ns[i], &cycles[i], counters, values);
+        ns[i] /= iterations;
+        cycles[i] /= iterations;
+        for(int c = 0; c < BENCH_COUNTER_COUNT; c++){
+            counts[c * bench_samples + i] = counters != NULL ? values[c] / iterations : -1;
+        }
+    }
+
+    BENCH_RESULT_T* r = &entry->result;
+    r->name = entry->name;
+    r->iterations = iterations;
+    r->samples = bench_samples;
+    r->medianNs = bench_median(ns, bench_samples);
+    r->madNs = bench_mad(ns, bench_samples, r->medianNs);
+    r->minNs = ns[0];
+    if(BENCH_HAVE_CYCLES){
+        r->medianCycles = bench_median(cycles, bench_samples);
+        r->madCycles = bench_mad(cycles, bench_samples, r->medianCycles);
+        r->minCycles = cycles[0];
+    } else {
+        r->medianCycles = r->madCycles = r->minCycles = -1;
+    }
+    for(int c = 0; c < BENCH_COUNTER_COUNT; c++){
+        double* column = counts + c * bench_samples;
+        r->counters[c] = bench_median(column, bench_samples);
+        // a sample the counter missed is negative and sorts first
+        if(column[0] < 0) r->counters[c] = -1;
+    }
+    entry->ran = true;
+
+    free(ns);
+    free(cycles);
+    free(counts);
+}
+
+int bench_run(const char* filter){
+
+    BENCH_COUNTERS_T counters;
+    bool counting = bench_use_counters && bench_counters_open(&counters);
+
+    int run = 0;
+    for(int i = 0; i < bench_count; i++){
+        BENCH_ENTRY_T* entry = bench_entries + i;
+        if(filter != NULL && fnmatch(filter, entry->name, 0) != 0) continue;
+
+        printf("Bench Begin --------------- %s -------------------------\n", entry->name);
+        bench_run_entry(entry, counting ? &counters : NULL);
+        run++;
+    }
+
+    if(counting) bench_counters_close(&counters);
+    return run;
+}
+
+const BENCH_RESULT_T* bench_result(const char* name){
+    for(int i = 0; i < bench_count; i++){
+        if(bench_entries[i].ran && strcmp(bench_entries[i].name, name) == 0){
+            return &bench_entries[i].result;
+        }
+    }
+    return NULL;
+}
+
+// value / per, or n/a for a negative value
+static void bench_print_count(FILE* f, double value, double per, int width, int precision){
+    if(value >= 0){
+        fprintf(f, "%*.*f ", width, precision, value / per);
+    } else {
+        fprintf(f, "%*s ", width, "n/a");
+    }
+}
+
+void bench_report(FILE* f){
+
+    bool header = false;
+    for(int i = 0; i < bench_count; i++){
+        if(!bench_entries[i].ran) continue;
+        const BENCH_RESULT_T* r = &bench_entries[i].result;
+
+        if(!header){
+            fprintf(f, "%-32s %12s %10s %12s %10s %10s %12s\n", "benchmark", "iterations", "ns median", "ns MAD",
+                    "ns min", "cyc median", "cyc MAD");
+            header = true;
+        }
+        fprintf(f, "%-32s %12llu %10.2f %12.2f %10.2f ", r->name, (unsigned long long)r->iterations,
+                r->medianNs, r->madNs, r->minNs);
+        if(r->medianCycles >= 0){
+            fprintf(f, "%10.1f %12.1f\n", r->medianCycles, r->madCycles);
+        } else {
+            fprintf(f, "%10s %12s\n", "n/a", "n/a");
+        }
+    }
+
+    header = false;
+    for(int i = 0; i < bench_count; i++){
+        if(!bench_entries[i].ran) continue;
+        const BENCH_RESULT_T* r = &bench_entries[i].result;
+        const double* c = r->counters;
+        if(c[BENCH_COUNTER_CYCLES] < 0 && c[BENCH_COUNTER_INSTRUCTIONS] < 0 &&
+           c[BENCH_COUNTER_CACHE_MISSES] < 0 && c[BENCH_COUNTER_BRANCH_MISSES] < 0) continue;
+
+        if(!header){
+            fprintf(f, "\n%-32s %12s %12s %6s %14s %14s %5s\n", "benchmark", "cycles", "instructions", "IPC",
+                    "cache-misses", "branch-misses", "per");
+            header = true;
+        }
+        // misses per byte when the body says how many bytes an iteration processes
+        double per = r->bytes > 0 ? (double)r->bytes : 1;
+        bool ipc = c[BENCH_COUNTER_CYCLES] > 0 && c[BENCH_COUNTER_INSTRUCTIONS] >= 0;
+        fprintf(f, "%-32s ", r->name);
+        bench_print_count(f, c[BENCH_COUNTER_CYCLES], 1, 12, 1);
+        bench_print_count(f, c[BENCH_COUNTER_INSTRUCTIONS], 1, 12, 1);
+        bench_print_count(f, ipc ? c[BENCH_COUNTER_INSTRUCTIONS] / c[BENCH_COUNTER_CYCLES] : -1, 1, 6, 2);
+        bench_print_count(f, c[BENCH_COUNTER_CACHE_MISSES], per, 14, 4);
+        bench_print_count(f, c[BENCH_COUNTER_BRANCH_MISSES], per, 14, 4);
+        fprintf(f, "%5s\n", r->bytes > 0 ? "byte" : "iter");
+    }
+}
@@ -8,17 +8,39 @@
  */
 
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/file.h>
+#include <sys/utsname.h>
 #include <unistd.h>
 #include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <fnmatch.h>
+#include <ctype.h>
 
 #include "Eeyore.h"
 #include "Threads.h"
 
-int unit_test_count = 0;
-int unit_test_fail_count = 0;
-int unit_test_current_test_fail_count = 0;
+atomic_int unit_test_count = 0;
+atomic_int unit_test_fail_count = 0;
+atomic_int unit_test_current_test_fail_count = 0;
+
+typedef struct {
+    const char* name;
+    UNIT_TEST_FN_T fn;
+    int flags;
+} UNIT_TEST_T;
+
+static UNIT_TEST_T unit_tests[TEST_MAX_COUNT];
+static int unit_test_registered = 0;
+
+static const char* unit_baseline_file = TEST_DEFAULT_BASELINE_FILE;
+static bool unit_baseline_update = false;
+static char unit_host_class[96];
 
 // Series of hackish asserts to look sorta like a unit test
 void unit_assert_equal( int actual, int expected, const char*msg, const char* file, const char* func, int line ){
@@ -137,17 +159,271 @@ bool unit_assert_null( void* ptr, const char*msg, const char* file, const char*
     return true;
 }
 
-void test_initialize(LOG_LEVEL level){
+static void unit_test_fail(void){
+    if(unit_test_current_test_fail_count++ == 0 ){
+        unit_test_fail_count++;
+    }
+}
+
+void test_set_baseline_file(const char* path){
+    unit_baseline_file = path;
+}
+
+void test_set_baseline_update(bool update){
+    unit_baseline_update = update;
+}
+
+void test_set_host_class(const char* name){
+    snprintf(unit_host_class, sizeof(unit_host_class), "%s", name);
+}
+
+// the CPU model and the number of CPUs online, e.g. "Intel(R)_Xeon(R)_Processor-8cpu", with no blanks
+static const char* unit_baseline_host(void){
+
+    if(unit_host_class[0] != 0) return unit_host_class;
+
+    char model[64] = "";
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if(f != NULL){
+        char line[256];
+        while(model[0] == 0 && fgets(line, sizeof(line), f) != NULL){
+            char* value = strchr(line, ':');
+            if(value != NULL && strncmp(line, "model name", 10) == 0){
+                value += strspn(value + 1, " \t") + 1;
+                snprintf(model, sizeof(model), "%.*s", (int)strcspn(value, "\n"), value);
+            }
+        }
+        fclose(f);
+    }
+    struct utsname machine;
+    if(model[0] == 0 && uname(&machine) == 0){
+        snprintf(model, sizeof(model), "%.63s", machine.machine);
+    }
+
+    char* at = unit_host_class;
+    for(const char* c = model; *c != 0; c++){
+        char out = isgraph((unsigned char)*c) && *c != '/' ? *c : '_';
+        if(out == '_' && at > unit_host_class && at[-1] == '_') continue;
+        *at++ = out;
+    }
+    snprintf(at, sizeof(unit_host_class) - (at - unit_host_class), "-%ldcpu", sysconf(_SC_NPROCESSORS_ONLN));
+    return unit_host_class;
+}
+
+// baseline lines are "key value noise"; value is bytes/s or ns, noise the relative spread it was recorded with
+static bool unit_baseline_parse(const char* line, const char* key, double* value, double* noise){
+    char name[192];
+    double v = 0, n = 0;
+    int fields = sscanf(line, "%191s %lf %lf", name, &v, &n);
+    if(fields < 2 || name[0] == '#' || strcmp(name, key) != 0) return false;
+    *value = v;
+    *noise = fields > 2 ? n : 0;
+    return true;
+}
+
+static bool unit_baseline_read(const char* key, double* value, double* noise){
+    FILE* f = fopen(unit_baseline_file, "r");
+    if(f == NULL) return false;
+
+    flock(fileno(f), LOCK_SH);
+    char line[256];
+    bool found = false;
+    while(!found && fgets(line, sizeof(line), f) != NULL){
+        found = unit_baseline_parse(line, key, value, noise);
+    }
+    flock(fileno(f), LOCK_UN);
+    fclose(f);
+    return found;
+}
+
+// replace or append the line of key. Tests run in parallel processes, so the file is rewritten in place under flock
+static bool unit_baseline_write(const char* key, double value, double noise){
+    FILE* f = fopen(unit_baseline_file, "a+");
+    if(f == NULL) return false;
+    flock(fileno(f), LOCK_EX);
+
+    char* text = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&text, &size);
+    if(out == NULL){
+        flock(fileno(f), LOCK_UN);
+        fclose(f);
+        return false;
+    }
+
+    char line[256];
+    double unusedValue, unusedNoise;
+    bool replaced = false;
+    rewind(f);
+    while(fgets(line, sizeof(line), f) != NULL){
+        if(unit_baseline_parse(line, key, &unusedValue, &unusedNoise)){
+            if(replaced) continue;
+            fprintf(out, "%s %.6g %.4f\n", key, value, noise);
+            replaced = true;
+        } else {
+            fputs(line, out);
+        }
+    }
+    if(!replaced) fprintf(out, "%s %.6g %.4f\n", key, value, noise);
+    fclose(out);
+
+    bool written = ftruncate(fileno(f), 0) == 0 && fwrite(text, 1, size, f) == size && fflush(f) == 0;
+    free(text);
+    flock(fileno(f), LOCK_UN);
+    fclose(f);
+    return written;
+}
+
+/*
+ * In update mode store the measurement; otherwise fetch the baseline. Baselines are stored per host class, as
+ * "class/key", and a key this host class has no baseline for fails. Returns true when there is something to check
+ */
+static bool unit_baseline_lookup(const char* testKey, double measured, double noise, double* baseline, double* baselineNoise,
+                                 const char* file, const char* func, int line){
+
+    char key[192];
+    snprintf(key, sizeof(key), "%s/%s", unit_baseline_host(), testKey);
+
+    if(unit_baseline_update){
+        if(unit_baseline_write(key, measured, noise)){
+            printf("perf %s: baseline set to %.6g (noise %.2f%%)\n", key, measured, noise * 100);
+        } else {
+            fprintf(stderr, "%sERROR![%s:%s](ln:%d) could not write baseline %s to %s%s\n", KMAG, file, func, line, key, unit_baseline_file, KNRM);
+            unit_test_fail();
+        }
+        return false;
+    }
+    if(!unit_baseline_read(key, baseline, baselineNoise)){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) no baseline for %s in %s, record this host with 'make baselines'%s\n", KMAG, file, func, line, key, unit_baseline_file, KNRM);
+        unit_test_fail();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * A regression must exceed the tolerance by more than three times the combined relative noise of the baseline
+ * and the measurement before it fails, so a noisy machine widens the limit instead of flaking.
+ */
+static double unit_noise_margin(double baselineNoise, double noise){
+    double margin = 3 * sqrt(baselineNoise * baselineNoise + noise * noise);
+    return margin > 0.25 ? 0.25 : margin;
+}
+
+void unit_assert_throughput_at_least( double bytes, double ns, double noise, const char* key, double tolerance, const char* file, const char* func, int line ){
+
+    if(ns <= 0){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) %s: no time measured%s\n", KMAG, file, func, line, key, KNRM);
+        unit_test_fail();
+        return;
+    }
+
+    double measured = bytes / ns * 1e9;
+    double baseline, baselineNoise;
+    if(!unit_baseline_lookup(key, measured, noise, &baseline, &baselineNoise, file, func, line)) return;
+
+    double limit = baseline * (1 - tolerance) * (1 - unit_noise_margin(baselineNoise, noise));
+    if(measured < limit){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) %s regressed; expected at least %.4g B/s (baseline %.4g) received %.4g B/s%s\n",
+                KMAG, file, func, line, key, limit, baseline, measured, KNRM);
+        unit_test_fail();
+    } else {
+        printf("perf %s: %.4g B/s, baseline %.4g, limit %.4g\n", key, measured, baseline, limit);
+    }
+}
+
+void unit_assert_bench_throughput_at_least( const char* bench, double bytesPerIteration, const char* key, double tolerance, const char* file, const char* func, int line ){
+
+    const BENCH_RESULT_T* r = bench_result(bench);
+    if(r == NULL){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) benchmark %s has not run%s\n", KMAG, file, func, line, bench, KNRM);
+        unit_test_fail();
+        return;
+    }
+
+    // standard error of the median, with the MAD scaled to a standard deviation
+    double noise = r->medianNs > 0 ? 1.253 * 1.4826 * r->madNs / r->medianNs / sqrt(r->samples) : 0;
+    unit_assert_throughput_at_least(bytesPerIteration, r->medianNs, noise, key, tolerance, file, func, line);
+}
+
+static int unit_compare_double(const void* a, const void* b){
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+void unit_assert_latency_p99_below( const double* samplesNs, int count, const char* key, double tolerance, const char* file, const char* func, int line ){
+
+    if(count < 100){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) %s: %d samples are too few for a p99%s\n", KMAG, file, func, line, key, count, KNRM);
+        unit_test_fail();
+        return;
+    }
+
+    double* sorted = malloc(count * sizeof(double));
+    if(sorted == NULL) return;
+    memcpy(sorted, samplesNs, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), unit_compare_double);
+
+    // p99 and the ranks bounding its 95% confidence interval
+    double spread = 1.96 * sqrt(count * 0.99 * 0.01);
+    int rank = (int)ceil(count * 0.99) - 1;
+    int low = (int)floor(count * 0.99 - spread) - 1;
+    int high = (int)ceil(count * 0.99 + spread) - 1;
+    if(low < 0) low = 0;
+    if(high > count - 1) high = count - 1;
+
+    double p99 = sorted[rank];
+    double noise = p99 > 0 ? (sorted[high] - sorted[low]) / 2 / p99 : 0;
+    double lowerBound = sorted[low];
+    free(sorted);
+
+    double baseline, baselineNoise;
+    if(!unit_baseline_lookup(key, p99, noise, &baseline, &baselineNoise, file, func, line)) return;
+
+    // the interval already covers the measurement, so only the baseline's noise widens the limit
+    double limit = baseline * (1 + tolerance) * (1 + unit_noise_margin(baselineNoise, 0));
+    if(lowerBound > limit){
+        fprintf(stderr, "%sERROR![%s:%s](ln:%d) %s regressed; expected p99 below %.4g ns (baseline %.4g) received %.4g ns%s\n",
+                KMAG, file, func, line, key, limit, baseline, p99, KNRM);
+        unit_test_fail();
+    } else {
+        printf("perf %s: p99 %.4g ns, baseline %.4g, limit %.4g\n", key, p99, baseline, limit);
+    }
+}
+
+void test_log_config(LOG_LEVEL level){
 
     LogSetConfig(level, "%(asctime)s [%(levelname)s] [%(funcName)s]: %(message)s" );
     //LogAddAppender(LogAppenderSyslog, true);
     LogAddAppender(LogAppenderStderr, true);
+}
+
+char test_log_last_entry[LOG_BUFFER_MAX_SIZE];
+LOG_LEVEL test_log_last_level;
+atomic_int test_log_entries = 0;
+
+void test_log_appender_capture(const char* entry, LOG_LEVEL level){
+    strncpy(test_log_last_entry, entry, sizeof(test_log_last_entry) - 1);
+    test_log_last_level = level;
+    test_log_entries++;
+}
+
+void test_log_capture(LOG_LEVEL level, const char* format){
+
+    LogSetConfig(level, format);
+    LogAddAppender(test_log_appender_capture, true);
+    test_log_last_entry[0] = 0;
+    test_log_entries = 0;
+}
+
+void test_initialize(LOG_LEVEL level){
+
+    test_log_config(level);
     LogMessage( LOG_LEVEL_INFO, "Testing framework initialized. Oh, bother...");
 
     unit_test_fail_count = 0;
 
-    InitThreadPool();
-
 }
 
 
@@ -167,6 +443,8 @@ int test_result(void){
         unit_test_fail_count++;
     }
 
+    bench_report(stdout);
+
     LogMessage( LOG_LEVEL_INFO, "Total Units tests: %d", unit_test_count);
 
     if(unit_test_fail_count > 0){
@@ -177,3 +455,264 @@ int test_result(void){
     LogMessage( LOG_LEVEL_INFO, "No bother...");
     return 0;
 }
+
+void test_register(const char* name, UNIT_TEST_FN_T fn, int flags){
+    if(unit_test_registered >= TEST_MAX_COUNT){
+        fprintf(stderr, "%sERROR! too many tests, %s not registered%s\n", KMAG, name, KNRM);
+        return;
+    }
+    unit_tests[unit_test_registered].name = name;
+    unit_tests[unit_test_registered].fn = fn;
+    unit_tests[unit_test_registered].flags = flags;
+    unit_test_registered++;
+}
+
+static bool test_selected(const UNIT_TEST_T* test, const char* filter){
+    return filter == NULL || fnmatch(filter, test->name, 0) == 0;
+}
+
+void test_list(FILE* f, const char* filter){
+    for(int i = 0; i < unit_test_registered; i++){
+        if(test_selected(unit_tests + i, filter)) fprintf(f, "%s\n", unit_tests[i].name);
+    }
+}
+
+static uint64_t test_now_msec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// counts reported by a test process to the runner
+typedef struct {
+    int count;
+    int failed;
+} UNIT_TEST_COUNTS_T;
+
+// runs one test, with a fresh thread pool if it needs one, returning what it added to the counters
+static UNIT_TEST_COUNTS_T test_run_one(const UNIT_TEST_T* test){
+
+    int countBefore = unit_test_count;
+    int failBefore = unit_test_fail_count;
+
+    if(!(test->flags & TEST_NEEDS_THREAD_POOL)){
+        test->fn();
+    } else if(!InitThreadPool()){
+        fprintf(stderr, "%sERROR! %s: %s%s\n", KMAG, test->name, "Failed to initialize thread pool", KNRM);
+        unit_test_fail_count++;
+    } else {
+        test->fn();
+        if( !DestroyThreadPool(5000) ){
+            fprintf(stderr, "%sERROR! %s: %s%s\n", KMAG, test->name, "Failed to destroy thread pool", KNRM);
+            if(unit_test_fail_count == failBefore) unit_test_fail_count++;
+        }
+    }
+
+    UNIT_TEST_COUNTS_T counts = { unit_test_count - countBefore, unit_test_fail_count - failBefore };
+    return counts;
+}
+
+static void test_report_end(const char* name, const char* status, uint64_t msec){
+    printf("Test End ------------------ %s %s (%llu ms)\n", name, status, (unsigned long long)msec);
+}
+
+typedef struct {
+    pid_t pid;
+    int test;
+    int resultFd;           // read end of the pipe the child reports its counts on
+    FILE* output;           // the child's stdout and stderr
+    uint64_t start;
+} TEST_CHILD_T;
+
+static bool test_start_child(TEST_CHILD_T* child, int test){
+
+    int fds[2];
+    FILE* output = tmpfile();
+    if(output == NULL || pipe(fds) != 0){
+        if(output) fclose(output);
+        return false;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if(pid < 0){
+        fclose(output);
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if(pid == 0){
+        close(fds[0]);
+        dup2(fileno(output), STDOUT_FILENO);
+        dup2(fileno(output), STDERR_FILENO);
+        setvbuf(stdout, NULL, _IONBF, 0);   // keep stdout and stderr lines in order
+
+        UNIT_TEST_COUNTS_T counts = test_run_one(unit_tests + test);
+
+        fflush(stdout);
+        fflush(stderr);
+        if(write(fds[1], &counts, sizeof(counts)) != sizeof(counts)) _exit(2);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    child->pid = pid;
+    child->test = test;
+    child->resultFd = fds[0];
+    child->output = output;
+    child->start = test_now_msec();
+    return true;
+}
+
+// collect a finished child. status is from waitpid, or timedOut if the runner killed it
+static bool test_finish_child(TEST_CHILD_T* child, int status, bool timedOut){
+
+    const char* name = unit_tests[child->test].name;
+    uint64_t msec = test_now_msec() - child->start;
+    UNIT_TEST_COUNTS_T counts = {0, 0};
+    bool reported = read(child->resultFd, &counts, sizeof(counts)) == sizeof(counts);
+    close(child->resultFd);
+
+    char buffer[4096];
+    size_t len;
+    rewind(child->output);
+    while((len = fread(buffer, 1, sizeof(buffer), child->output)) > 0){
+        fwrite(buffer, 1, len, stdout);
+    }
+    fclose(child->output);
+
+    bool passed = false;
+    if(timedOut){
+        fprintf(stdout, "%sERROR! %s: timed out%s\n", KMAG, name, KNRM);
+        test_report_end(name, "TIMEOUT", msec);
+    } else if(WIFSIGNALED(status)){
+        fprintf(stdout, "%sERROR! %s: crashed with signal %d%s\n", KMAG, name, WTERMSIG(status), KNRM);
+        test_report_end(name, "CRASHED", msec);
+    } else if(!reported){
+        fprintf(stdout, "%sERROR! %s: exited without reporting a result%s\n", KMAG, name, KNRM);
+        test_report_end(name, "FAILED", msec);
+    } else {
+        passed = counts.failed == 0;
+        test_report_end(name, passed ? "PASS" : "FAILED", msec);
+    }
+    fflush(stdout);
+
+    // a test that never reached test_setup() still counts as a test
+    unit_test_count += counts.count > 0 ? counts.count : 1;
+    if(!passed){
+        unit_test_fail_count += counts.failed > 0 ? counts.failed : 1;
+    }
+    return passed;
+}
+
+static int test_run_serial(const int* selected, int count){
+
+    int failed = 0;
+    for(int i = 0; i < count; i++){
+        const UNIT_TEST_T* test = unit_tests + selected[i];
+        uint64_t start = test_now_msec();
+        UNIT_TEST_COUNTS_T counts = test_run_one(test);
+        test_report_end(test->name, counts.failed ? "FAILED" : "PASS", test_now_msec() - start);
+        if(counts.failed) failed++;
+    }
+    return failed;
+}
+
+static int test_run_isolated(const TEST_RUN_OPTIONS_T* options, const int* selected, int count, int jobs){
+
+    if(jobs > count) jobs = count;
+
+    TEST_CHILD_T* children = calloc(jobs > 0 ? jobs : 1, sizeof(TEST_CHILD_T));
+    if(children == NULL) return count;
+
+    int next = 0;
+    int running = 0;
+    int failed = 0;
+
+    while(next < count || running > 0){
+
+        // fill free job slots
+        for(int j = 0; j < jobs && next < count; j++){
+            if(children[j].pid != 0) continue;
+            if(!test_start_child(children + j, selected[next])){
+                fprintf(stderr, "%sERROR! %s: could not start test process%s\n", KMAG, unit_tests[selected[next]].name, KNRM);
+                unit_test_count++;
+                unit_test_fail_count++;
+                failed++;
+            } else {
+                running++;
+            }
+            next++;
+        }
+
+        // reap finished children and enforce timeouts
+        bool reaped = false;
+        for(int j = 0; j < jobs; j++){
+            TEST_CHILD_T* child = children + j;
+            if(child->pid == 0) continue;
+
+            int status = 0;
+            bool timedOut = false;
+            pid_t done = waitpid(child->pid, &status, WNOHANG);
+            if(done == 0 && options->timeoutMsec > 0 && test_now_msec() - child->start > (uint64_t)options->timeoutMsec){
+                kill(child->pid, SIGKILL);
+                waitpid(child->pid, &status, 0);
+                timedOut = true;
+                done = child->pid;
+            }
+            if(done != child->pid) continue;
+
+            if(!test_finish_child(child, status, timedOut)) failed++;
+            child->pid = 0;
+            running--;
+            reaped = true;
+        }
+
+        if(!reaped && running > 0){
+            struct timespec pause = { 0, 1000000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    free(children);
+    return failed;
+}
+
+int test_run(const TEST_RUN_OPTIONS_T* options){
+
+    TEST_RUN_OPTIONS_T defaults = { 0, TEST_DEFAULT_TIMEOUT_MSEC, true, NULL };
+    if(options == NULL) options = &defaults;
+
+    int selected[TEST_MAX_COUNT];
+    int count = 0;
+    for(int i = 0; i < unit_test_registered; i++){
+        if(test_selected(unit_tests + i, options->filter)) selected[count++] = i;
+    }
+    if(count == 0){
+        fprintf(stderr, "%sWARNING! no test matches %s%s\n", KYEL, options->filter ? options->filter : "", KNRM);
+        return 0;
+    }
+
+    if(!options->isolate) return test_run_serial(selected, count);
+
+    int jobs = options->jobs;
+    if(jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(jobs <= 0) jobs = 1;
+
+    // the TEST_EXCLUSIVE tests go last, one at a time, so no other test competes with what they measure
+    int parallel = 0;
+    int exclusive[TEST_MAX_COUNT];
+    int exclusiveCount = 0;
+    for(int i = 0; i < count; i++){
+        if(unit_tests[selected[i]].flags & TEST_EXCLUSIVE) exclusive[exclusiveCount++] = selected[i];
+        else selected[parallel++] = selected[i];
+    }
+
+    int failed = 0;
+    if(parallel > 0) failed += test_run_isolated(options, selected, parallel, jobs);
+    if(exclusiveCount > 0) failed += test_run_isolated(options, exclusive, exclusiveCount, 1);
+    return failed;
+}
@@ -6,8 +6,11 @@
  */
 
 
+#define LOG_MODULE_NAME     "Events"
+
 #include "Events.h"
 #include "Logger.h"
+#include "Trace.h"
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
@@ -46,6 +49,7 @@ bool InitEvent(EVENT_T *e, const char* name)
     pthread_cond_init(&e->cond, &e->attr);
 
     e->flag = false;
+    e->generation = 0;
     memcpy(e->name, name, len);
     e->name[len] = 0;
     return true;
@@ -82,6 +86,7 @@ bool SignalEvent(EVENT_T *e)
     LogMessage(LOG_LEVEL_DEBUG, "Event Signal: %s", e->name);
     pthread_mutex_lock(&e->mutex);
     e->flag = true;
+    e->generation++;
     pthread_cond_broadcast(&e->cond);
     pthread_mutex_unlock(&e->mutex);
 
@@ -126,10 +131,17 @@ bool WaitForEvent(EVENT_T *e, int msec)
     struct timespec waitTime;
     int waitReturn;
 
+    /* the first waiter to wake clears the flag; the others see the generation move on */
+    unsigned generation = e->generation;
+
+    /* only waits that block are traced */
+    bool blocks = !e->flag;
+    if(blocks) TraceBegin(TRACE_CATEGORY_WAITS, "WaitForEvent", e->name, (uintptr_t)e);
+
     if(isTimedWait)
     {
         msecToTimespec(msec, &waitTime);
-        while(!e->flag)
+        while(!e->flag && e->generation == generation)
         {
             waitReturn = pthread_cond_timedwait(&e->cond, &e->mutex, &waitTime);
             if(waitReturn == ETIMEDOUT)
@@ -145,7 +157,7 @@ bool WaitForEvent(EVENT_T *e, int msec)
     }
     else
     {
-        while(!e->flag)
+        while(!e->flag && e->generation == generation)
         {
             waitReturn = pthread_cond_wait(&e->cond, &e->mutex);
             if( waitReturn == EINVAL || waitReturn == EPERM )
@@ -156,7 +168,9 @@ bool WaitForEvent(EVENT_T *e, int msec)
        }
     }
 
-    bool ret = e->flag == true;
+    if(blocks) TraceEnd(TRACE_CATEGORY_WAITS, "WaitForEvent");
+
+    bool ret = e->flag == true || e->generation != generation;
 
     e->flag = false;
 
@@ -0,0 +1,129 @@
+/**
+ * @file   Histogram.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   HDR style latency histogram
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "Histogram.h"
+
+static const double histogram_report_percentiles[] = { 50, 75, 90, 95, 99, 99.9, 99.99 };
+#define HISTOGRAM_REPORT_PERCENTILES (int)(sizeof(histogram_report_percentiles) / sizeof(histogram_report_percentiles[0]))
+
+static uint64_t histogram_load(const uint64_t* p){
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+// lowest and highest value counted by a bucket
+static uint64_t histogram_lowest(int index){
+    if(index < HISTOGRAM_SUB_BUCKETS) return index;
+    int shift = index / HISTOGRAM_HALF_BUCKETS - 1;
+    return (uint64_t)(index - shift * HISTOGRAM_HALF_BUCKETS) << shift;
+}
+
+static uint64_t histogram_highest(int index){
+    if(index < HISTOGRAM_SUB_BUCKETS) return index;
+    int shift = index / HISTOGRAM_HALF_BUCKETS - 1;
+    return histogram_lowest(index) + ((1ULL << shift) - 1);
+}
+
+void HistogramInit(HISTOGRAM_T* h){
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void HistogramMerge(HISTOGRAM_T* into, const HISTOGRAM_T* from){
+
+    uint64_t total = 0;
+    for(int i = 0; i < HISTOGRAM_COUNTS; i++){
+        uint64_t count = histogram_load(from->counts + i);
+        into->counts[i] += count;
+        total += count;
+    }
+    // count from the buckets so the total matches them even while from is being recorded into
+    into->totalCount += total;
+    into->sum += histogram_load(&from->sum);
+
+    uint64_t min = histogram_load(&from->min);
+    uint64_t max = histogram_load(&from->max);
+    if(min < into->min) into->min = min;
+    if(max > into->max) into->max = max;
+}
+
+uint64_t HistogramPercentile(const HISTOGRAM_T* h, double percentile){
+
+    uint64_t total = 0;
+    for(int i = 0; i < HISTOGRAM_COUNTS; i++){
+        total += histogram_load(h->counts + i);
+    }
+    if(total == 0) return 0;
+    if(percentile <= 0) return histogram_load(&h->min);
+
+    uint64_t rank = (uint64_t)ceil(total * (percentile > 100 ? 100 : percentile) / 100.0);
+    if(rank == 0) rank = 1;
+
+    uint64_t max = histogram_load(&h->max);
+    uint64_t seen = 0;
+    for(int i = 0; i < HISTOGRAM_COUNTS; i++){
+        seen += histogram_load(h->counts + i);
+        if(seen >= rank){
+            uint64_t value = histogram_highest(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+double HistogramMean(const HISTOGRAM_T* h){
+    uint64_t total = histogram_load(&h->totalCount);
+    return total ? (double)histogram_load(&h->sum) / total : 0;
+}
+
+void HistogramPrint(FILE* f, const HISTOGRAM_T* h, const char* label, double scale, const char* unit){
+
+    uint64_t total = histogram_load(&h->totalCount);
+    fprintf(f, "%-12s count %10llu  min %10.2f  mean %10.2f  p50 %10.2f  p90 %10.2f  p99 %10.2f  p99.9 %10.2f  max %10.2f %s\n",
+            label, (unsigned long long)total,
+            total ? histogram_load(&h->min) / scale : 0, HistogramMean(h) / scale,
+            HistogramPercentile(h, 50) / scale, HistogramPercentile(h, 90) / scale,
+            HistogramPercentile(h, 99) / scale, HistogramPercentile(h, 99.9) / scale,
+            histogram_load(&h->max) / scale, unit);
+}
+
+void HistogramPrintDistribution(FILE* f, const HISTOGRAM_T* h, double scale, const char* unit){
+
+    fprintf(f, "%12s %14s\n", "percentile", unit);
+    for(double remaining = 50; remaining >= 0.0005; remaining /= 2){
+        double percentile = 100 - remaining;
+        fprintf(f, "%12.4f %14.2f\n", percentile, HistogramPercentile(h, percentile) / scale);
+    }
+    fprintf(f, "%12.4f %14.2f\n", 100.0, histogram_load(&h->max) / scale);
+}
+
+void HistogramWriteJson(FILE* f, const HISTOGRAM_T* h, const char* name){
+
+    uint64_t total = histogram_load(&h->totalCount);
+    fprintf(f, "{\"name\": \"%s\", \"count\": %llu, \"min\": %llu, \"mean\": %.2f, \"max\": %llu, \"percentiles\": {",
+            name, (unsigned long long)total, (unsigned long long)(total ? histogram_load(&h->min) : 0),
+            HistogramMean(h), (unsigned long long)histogram_load(&h->max));
+
+    for(int i = 0; i < HISTOGRAM_REPORT_PERCENTILES; i++){
+        fprintf(f, "%s\"%g\": %llu", i ? ", " : "", histogram_report_percentiles[i],
+                (unsigned long long)HistogramPercentile(h, histogram_report_percentiles[i]));
+    }
+
+    fprintf(f, "}, \"buckets\": [");
+    bool first = true;
+    for(int i = 0; i < HISTOGRAM_COUNTS; i++){
+        uint64_t count = histogram_load(h->counts + i);
+        if(count == 0) continue;
+        fprintf(f, "%s[%llu, %llu, %llu]", first ? "" : ", ", (unsigned long long)histogram_lowest(i),
+                (unsigned long long)histogram_highest(i), (unsigned long long)count);
+        first = false;
+    }
+    fprintf(f, "]}");
+}
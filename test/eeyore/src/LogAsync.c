@@ -0,0 +1,369 @@
+/**
+ * @file   LogAsync.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Asynchronous logging: a bounded lock free MPSC ring drained by a flusher thread
+ *
+ * The ring is Vyukov's bounded queue. Every cell carries a sequence number: a cell at position pos is free
+ * for the producer that claims pos when its sequence is pos, and holds a published entry when it is pos + 1.
+ * Producers claim positions with a CAS on enqueuePos, copy the entry and publish it with a release store of
+ * the sequence. The flusher is the only consumer; it hands the cell back to the producers of the next lap
+ * with sequence pos + capacity.
+ */
+
+#include "Logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define LOG_ASYNC_IDLE_MSEC     100         // the flusher rechecks the ring at least this often
+#define LOG_ASYNC_CRASH_SPINS   10000       // a crash drain gives up if the flusher holds the ring this long
+
+typedef struct{
+    uint64_t sequence;
+    LOG_LEVEL level;
+    char entry[LOG_ASYNC_ENTRY_SIZE];
+}LOG_ASYNC_CELL_T;
+
+static LOG_ASYNC_CELL_T* log_async_cells = NULL;
+static uint64_t log_async_mask;
+static LOG_ASYNC_POLICY log_async_policy;
+
+// producers and the consumer each get their own cache line
+static uint64_t log_async_enqueue_pos __attribute__((aligned(64)));
+static uint64_t log_async_dequeue_pos __attribute__((aligned(64)));
+static uint64_t log_async_dropped __attribute__((aligned(64)));
+static uint64_t log_async_reported;
+
+static bool log_async_running = false;      // LogMessage() posts into the ring
+static int log_async_posting = 0;           // producers between their running check and their publish
+static bool log_async_stopping = false;
+static bool log_async_idle = false;         // the flusher is about to sleep or sleeping
+static bool log_async_consuming = false;    // the ring is being drained, by the flusher or a crash handler
+
+static pthread_t log_async_thread;
+static pthread_mutex_t log_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_async_wake;       // flusher waits for entries
+static pthread_cond_t log_async_flushed;    // LogFlush() waits for the flusher
+static pthread_once_t log_async_once = PTHREAD_ONCE_INIT;
+
+static __thread bool log_async_is_flusher = false;
+
+static const int log_async_crash_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+static void log_async_init(void){
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&log_async_wake, &attr);
+    pthread_cond_init(&log_async_flushed, &attr);
+    pthread_condattr_destroy(&attr);
+
+    atexit(LogAsyncStop);
+}
+
+static void log_async_deadline(struct timespec* ts, int msec){
+#ifndef __APPLE__
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    clock_gettime(CLOCK_REALTIME, ts);
+#endif
+    ts->tv_nsec += (msec % 1000) * 1000000L;
+    ts->tv_sec += msec / 1000 + ts->tv_nsec / 1000000000L;
+    ts->tv_nsec %= 1000000000L;
+}
+
+static void log_async_append(const char* entry, LOG_LEVEL level){
+    unsigned epoch;
+    const LOG_CONFIG* config = _LogConfigEnter(&epoch);
+    for( int indx = 0 ; indx < LOG_MAX_APPENDERS && config->logAppender[indx] != NULL ; indx++ ){
+        config->logAppender[indx](entry, level);
+    }
+    _LogConfigExit(epoch);
+}
+
+static void log_async_signal_flusher(void){
+    pthread_mutex_lock(&log_async_mutex);
+    pthread_cond_signal(&log_async_wake);
+    pthread_mutex_unlock(&log_async_mutex);
+}
+
+static void log_async_wake_flusher(void){
+    // only the first producer to see the flusher idle pays for the signal
+    if(__atomic_load_n(&log_async_idle, __ATOMIC_SEQ_CST) &&
+       __atomic_exchange_n(&log_async_idle, false, __ATOMIC_SEQ_CST)){
+        log_async_signal_flusher();
+    }
+}
+
+// claim the next cell, or NULL if the message is dropped
+static LOG_ASYNC_CELL_T* log_async_claim(uint64_t* claimed){
+
+    uint64_t pos = __atomic_load_n(&log_async_enqueue_pos, __ATOMIC_RELAXED);
+    for(;;){
+        LOG_ASYNC_CELL_T* cell = log_async_cells + (pos & log_async_mask);
+        int64_t diff = (int64_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - pos);
+
+        if(diff == 0){
+            if(__atomic_compare_exchange_n(&log_async_enqueue_pos, &pos, pos + 1, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                *claimed = pos;
+                return cell;
+            }
+        } else if(diff < 0){
+            // full: the cell still holds the entry of the previous lap
+            if(log_async_policy != LOG_ASYNC_BLOCK){
+                __atomic_add_fetch(&log_async_dropped, 1, __ATOMIC_RELAXED);
+                return NULL;
+            }
+            log_async_signal_flusher();
+            sched_yield();
+            pos = __atomic_load_n(&log_async_enqueue_pos, __ATOMIC_RELAXED);
+        } else {
+            // another producer claimed pos first
+            pos = __atomic_load_n(&log_async_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// an entry of this thread would go through the ring, and be cut to LOG_ASYNC_ENTRY_SIZE
+bool _LogAsyncActive(void){
+    return __atomic_load_n(&log_async_running, __ATOMIC_RELAXED) && !log_async_is_flusher;
+}
+
+bool _LogAsyncPost(const char* entry, LOG_LEVEL level){
+
+    if(!__atomic_load_n(&log_async_running, __ATOMIC_RELAXED) || log_async_is_flusher){
+        return false;
+    }
+
+    // LogAsyncStop() waits for posting to drain before it stops the flusher and frees the ring
+    __atomic_add_fetch(&log_async_posting, 1, __ATOMIC_SEQ_CST);
+    if(!__atomic_load_n(&log_async_running, __ATOMIC_SEQ_CST)){
+        __atomic_sub_fetch(&log_async_posting, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    uint64_t pos;
+    LOG_ASYNC_CELL_T* cell = log_async_claim(&pos);
+    if(cell != NULL){
+        size_t length = strlen(entry);
+        if(length >= LOG_ASYNC_ENTRY_SIZE){
+            length = LOG_ASYNC_ENTRY_SIZE - 4;
+            memcpy(cell->entry + length, "...", 4);
+        } else {
+            cell->entry[length] = '\0';
+        }
+        memcpy(cell->entry, entry, length);
+        cell->level = level;
+        __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_SEQ_CST);
+        log_async_wake_flusher();
+    }
+
+    __atomic_sub_fetch(&log_async_posting, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool log_async_pending(void){
+    uint64_t pos = log_async_dequeue_pos;
+    return __atomic_load_n(&log_async_cells[pos & log_async_mask].sequence, __ATOMIC_SEQ_CST) == pos + 1;
+}
+
+// hand up to max published entries to the appenders. Only the holder of log_async_consuming calls this
+static int log_async_drain(int max){
+
+    uint64_t pos = log_async_dequeue_pos;
+    int count = 0;
+    while(count < max){
+        LOG_ASYNC_CELL_T* cell = log_async_cells + (pos & log_async_mask);
+        if(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != pos + 1){
+            break;
+        }
+        log_async_append(cell->entry, cell->level);
+        __atomic_store_n(&cell->sequence, pos + log_async_mask + 1, __ATOMIC_RELEASE);
+        pos++;
+        count++;
+    }
+    __atomic_store_n(&log_async_dequeue_pos, pos, __ATOMIC_RELEASE);
+
+    if(log_async_policy == LOG_ASYNC_DROP_COUNT){
+        uint64_t dropped = __atomic_load_n(&log_async_dropped, __ATOMIC_RELAXED);
+        if(dropped != log_async_reported){
+            char warning[80];
+            snprintf(warning, sizeof(warning), "LOG: %llu messages dropped, the async ring was full",
+                     (unsigned long long)(dropped - log_async_reported));
+            log_async_append(warning, LOG_LEVEL_WARNING);
+            log_async_reported = dropped;
+        }
+    }
+    return count;
+}
+
+static void log_async_consume_begin(void){
+    while(__atomic_exchange_n(&log_async_consuming, true, __ATOMIC_ACQUIRE)){
+        sched_yield();
+    }
+}
+
+static void log_async_consume_end(void){
+    __atomic_store_n(&log_async_consuming, false, __ATOMIC_RELEASE);
+}
+
+static void* log_async_flusher(void* arg){
+
+    log_async_is_flusher = true;
+
+    for(;;){
+        log_async_consume_begin();
+        int count = log_async_drain(LOG_ASYNC_BATCH);
+        log_async_consume_end();
+
+        if(count > 0){
+            pthread_mutex_lock(&log_async_mutex);
+            pthread_cond_broadcast(&log_async_flushed);
+            pthread_mutex_unlock(&log_async_mutex);
+            continue;
+        }
+        if(__atomic_load_n(&log_async_stopping, __ATOMIC_ACQUIRE)){
+            break;
+        }
+
+        // idle is set before the ring is checked and producers publish before they read it, so either
+        // the check sees the entry or the producer sees idle and signals under the mutex
+        pthread_mutex_lock(&log_async_mutex);
+        __atomic_store_n(&log_async_idle, true, __ATOMIC_SEQ_CST);
+        if(!log_async_pending() && !__atomic_load_n(&log_async_stopping, __ATOMIC_ACQUIRE)){
+            struct timespec deadline;
+            log_async_deadline(&deadline, LOG_ASYNC_IDLE_MSEC);
+            pthread_cond_timedwait(&log_async_wake, &log_async_mutex, &deadline);
+        }
+        __atomic_store_n(&log_async_idle, false, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&log_async_mutex);
+    }
+
+    pthread_mutex_lock(&log_async_mutex);
+    pthread_cond_broadcast(&log_async_flushed);
+    pthread_mutex_unlock(&log_async_mutex);
+    return NULL;
+}
+
+// best effort: deliver what is published, then let the signal kill the process as it would have
+static void log_async_crash(int sig){
+
+    if(log_async_cells != NULL && !log_async_is_flusher){
+        int spins = 0;
+        while(__atomic_exchange_n(&log_async_consuming, true, __ATOMIC_ACQUIRE) && ++spins < LOG_ASYNC_CRASH_SPINS){
+            sched_yield();
+        }
+        if(spins < LOG_ASYNC_CRASH_SPINS){
+            while(log_async_drain(LOG_ASYNC_BATCH) > 0);
+        }
+    }
+    fflush(NULL);
+
+    // SA_RESETHAND put the default action back
+    raise(sig);
+}
+
+static void log_async_install_crash_handlers(void){
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = log_async_crash;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    for(int i = 0; i < (int)(sizeof(log_async_crash_signals) / sizeof(log_async_crash_signals[0])); i++){
+        sigaction(log_async_crash_signals[i], &action, NULL);
+    }
+}
+
+bool LogAsyncStart(int capacity, LOG_ASYNC_POLICY policy, bool flushOnCrash){
+
+    pthread_once(&log_async_once, log_async_init);
+    if(log_async_cells != NULL){
+        return false;
+    }
+
+    uint64_t size = 2;
+    while(size < (uint64_t)(capacity > 0 ? capacity : LOG_ASYNC_DEFAULT_CAPACITY)){
+        size <<= 1;
+    }
+    LOG_ASYNC_CELL_T* cells = malloc(size * sizeof(LOG_ASYNC_CELL_T));
+    if(cells == NULL){
+        return false;
+    }
+    for(uint64_t i = 0; i < size; i++){
+        cells[i].sequence = i;
+    }
+
+    log_async_cells = cells;
+    log_async_mask = size - 1;
+    log_async_policy = policy;
+    log_async_enqueue_pos = 0;
+    log_async_dequeue_pos = 0;
+    log_async_dropped = 0;
+    log_async_reported = 0;
+    log_async_stopping = false;
+    log_async_idle = false;
+
+    if(pthread_create(&log_async_thread, NULL, log_async_flusher, NULL) != 0){
+        log_async_cells = NULL;
+        free(cells);
+        return false;
+    }
+    if(flushOnCrash){
+        log_async_install_crash_handlers();
+    }
+    __atomic_store_n(&log_async_running, true, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+void LogAsyncStop(void){
+
+    if(log_async_cells == NULL || log_async_is_flusher){
+        return;
+    }
+
+    // new messages go out synchronously; the ones already posting still reach the ring
+    __atomic_store_n(&log_async_running, false, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&log_async_posting, __ATOMIC_ACQUIRE) != 0){
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&log_async_mutex);
+    __atomic_store_n(&log_async_stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&log_async_wake);
+    pthread_mutex_unlock(&log_async_mutex);
+    pthread_join(log_async_thread, NULL);
+
+    LOG_ASYNC_CELL_T* cells = log_async_cells;
+    log_async_cells = NULL;
+    free(cells);
+}
+
+void LogFlush(void){
+
+    if(!__atomic_load_n(&log_async_running, __ATOMIC_ACQUIRE) || log_async_is_flusher){
+        return;
+    }
+
+    uint64_t target = __atomic_load_n(&log_async_enqueue_pos, __ATOMIC_ACQUIRE);
+    pthread_mutex_lock(&log_async_mutex);
+    while(__atomic_load_n(&log_async_dequeue_pos, __ATOMIC_ACQUIRE) < target &&
+          !__atomic_load_n(&log_async_stopping, __ATOMIC_ACQUIRE)){
+        pthread_cond_signal(&log_async_wake);
+        struct timespec deadline;
+        log_async_deadline(&deadline, LOG_ASYNC_IDLE_MSEC);
+        pthread_cond_timedwait(&log_async_flushed, &log_async_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&log_async_mutex);
+}
+
+uint64_t LogAsyncDropped(void){
+    return __atomic_load_n(&log_async_dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,452 @@
+/**
+ * @file   LogBinary.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Binary logging with deferred formatting
+ *
+ * A log is LOG_BINARY_MAGIC followed by records, each starting with its kind:
+ *
+ *  'S' site   u32 id, u32 line, the argument types ending with LOG_BINARY_TYPE_END, then file, function
+ *             and format, each as u16 length and up to LOG_BINARY_SITE_STRING_MAX characters
+ *  'E' event  u32 site id, u8 level, u32 thread, u64 CLOCK_REALTIME ns, then the values in the site's types
+ *
+ * A site is written once per log, ahead of its first event.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "LogBinary.h"
+
+#define LOG_BINARY_MAGIC        "EEYBLOG1"
+#define LOG_BINARY_MAGIC_LENGTH 8
+#define LOG_BINARY_RECORD_SITE  'S'
+#define LOG_BINARY_RECORD_EVENT 'E'
+#define LOG_BINARY_EVENT_HEADER (1 + 4 + 1 + 4 + 8)
+#define LOG_BINARY_EVENT_MAX    (LOG_BINARY_EVENT_HEADER + LOG_BINARY_MAX_ARGS * (2 + LOG_BINARY_STRING_MAX))
+#define LOG_BINARY_SITE_STRING_MAX  4096    // file, function and format are cut to this, so a site record fits the buffer
+#define LOG_BINARY_SITE_MAX     (1 + 4 + 4 + LOG_BINARY_MAX_ARGS + 1 + 3 * (2 + LOG_BINARY_SITE_STRING_MAX))
+#define LOG_BINARY_NULL_STRING  UINT16_MAX  // the length of a NULL string, longer than any string written
+
+// a record is appended whole, one larger than the buffer would be lost
+_Static_assert(LOG_BINARY_SITE_MAX <= LOG_BINARY_BUFFER_SIZE && LOG_BINARY_EVENT_MAX <= LOG_BINARY_BUFFER_SIZE,
+               "LOG_BINARY_BUFFER_SIZE must hold the largest record");
+
+static pthread_mutex_t log_binary_lock = PTHREAD_MUTEX_INITIALIZER;
+static int log_binary_fd = -1;
+static bool log_binary_open = false;
+static char log_binary_buffer[LOG_BINARY_BUFFER_SIZE];
+static size_t log_binary_used = 0;
+static uint32_t log_binary_generation = 0;     // counts the logs opened; a site id is only valid in its own
+static uint32_t log_binary_next_id;
+static bool log_binary_exit_registered = false;
+
+static char* log_binary_put(char* wrAt, const void* data, size_t length){
+    memcpy(wrAt, data, length);
+    return wrAt + length;
+}
+
+static char* log_binary_put_string(char* wrAt, const char* s, size_t max){
+    size_t length = s != NULL ? strlen(s) : 0;
+    if(length > max) length = max;
+    uint16_t length16 = s != NULL ? (uint16_t)length : LOG_BINARY_NULL_STRING;
+    wrAt = log_binary_put(wrAt, &length16, sizeof(length16));
+    return s != NULL ? log_binary_put(wrAt, s, length) : wrAt;
+}
+
+// the writers below run with log_binary_lock held
+static void log_binary_write_out(void){
+
+    size_t written = 0;
+    while(written < log_binary_used){
+        ssize_t n = write(log_binary_fd, log_binary_buffer + written, log_binary_used - written);
+        if(n <= 0) break;
+        written += n;
+    }
+    log_binary_used = 0;
+}
+
+static void log_binary_append(const char* data, size_t length){
+    if(log_binary_used + length > LOG_BINARY_BUFFER_SIZE){
+        log_binary_write_out();
+    }
+    if(length > LOG_BINARY_BUFFER_SIZE){
+        return;
+    }
+    memcpy(log_binary_buffer + log_binary_used, data, length);
+    log_binary_used += length;
+}
+
+static void log_binary_register(LOG_BINARY_SITE* site){
+
+    static char record[LOG_BINARY_SITE_MAX];
+    uint32_t line = site->line;
+    int typeCount = 0;
+    while(typeCount < LOG_BINARY_MAX_ARGS && site->types[typeCount] != LOG_BINARY_TYPE_END) typeCount++;
+
+    site->id = log_binary_next_id++;
+    site->generation = log_binary_generation;
+
+    char* wrAt = record;
+    *wrAt++ = LOG_BINARY_RECORD_SITE;
+    wrAt = log_binary_put(wrAt, &site->id, sizeof(site->id));
+    wrAt = log_binary_put(wrAt, &line, sizeof(line));
+    wrAt = log_binary_put(wrAt, site->types, typeCount);
+    *wrAt++ = LOG_BINARY_TYPE_END;
+    wrAt = log_binary_put_string(wrAt, site->file, LOG_BINARY_SITE_STRING_MAX);
+    wrAt = log_binary_put_string(wrAt, site->funcName, LOG_BINARY_SITE_STRING_MAX);
+    wrAt = log_binary_put_string(wrAt, site->format, LOG_BINARY_SITE_STRING_MAX);
+    log_binary_append(record, wrAt - record);
+}
+
+bool LogBinaryOpen(const char* path){
+
+    pthread_mutex_lock(&log_binary_lock);
+    if(log_binary_fd >= 0){
+        pthread_mutex_unlock(&log_binary_lock);
+        return false;
+    }
+    log_binary_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(log_binary_fd < 0){
+        pthread_mutex_unlock(&log_binary_lock);
+        return false;
+    }
+    if(!log_binary_exit_registered){
+        atexit(LogBinaryClose);
+        log_binary_exit_registered = true;
+    }
+
+    log_binary_generation++;
+    log_binary_next_id = 1;
+    log_binary_used = 0;
+    log_binary_append(LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LENGTH);
+    __atomic_store_n(&log_binary_open, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&log_binary_lock);
+    return true;
+}
+
+void LogBinaryFlush(void){
+
+    pthread_mutex_lock(&log_binary_lock);
+    if(log_binary_fd >= 0){
+        log_binary_write_out();
+    }
+    pthread_mutex_unlock(&log_binary_lock);
+}
+
+void LogBinaryClose(void){
+
+    pthread_mutex_lock(&log_binary_lock);
+    if(log_binary_fd >= 0){
+        __atomic_store_n(&log_binary_open, false, __ATOMIC_RELEASE);
+        log_binary_write_out();
+        close(log_binary_fd);
+        log_binary_fd = -1;
+    }
+    pthread_mutex_unlock(&log_binary_lock);
+}
+
+// printf the site's format with decoded values. The values carry their types, so each conversion is
+// rebuilt with the length modifier of the stored type rather than the one written in the format
+static int log_binary_render(char* buffer, size_t size, const char* format, const unsigned char* types, const LOG_BINARY_VALUE* values){
+
+    char* wrAt = buffer;
+    char* end = buffer + size - 1;
+    int next = 0;
+
+    for(const char* f = format; *f != 0 && wrAt < end; ){
+        if(*f != '%'){
+            *wrAt++ = *f++;
+            continue;
+        }
+        if(f[1] == '%'){
+            *wrAt++ = '%';
+            f += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, where a width or precision of '*' is the next argument
+        const char* start = f++;
+        f += strspn(f, "-+ #0'");
+        size_t flagsLength = f - start;
+        bool starWidth = *f == '*';
+        const char* width = f;
+        f += starWidth ? 1 : strspn(f, "0123456789");
+        size_t widthLength = f - width;
+        bool starPrecision = false;
+        const char* precision = NULL;
+        size_t precisionLength = 0;
+        if(*f == '.'){
+            precision = ++f;
+            starPrecision = *f == '*';
+            f += starPrecision ? 1 : strspn(f, "0123456789");
+            precisionLength = f - precision;
+        }
+        size_t specLength = f - start;
+        f += strspn(f, "hlLqjzt");
+        char conversion = *f;
+
+        int stars = starWidth + starPrecision;
+        bool starsFound = true;
+        for(int i = 0; i < stars && starsFound; i++){
+            int type = next + i < LOG_BINARY_MAX_ARGS ? types[next + i] : LOG_BINARY_TYPE_END;
+            starsFound = type == LOG_BINARY_TYPE_INT || type == LOG_BINARY_TYPE_UINT;
+        }
+        if(conversion == 0 || specLength > 32 || !starsFound || next + stars >= LOG_BINARY_MAX_ARGS ||
+           types[next + stars] == LOG_BINARY_TYPE_END){
+            // nothing to print it with: leave it as written
+            size_t length = (conversion != 0 ? f + 1 : f) - start;
+            if(length > (size_t)(end - wrAt)) length = end - wrAt;
+            memcpy(wrAt, start, length);
+            wrAt += length;
+            f = conversion != 0 ? f + 1 : f;
+            continue;
+        }
+        f++;
+
+        // the spec with each '*' replaced by its value: a negative width left-justifies, a negative precision is none
+        char spec[64];
+        memcpy(spec, start, flagsLength);
+        specLength = flagsLength;
+        if(starWidth){
+            int w = types[next] == LOG_BINARY_TYPE_INT ? (int)values[next].i : (int)values[next].u;
+            next++;
+            unsigned magnitude = w < 0 ? 0u - (unsigned)w : (unsigned)w;
+            if(magnitude > size) magnitude = size;      // wider only pads what is cut off anyway
+            specLength += sprintf(spec + specLength, w < 0 ? "-%u" : "%u", magnitude);
+        } else {
+            memcpy(spec + specLength, width, widthLength);
+            specLength += widthLength;
+        }
+        if(starPrecision){
+            int p = types[next] == LOG_BINARY_TYPE_INT ? (int)values[next].i : (int)values[next].u;
+            next++;
+            if(p >= 0) specLength += sprintf(spec + specLength, ".%d", (size_t)p > size ? (int)size : p);
+        } else if(precision != NULL){
+            spec[specLength++] = '.';
+            memcpy(spec + specLength, precision, precisionLength);
+            specLength += precisionLength;
+        }
+        LOG_BINARY_TYPE type = types[next];
+        LOG_BINARY_VALUE value = values[next++];
+        size_t room = end - wrAt + 1;
+        int n;
+
+        // the stored type decides what is printed, the conversion how
+        bool floating = strchr("eEfFgGaA", conversion) != NULL;
+        if(conversion == 'n'){
+            continue;
+        } else if(type == LOG_BINARY_TYPE_STRING){
+            strcpy(spec + specLength, "s");
+            n = snprintf(wrAt, room, spec, value.s != NULL ? value.s : "(null)");
+        } else if(type == LOG_BINARY_TYPE_POINTER){
+            strcpy(spec + specLength, "p");
+            n = snprintf(wrAt, room, spec, value.p);
+        } else if(floating || type == LOG_BINARY_TYPE_DOUBLE){
+            double d = type == LOG_BINARY_TYPE_DOUBLE ? value.d : type == LOG_BINARY_TYPE_INT ? (double)value.i : (double)value.u;
+            spec[specLength] = floating ? conversion : 'g';
+            spec[specLength + 1] = 0;
+            n = snprintf(wrAt, room, spec, d);
+        } else if(conversion == 'c'){
+            strcpy(spec + specLength, "c");
+            n = snprintf(wrAt, room, spec, (int)value.i);
+        } else if(strchr("ouxX", conversion) != NULL){
+            spec[specLength] = 'l';
+            spec[specLength + 1] = 'l';
+            spec[specLength + 2] = conversion;
+            spec[specLength + 3] = 0;
+            n = snprintf(wrAt, room, spec, (unsigned long long)value.u);
+        } else if(type == LOG_BINARY_TYPE_UINT){
+            strcpy(spec + specLength, "llu");
+            n = snprintf(wrAt, room, spec, (unsigned long long)value.u);
+        } else {
+            strcpy(spec + specLength, "lld");
+            n = snprintf(wrAt, room, spec, (long long)value.i);
+        }
+
+        if(n > 0){
+            wrAt += (size_t)n < room ? (size_t)n : room - 1;
+        }
+    }
+    *wrAt = 0;
+    return wrAt - buffer;
+}
+
+void _LogBinaryEx(LOG_BINARY_SITE* site, LOG_LEVEL level, const LOG_BINARY_VALUE* values){
+
+    if(!__atomic_load_n(&log_binary_open, __ATOMIC_ACQUIRE)){
+        char message[LOG_BUFFER_MAX_SIZE];
+        log_binary_render(message, sizeof(message), site->format, site->types, values);
+        _LogMessageEx(site->file, site->funcName, level, "%s", message);
+        return;
+    }
+
+    // encode outside the lock; only the site id is filled in under it
+    char record[LOG_BINARY_EVENT_MAX];
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    uint8_t level8 = (uint8_t)level;
+    uint32_t thread = LogThreadTag();
+
+    char* wrAt = record;
+    *wrAt++ = LOG_BINARY_RECORD_EVENT;
+    char* idAt = wrAt;
+    wrAt += sizeof(uint32_t);
+    wrAt = log_binary_put(wrAt, &level8, sizeof(level8));
+    wrAt = log_binary_put(wrAt, &thread, sizeof(thread));
+    wrAt = log_binary_put(wrAt, &ns, sizeof(ns));
+    for(int i = 0; i < LOG_BINARY_MAX_ARGS && site->types[i] != LOG_BINARY_TYPE_END; i++){
+        if(site->types[i] == LOG_BINARY_TYPE_STRING){
+            wrAt = log_binary_put_string(wrAt, values[i].s, LOG_BINARY_STRING_MAX);
+        } else {
+            wrAt = log_binary_put(wrAt, &values[i], sizeof(uint64_t));
+        }
+    }
+
+    pthread_mutex_lock(&log_binary_lock);
+    if(log_binary_fd >= 0){
+        if(site->generation != log_binary_generation){
+            log_binary_register(site);
+        }
+        memcpy(idAt, &site->id, sizeof(site->id));
+        log_binary_append(record, wrAt - record);
+    }
+    pthread_mutex_unlock(&log_binary_lock);
+}
+
+// decoding
+
+typedef struct{
+    int line;
+    char* file;
+    char* funcName;
+    char* format;
+    unsigned char types[LOG_BINARY_MAX_ARGS + 1];
+}LOG_BINARY_DECODED_SITE;
+
+static bool log_binary_read(FILE* in, void* data, size_t length){
+    return fread(data, 1, length, in) == length;
+}
+
+// into buffer, or a new allocation without one, of size bytes. NULL strings read as "(null)". A string the writer
+// could not have written, too long for size, makes the log corrupt
+static char* log_binary_read_string(FILE* in, char* buffer, size_t size){
+    uint16_t length;
+    if(!log_binary_read(in, &length, sizeof(length))) return NULL;
+    if(length == LOG_BINARY_NULL_STRING){
+        return buffer != NULL ? strcpy(buffer, "(null)") : strdup("(null)");
+    }
+    if(length >= size) return NULL;
+    char* s = buffer != NULL ? buffer : malloc(length + 1);
+    if(s == NULL || !log_binary_read(in, s, length)){
+        if(buffer == NULL) free(s);
+        return NULL;
+    }
+    s[length] = 0;
+    return s;
+}
+
+static bool log_binary_read_site(FILE* in, LOG_BINARY_DECODED_SITE** sites, uint32_t* siteCount){
+
+    uint32_t id, line;
+    if(!log_binary_read(in, &id, sizeof(id)) || !log_binary_read(in, &line, sizeof(line)) || id == 0 || id > 1u << 24){
+        return false;
+    }
+    if(id >= *siteCount){
+        uint32_t count = id + 64;
+        LOG_BINARY_DECODED_SITE* grown = realloc(*sites, count * sizeof(LOG_BINARY_DECODED_SITE));
+        if(grown == NULL) return false;
+        memset(grown + *siteCount, 0, (count - *siteCount) * sizeof(LOG_BINARY_DECODED_SITE));
+        *sites = grown;
+        *siteCount = count;
+    }
+
+    LOG_BINARY_DECODED_SITE* site = *sites + id;
+    free(site->file);
+    free(site->funcName);
+    free(site->format);
+    memset(site, 0, sizeof(*site));
+    site->line = line;
+    for(int i = 0; ; i++){
+        int type = fgetc(in);
+        if(type == EOF || i > LOG_BINARY_MAX_ARGS || type > LOG_BINARY_TYPE_POINTER) return false;
+        site->types[i] = (unsigned char)type;
+        if(type == LOG_BINARY_TYPE_END) break;
+    }
+    site->file = log_binary_read_string(in, NULL, LOG_BINARY_SITE_STRING_MAX + 1);
+    site->funcName = log_binary_read_string(in, NULL, LOG_BINARY_SITE_STRING_MAX + 1);
+    site->format = log_binary_read_string(in, NULL, LOG_BINARY_SITE_STRING_MAX + 1);
+    return site->file != NULL && site->funcName != NULL && site->format != NULL;
+}
+
+static bool log_binary_decode_event(FILE* in, FILE* out, const LOG_BINARY_DECODED_SITE* sites, uint32_t siteCount){
+
+    uint32_t id, thread;
+    uint8_t level;
+    uint64_t ns;
+    if(!log_binary_read(in, &id, sizeof(id)) || !log_binary_read(in, &level, sizeof(level)) ||
+       !log_binary_read(in, &thread, sizeof(thread)) || !log_binary_read(in, &ns, sizeof(ns))){
+        return false;
+    }
+    if(id >= siteCount || sites[id].format == NULL || level > LOG_LEVEL_DEBUG){
+        return false;
+    }
+    const LOG_BINARY_DECODED_SITE* site = sites + id;
+
+    char strings[LOG_BINARY_MAX_ARGS][LOG_BINARY_STRING_MAX + 1];
+    LOG_BINARY_VALUE values[LOG_BINARY_MAX_ARGS];
+    for(int i = 0; site->types[i] != LOG_BINARY_TYPE_END; i++){
+        if(site->types[i] == LOG_BINARY_TYPE_STRING){
+            if((values[i].s = log_binary_read_string(in, strings[i], sizeof(strings[i]))) == NULL) return false;
+        } else if(!log_binary_read(in, &values[i], sizeof(uint64_t))){
+            return false;
+        }
+    }
+
+    char message[LOG_BUFFER_MAX_SIZE];
+    log_binary_render(message, sizeof(message), site->format, site->types, values);
+
+    struct timespec time = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    LOG_ENTRY_ORIGIN origin = { site->file, site->funcName, (LOG_LEVEL)level, &time, thread };
+    char entry[LOG_BUFFER_MAX_SIZE];
+    LogFormatEntry(entry, sizeof(entry), &origin, "%s", message);
+    fprintf(out, "%s\n", entry);
+    return true;
+}
+
+long LogBinaryDecode(FILE* in, FILE* out){
+
+    char magic[LOG_BINARY_MAGIC_LENGTH];
+    if(!log_binary_read(in, magic, sizeof(magic)) || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0){
+        return -1;
+    }
+
+    LOG_BINARY_DECODED_SITE* sites = NULL;
+    uint32_t siteCount = 0;
+    long entries = 0;
+    int kind;
+    while((kind = fgetc(in)) != EOF){
+        if(kind == LOG_BINARY_RECORD_SITE && log_binary_read_site(in, &sites, &siteCount)){
+            continue;
+        }
+        if(kind == LOG_BINARY_RECORD_EVENT && log_binary_decode_event(in, out, sites, siteCount)){
+            entries++;
+            continue;
+        }
+        entries = -1;
+        break;
+    }
+
+    for(uint32_t i = 0; i < siteCount; i++){
+        free(sites[i].file);
+        free(sites[i].funcName);
+        free(sites[i].format);
+    }
+    free(sites);
+    return entries;
+}
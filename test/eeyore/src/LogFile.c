@@ -0,0 +1,377 @@
+/**
+ * @file   LogFile.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Buffered file appender: entries gathered in chunks and written out by a writer thread
+ *
+ * The buffer is a ring of LOG_FILE_CHUNKS chunks. The chunks from log_file_tail on, log_file_full of them, are
+ * sealed and belong to the writer; the chunk after them is the one LogAppenderFile() fills. The writer takes
+ * every sealed chunk in one writev outside the mutex, so appenders only wait when the whole ring is sealed.
+ */
+
+#include "Logger.h"
+#include "Alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+
+#define LOG_FILE_COLOUR_MAX     (sizeof(KRED) - 1 + sizeof(KNRM) - 1)
+#define LOG_FILE_CHUNK_MIN      (LOG_BUFFER_MAX_SIZE + LOG_FILE_COLOUR_MAX)     // the longest LogMessage() entry
+#define LOG_FILE_PATH_MAX       4096
+
+typedef struct{
+    char* data;
+    size_t used;
+}LOG_FILE_CHUNK_T;
+
+static LOG_FILE_CONFIG log_file_config;
+static LOG_FILE_CHUNK_T log_file_chunks[LOG_FILE_CHUNKS];
+static size_t log_file_chunk_size;
+static int log_file_tail;                   // oldest sealed chunk
+static int log_file_full;                   // sealed chunks
+static uint64_t log_file_sealed;            // chunks ever sealed, for LogFileFlush()
+static uint64_t log_file_written;           // chunks ever written out
+static bool log_file_write_now = false;     // write out without waiting for half the ring or the interval
+static bool log_file_sync_now = false;      // fdatasync the next write out
+
+static int log_file_fd = -1;
+static size_t log_file_bytes;               // in the current file
+static bool log_file_running = false;       // LogAppenderFile() takes entries
+static bool log_file_stopping = false;
+
+static pthread_t log_file_thread;
+static pthread_mutex_t log_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_file_wake;        // writer waits for chunks
+static pthread_cond_t log_file_room;        // appenders and LogFileFlush() wait for the writer
+static pthread_once_t log_file_once = PTHREAD_ONCE_INIT;
+
+static void log_file_init(void){
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&log_file_wake, &attr);
+    pthread_cond_init(&log_file_room, &attr);
+    pthread_condattr_destroy(&attr);
+
+    atexit(LogFileClose);
+}
+
+static void log_file_deadline(struct timespec* ts, int msec){
+#ifndef __APPLE__
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    clock_gettime(CLOCK_REALTIME, ts);
+#endif
+    ts->tv_nsec += (msec % 1000) * 1000000L;
+    ts->tv_sec += msec / 1000 + ts->tv_nsec / 1000000000L;
+    ts->tv_nsec %= 1000000000L;
+}
+
+static const char* log_file_colour(LOG_LEVEL level){
+    switch(level){
+        case LOG_LEVEL_CRITCAL:
+        case LOG_LEVEL_ERROR:   return KRED;
+        case LOG_LEVEL_WARNING: return KYEL;
+        case LOG_LEVEL_DEBUG:   return KCYN;
+        default:                return KNRM;
+    }
+}
+
+static LOG_FILE_CHUNK_T* log_file_head(void){
+    return log_file_chunks + (log_file_tail + log_file_full) % LOG_FILE_CHUNKS;
+}
+
+// hand the chunk being filled to the writer. Called with the mutex held
+static void log_file_seal(void){
+    if(log_file_full < LOG_FILE_CHUNKS && log_file_head()->used > 0){
+        log_file_full++;
+        log_file_sealed++;
+    }
+}
+
+static void log_file_copy(char** wrAt, const char* text, size_t length){
+    memcpy(*wrAt, text, length);
+    *wrAt += length;
+}
+
+void LogAppenderFile ( const char* entry, LOG_LEVEL level){
+
+    if(!__atomic_load_n(&log_file_running, __ATOMIC_ACQUIRE)){
+        return;
+    }
+
+    const char* colour = log_file_config.colour ? log_file_colour(level) : "";
+    const char* reset = log_file_config.colour ? KNRM : "";
+    size_t colourLength = strlen(colour), resetLength = strlen(reset);
+    size_t length = strlen(entry);
+    if(colourLength + length + resetLength + 1 > log_file_chunk_size){
+        length = log_file_chunk_size - colourLength - resetLength - 1;
+    }
+    size_t need = colourLength + length + resetLength + 1;
+
+    pthread_mutex_lock(&log_file_mutex);
+    LOG_FILE_CHUNK_T* chunk = NULL;
+    while(log_file_running){
+        if(log_file_full < LOG_FILE_CHUNKS){
+            chunk = log_file_head();
+            if(chunk->used + need <= log_file_chunk_size){
+                break;
+            }
+            log_file_seal();
+            if(log_file_full >= LOG_FILE_CHUNKS / 2){
+                pthread_cond_signal(&log_file_wake);
+            }
+        } else {
+            pthread_cond_wait(&log_file_room, &log_file_mutex);
+        }
+        chunk = NULL;
+    }
+
+    if(chunk != NULL){
+        char* wrAt = chunk->data + chunk->used;
+        log_file_copy(&wrAt, colour, colourLength);
+        log_file_copy(&wrAt, entry, length);
+        log_file_copy(&wrAt, reset, resetLength);
+        *wrAt++ = '\n';
+        chunk->used = (size_t)(wrAt - chunk->data);
+
+        if(level <= LOG_LEVEL_ERROR && log_file_config.sync == LOG_FILE_SYNC_ERRORS){
+            log_file_seal();
+            log_file_write_now = true;
+            log_file_sync_now = true;
+            pthread_cond_signal(&log_file_wake);
+        }
+    }
+    pthread_mutex_unlock(&log_file_mutex);
+}
+
+static int log_file_open_fd(const char* path){
+    return open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+// path.N-1 to path.N down to path to path.1, then start path again. Called by the writer only
+static void log_file_rotate(void){
+
+    char from[LOG_FILE_PATH_MAX], to[LOG_FILE_PATH_MAX];
+    const char* path = log_file_config.path;
+
+    if(log_file_config.sync != LOG_FILE_SYNC_NONE){
+        fdatasync(log_file_fd);
+    }
+    close(log_file_fd);
+
+    if(log_file_config.maxFiles > 0){
+        for(int i = log_file_config.maxFiles - 1; i > 0; i--){
+            snprintf(from, sizeof(from), "%s.%d", path, i);
+            snprintf(to, sizeof(to), "%s.%d", path, i + 1);
+            rename(from, to);
+        }
+        snprintf(to, sizeof(to), "%s.1", path);
+        rename(path, to);
+    } else {
+        unlink(path);
+    }
+
+    log_file_fd = log_file_open_fd(path);
+    log_file_bytes = 0;
+}
+
+// write count chunks from first with one writev. A chunk that cannot be written is dropped
+static void log_file_write_chunks(int first, int count, bool sync){
+
+    struct iovec iov[LOG_FILE_CHUNKS];
+    size_t bytes = 0;
+    for(int i = 0; i < count; i++){
+        LOG_FILE_CHUNK_T* chunk = log_file_chunks + (first + i) % LOG_FILE_CHUNKS;
+        iov[i].iov_base = chunk->data;
+        iov[i].iov_len = chunk->used;
+        bytes += chunk->used;
+    }
+
+    if(log_file_fd < 0){
+        // a rotation could not start the new file; try again
+        log_file_fd = log_file_open_fd(log_file_config.path);
+    }
+    if(log_file_config.maxBytes > 0 && log_file_bytes > 0 && log_file_bytes + bytes > log_file_config.maxBytes){
+        log_file_rotate();
+    }
+    if(log_file_fd < 0){
+        return;
+    }
+
+    struct iovec* next = iov;
+    int left = count;
+    while(left > 0){
+        ssize_t written = writev(log_file_fd, next, left);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        log_file_bytes += (size_t)written;
+        while(left > 0 && (size_t)written >= next->iov_len){
+            written -= (ssize_t)next->iov_len;
+            next++;
+            left--;
+        }
+        if(left > 0){
+            next->iov_base = (char*)next->iov_base + written;
+            next->iov_len -= (size_t)written;
+        }
+    }
+
+    if(sync || log_file_config.sync == LOG_FILE_SYNC_ALWAYS){
+        fdatasync(log_file_fd);
+    }
+}
+
+static void* log_file_writer(void* arg){
+
+    pthread_mutex_lock(&log_file_mutex);
+    for(;;){
+        if(log_file_full < LOG_FILE_CHUNKS / 2 && !log_file_write_now && !log_file_stopping){
+            struct timespec deadline;
+            log_file_deadline(&deadline, log_file_config.flushMsec);
+            while(log_file_full < LOG_FILE_CHUNKS / 2 && !log_file_write_now && !log_file_stopping){
+                if(pthread_cond_timedwait(&log_file_wake, &log_file_mutex, &deadline) == ETIMEDOUT){
+                    break;
+                }
+            }
+        }
+        // take the chunk being filled along, whatever woke the writer
+        log_file_seal();
+        log_file_write_now = false;
+
+        if(log_file_full == 0){
+            if(log_file_stopping){
+                break;
+            }
+            continue;
+        }
+
+        int first = log_file_tail, count = log_file_full;
+        bool sync = log_file_sync_now;
+        log_file_sync_now = false;
+        pthread_mutex_unlock(&log_file_mutex);
+
+        log_file_write_chunks(first, count, sync);
+
+        pthread_mutex_lock(&log_file_mutex);
+        for(int i = 0; i < count; i++){
+            log_file_chunks[(first + i) % LOG_FILE_CHUNKS].used = 0;
+        }
+        log_file_tail = (first + count) % LOG_FILE_CHUNKS;
+        log_file_full -= count;
+        log_file_written += (uint64_t)count;
+        pthread_cond_broadcast(&log_file_room);
+    }
+    pthread_mutex_unlock(&log_file_mutex);
+    return NULL;
+}
+
+static void log_file_release(void){
+    for(int i = 0; i < LOG_FILE_CHUNKS; i++){
+        free(log_file_chunks[i].data);
+        log_file_chunks[i].data = NULL;
+    }
+    releaseStringCopy(log_file_config.path);
+    log_file_config.path = NULL;
+    if(log_file_fd >= 0){
+        close(log_file_fd);
+        log_file_fd = -1;
+    }
+}
+
+bool LogFileOpen(const LOG_FILE_CONFIG* config){
+
+    pthread_once(&log_file_once, log_file_init);
+    if(log_file_config.path != NULL || config == NULL || config->path == NULL){
+        return false;
+    }
+
+    log_file_config = *config;
+    log_file_config.path = allocStringCopy(config->path);
+    if(log_file_config.bufferSize == 0){
+        log_file_config.bufferSize = LOG_FILE_DEFAULT_BUFFER;
+    }
+    if(log_file_config.flushMsec <= 0){
+        log_file_config.flushMsec = LOG_FILE_DEFAULT_FLUSH_MSEC;
+    }
+    log_file_chunk_size = log_file_config.bufferSize / LOG_FILE_CHUNKS;
+    if(log_file_chunk_size < LOG_FILE_CHUNK_MIN){
+        log_file_chunk_size = LOG_FILE_CHUNK_MIN;
+    }
+
+    log_file_fd = log_file_config.path != NULL ? log_file_open_fd(log_file_config.path) : -1;
+    bool ready = log_file_fd >= 0;
+    for(int i = 0; i < LOG_FILE_CHUNKS && ready; i++){
+        log_file_chunks[i].data = malloc(log_file_chunk_size);
+        log_file_chunks[i].used = 0;
+        ready = log_file_chunks[i].data != NULL;
+    }
+    struct stat info;
+    log_file_bytes = ready && fstat(log_file_fd, &info) == 0 ? (size_t)info.st_size : 0;
+
+    log_file_tail = 0;
+    log_file_full = 0;
+    log_file_sealed = 0;
+    log_file_written = 0;
+    log_file_write_now = false;
+    log_file_sync_now = false;
+    log_file_stopping = false;
+
+    if(!ready || pthread_create(&log_file_thread, NULL, log_file_writer, NULL) != 0){
+        log_file_release();
+        return false;
+    }
+    __atomic_store_n(&log_file_running, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void LogFileFlush(void){
+
+    pthread_mutex_lock(&log_file_mutex);
+    if(log_file_running){
+        log_file_seal();
+        uint64_t target = log_file_sealed;
+        log_file_write_now = true;
+        pthread_cond_signal(&log_file_wake);
+        while(log_file_written < target && !log_file_stopping){
+            pthread_cond_wait(&log_file_room, &log_file_mutex);
+        }
+    }
+    pthread_mutex_unlock(&log_file_mutex);
+}
+
+void LogFileClose(void){
+
+    if(log_file_config.path == NULL){
+        return;
+    }
+
+    // entries still queued for the async flusher belong in this file
+    LogFlush();
+
+    pthread_mutex_lock(&log_file_mutex);
+    __atomic_store_n(&log_file_running, false, __ATOMIC_RELEASE);
+    log_file_stopping = true;
+    pthread_cond_signal(&log_file_wake);
+    pthread_cond_broadcast(&log_file_room);
+    pthread_mutex_unlock(&log_file_mutex);
+    pthread_join(log_file_thread, NULL);
+
+    if(log_file_config.sync != LOG_FILE_SYNC_NONE){
+        fdatasync(log_file_fd);
+    }
+    log_file_release();
+}
@@ -0,0 +1,221 @@
+/**
+ * @file   LogKV.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Structured logging: typed key value fields written as logfmt or JSON
+ *
+ * The message is built in one pass into a buffer the size of an entry. A message too long for it keeps the
+ * fields that fit whole: a field that runs past the end is taken back, and room is kept to close the event's
+ * quote and the JSON object, so what is logged still parses.
+ */
+
+#include <string.h>
+#include "LogKV.h"
+#include "Trace.h"
+
+typedef struct{
+    char* wrAt;
+    char* end;                      // keeps room for the terminator and what closes the message
+    bool full;                      // something did not fit
+}LOG_KV_WRITER_T;
+
+// the two digits of 0 to 99
+static const char log_kv_digit_pairs[] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+// what follows the backslash for a character escaped in a string, 'u' for \u00XX, 0 for none
+static const char log_kv_escapes[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"', ['\\'] = '\\', [0x7f] = 'u',
+};
+
+static LOG_KV_FORMAT log_kv_format = LOG_KV_LOGFMT;
+
+void LogKVSetFormat(LOG_KV_FORMAT format){
+    __atomic_store_n(&log_kv_format, format, __ATOMIC_RELAXED);
+}
+
+static void log_kv_put(LOG_KV_WRITER_T* w, const char* text, size_t length){
+    if(length > (size_t)(w->end - w->wrAt)){
+        length = w->end - w->wrAt;
+        w->full = true;
+    }
+    memcpy(w->wrAt, text, length);
+    w->wrAt += length;
+}
+
+static void log_kv_put_char(LOG_KV_WRITER_T* w, char c){
+    if(w->wrAt < w->end) *w->wrAt++ = c;
+    else w->full = true;
+}
+
+static void log_kv_put_uint(LOG_KV_WRITER_T* w, uint64_t v){
+
+    char digits[20];
+    char* at = digits + sizeof(digits);
+    while(v >= 100){
+        at -= 2;
+        memcpy(at, log_kv_digit_pairs + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if(v >= 10){
+        at -= 2;
+        memcpy(at, log_kv_digit_pairs + v * 2, 2);
+    } else {
+        *--at = (char)('0' + v);
+    }
+    log_kv_put(w, at, digits + sizeof(digits) - at);
+}
+
+static void log_kv_put_int(LOG_KV_WRITER_T* w, int64_t v){
+    if(v < 0){
+        log_kv_put_char(w, '-');
+        log_kv_put_uint(w, 0 - (uint64_t)v);
+    } else {
+        log_kv_put_uint(w, (uint64_t)v);
+    }
+}
+
+// s in double quotes, escaped as a JSON string; the runs between escapes are copied whole. Cut short, an escape
+// is left out rather than split and the closing quote goes into the room kept past end
+static void log_kv_put_quoted(LOG_KV_WRITER_T* w, const char* s){
+
+    log_kv_put_char(w, '"');
+    if(w->full){
+        return;
+    }
+    const char* run = s;
+    for(; *s && !w->full; s++){
+        char escape = log_kv_escapes[(unsigned char)*s];
+        if(escape == 0){
+            continue;
+        }
+        log_kv_put(w, run, s - run);
+        char text[6] = { '\\', escape };
+        size_t length = 2;
+        if(escape == 'u'){
+            unsigned char c = (unsigned char)*s;
+            memcpy(text + 2, "00", 2);
+            text[4] = "0123456789abcdef"[c >> 4];
+            text[5] = "0123456789abcdef"[c & 15];
+            length = 6;
+        }
+        if(length > (size_t)(w->end - w->wrAt)){
+            w->full = true;
+            break;
+        }
+        log_kv_put(w, text, length);
+        run = s + 1;
+    }
+    if(!w->full){
+        log_kv_put(w, run, s - run);
+    }
+    if(w->full){
+        *w->wrAt++ = '"';
+    } else {
+        log_kv_put_char(w, '"');
+        if(w->full) *w->wrAt++ = '"';
+    }
+}
+
+// logfmt quotes a value only when it is empty or has a space, '=', '"' or something escaped
+static void log_kv_put_logfmt_value(LOG_KV_WRITER_T* w, const char* s){
+
+    const char* c = s;
+    while(*c > ' ' && *c != '=' && log_kv_escapes[(unsigned char)*c] == 0){
+        c++;
+    }
+    if(*c == 0 && c != s){
+        log_kv_put(w, s, c - s);
+    } else {
+        log_kv_put_quoted(w, s);
+    }
+}
+
+static void log_kv_put_value(LOG_KV_WRITER_T* w, const LOG_KV* field, bool json){
+
+    switch(field->type){
+        case LOG_KV_TYPE_INT:
+            log_kv_put_int(w, field->value.i);
+            break;
+
+        case LOG_KV_TYPE_UINT:
+            log_kv_put_uint(w, field->value.u);
+            break;
+
+        case LOG_KV_TYPE_BOOL:
+            if(field->value.b) log_kv_put(w, "true", 4);
+            else log_kv_put(w, "false", 5);
+            break;
+
+        case LOG_KV_TYPE_STRING:
+            if(field->value.s == NULL){
+                if(json) log_kv_put(w, "null", 4);
+            } else if(json){
+                log_kv_put_quoted(w, field->value.s);
+            } else {
+                log_kv_put_logfmt_value(w, field->value.s);
+            }
+            break;
+    }
+}
+
+int LogKVFormat(char* buffer, size_t size, const char* event, const LOG_KV* fields){
+
+    bool json = __atomic_load_n(&log_kv_format, __ATOMIC_RELAXED) == LOG_KV_JSON;
+    // past end: the terminator, the quote of an event cut short and the '}'
+    size_t closing = json ? 3 : 2;
+    if(size < closing + 1){
+        if(size > 0) buffer[0] = '\0';
+        return 0;
+    }
+    LOG_KV_WRITER_T w = { buffer, buffer + size - closing, false };
+
+    if(json){
+        log_kv_put(&w, "{\"event\":", 9);
+        log_kv_put_quoted(&w, event);
+    } else {
+        log_kv_put(&w, "event=", 6);
+        log_kv_put_logfmt_value(&w, event);
+    }
+    // a field cut short is taken back, so the fields may have the room of the event's quote
+    w.end++;
+
+    // a field is written whole or not at all
+    for(; fields->type != LOG_KV_TYPE_END && !w.full; fields++){
+        char* fieldStart = w.wrAt;
+        if(json){
+            log_kv_put(&w, ",\"", 2);
+            log_kv_put(&w, fields->key, fields->keyLength);
+            log_kv_put(&w, "\":", 2);
+        } else {
+            log_kv_put_char(&w, ' ');
+            log_kv_put(&w, fields->key, fields->keyLength);
+            log_kv_put_char(&w, '=');
+        }
+        log_kv_put_value(&w, fields, json);
+        if(w.full){
+            w.wrAt = fieldStart;
+        }
+    }
+
+    if(json){
+        *w.wrAt++ = '}';
+    }
+    *w.wrAt = '\0';
+    return w.wrAt - buffer;
+}
+
+void _LogKVEx(LOG_SITE* site, LOG_LEVEL level, const char* event, const LOG_KV* fields){
+
+    TraceBegin(TRACE_CATEGORY_LOG, "LogKV", event, level);
+
+    char message[LOG_BUFFER_MAX_SIZE];
+    LogKVFormat(message, sizeof(message), event != NULL ? event : "", fields);
+    _LogSiteTextEx(site, level, message);
+
+    TraceEnd(TRACE_CATEGORY_LOG, "LogKV");
+}
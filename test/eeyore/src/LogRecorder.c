@@ -0,0 +1,211 @@
+/**
+ * @file   LogRecorder.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Flight recorder appender: log entries in a memory mapped circular file
+ *
+ * The file is a header page followed by slotCount slots of slotSize bytes. Entry n goes to slot n % slotCount.
+ * The writer reserves n with a fetch and add on the header's next counter, marks the slot empty, copies the
+ * entry and then publishes the slot with a release store of n + 1 as its sequence. A reader keeps a slot only
+ * when its sequence is the same before and after the copy, so entries cut short by a crash, or overwritten
+ * while read, are left out. Two writers only share a slot when one stalls for a whole lap of the ring.
+ *
+ * The appender is only called from inside a config reader, so LogRecorderClose() takes the mapping away and
+ * waits for those readers to drain before it unmaps: the writers need nothing shared besides the next counter.
+ */
+
+#include "Logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LOG_RECORDER_MAGIC          "EEYFLT01"
+#define LOG_RECORDER_HEADER_SIZE    4096
+#define LOG_RECORDER_SLOT_MIN       64
+
+typedef struct{
+    char magic[8];
+    uint32_t slotSize;
+    uint32_t reserved;
+    uint64_t slotCount;
+    uint64_t next __attribute__((aligned(64)));     // the next entry number
+}LOG_RECORDER_HEADER_T;
+
+typedef struct{
+    uint64_t sequence;          // entry number + 1 once written, 0 while being written
+    uint32_t length;
+    uint32_t reserved;
+    char text[];
+}LOG_RECORDER_SLOT_T;
+
+static LOG_RECORDER_HEADER_T* log_recorder_header = NULL;  // NULL when closed
+static char* log_recorder_slots;
+static size_t log_recorder_size;
+
+static LOG_RECORDER_SLOT_T* log_recorder_slot(char* slots, const LOG_RECORDER_HEADER_T* header, uint64_t n){
+    return (LOG_RECORDER_SLOT_T*)(slots + (size_t)(n % header->slotCount) * header->slotSize);
+}
+
+void LogAppenderRecorder ( const char* entry, LOG_LEVEL level){
+
+    // LogRecorderClose() waits for the config readers, this one among them, before it unmaps
+    LOG_RECORDER_HEADER_T* header = __atomic_load_n(&log_recorder_header, __ATOMIC_SEQ_CST);
+    if(header != NULL){
+        uint64_t n = __atomic_fetch_add(&header->next, 1, __ATOMIC_RELAXED);
+        LOG_RECORDER_SLOT_T* slot = log_recorder_slot(log_recorder_slots, header, n);
+
+        __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        size_t length = strlen(entry);
+        size_t room = header->slotSize - sizeof(LOG_RECORDER_SLOT_T);
+        if(length > room){
+            length = room;
+        }
+        memcpy(slot->text, entry, length);
+        slot->length = (uint32_t)length;
+        __atomic_store_n(&slot->sequence, n + 1, __ATOMIC_RELEASE);
+    }
+}
+
+// the header of a file left by a crash may be torn or garbage: the slots it claims must fit the file, checked by
+// dividing so a huge slotCount cannot wrap the product
+static bool log_recorder_valid(const LOG_RECORDER_HEADER_T* header, size_t size){
+    return memcmp(header->magic, LOG_RECORDER_MAGIC, sizeof(header->magic)) == 0 &&
+           header->slotSize >= LOG_RECORDER_SLOT_MIN && header->slotCount > 0 && size >= LOG_RECORDER_HEADER_SIZE &&
+           header->slotCount <= (size - LOG_RECORDER_HEADER_SIZE) / header->slotSize;
+}
+
+bool LogRecorderOpen(const char* path, size_t size, size_t slotSize){
+
+    if(log_recorder_header != NULL){
+        return false;
+    }
+    if(size == 0){
+        size = LOG_RECORDER_DEFAULT_SIZE;
+    }
+    if(slotSize == 0){
+        slotSize = LOG_RECORDER_DEFAULT_SLOT;
+    }
+    // whole cache lines, so neighbouring slots do not share one
+    slotSize = (slotSize + LOG_RECORDER_SLOT_MIN - 1) / LOG_RECORDER_SLOT_MIN * LOG_RECORDER_SLOT_MIN;
+    if(size < LOG_RECORDER_HEADER_SIZE + slotSize){
+        return false;
+    }
+    uint64_t slotCount = (size - LOG_RECORDER_HEADER_SIZE) / slotSize;
+    size = LOG_RECORDER_HEADER_SIZE + slotCount * slotSize;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0){
+        return false;
+    }
+    struct stat info;
+    bool carryOn = fstat(fd, &info) == 0 && (size_t)info.st_size == size;
+    if(!carryOn && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)){
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        return false;
+    }
+
+    LOG_RECORDER_HEADER_T* header = map;
+    if(!carryOn || !log_recorder_valid(header, size) || header->slotSize != slotSize){
+        memset(map, 0, size);
+        header->slotSize = (uint32_t)slotSize;
+        header->slotCount = slotCount;
+        header->next = 0;
+        memcpy(header->magic, LOG_RECORDER_MAGIC, sizeof(header->magic));
+    }
+
+    log_recorder_slots = (char*)map + LOG_RECORDER_HEADER_SIZE;
+    log_recorder_size = size;
+    __atomic_store_n(&log_recorder_header, header, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+void LogRecorderClose(void){
+
+    LOG_RECORDER_HEADER_T* header = __atomic_exchange_n(&log_recorder_header, NULL, __ATOMIC_SEQ_CST);
+    if(header == NULL){
+        return;
+    }
+    _LogConfigDrain();
+    msync(header, log_recorder_size, MS_ASYNC);
+    munmap(header, log_recorder_size);
+}
+
+typedef struct{
+    uint64_t sequence;
+    uint64_t index;
+}LOG_RECORDER_ENTRY_T;
+
+static int log_recorder_compare(const void* a, const void* b){
+    uint64_t sa = ((const LOG_RECORDER_ENTRY_T*)a)->sequence, sb = ((const LOG_RECORDER_ENTRY_T*)b)->sequence;
+    return sa < sb ? -1 : sa > sb;
+}
+
+long LogRecorderRead(const char* path, FILE* out){
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return -1;
+    }
+    struct stat info;
+    void* map = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && (size_t)info.st_size >= LOG_RECORDER_HEADER_SIZE){
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(map == MAP_FAILED){
+        return -1;
+    }
+    const LOG_RECORDER_HEADER_T* header = map;
+    if(!log_recorder_valid(header, (size_t)info.st_size)){
+        munmap(map, (size_t)info.st_size);
+        return -1;
+    }
+
+    // the slots in use, oldest entry first
+    char* slots = (char*)map + LOG_RECORDER_HEADER_SIZE;
+    LOG_RECORDER_ENTRY_T* entries = malloc(header->slotCount * sizeof(LOG_RECORDER_ENTRY_T));
+    long count = 0;
+    for(uint64_t i = 0; entries != NULL && i < header->slotCount; i++){
+        LOG_RECORDER_SLOT_T* slot = log_recorder_slot(slots, header, i);
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if(sequence != 0){
+            entries[count].sequence = sequence;
+            entries[count++].index = i;
+        }
+    }
+    if(entries != NULL){
+        qsort(entries, (size_t)count, sizeof(LOG_RECORDER_ENTRY_T), log_recorder_compare);
+    }
+
+    size_t room = header->slotSize - sizeof(LOG_RECORDER_SLOT_T);
+    char* text = malloc(room + 1);
+    long written = 0;
+    for(long i = 0; text != NULL && i < count; i++){
+        LOG_RECORDER_SLOT_T* slot = log_recorder_slot(slots, header, entries[i].index);
+        size_t length = slot->length < room ? slot->length : room;
+        memcpy(text, slot->text, length);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != entries[i].sequence){
+            continue;       // overwritten while it was copied
+        }
+        text[length] = '\0';
+        fprintf(out, "%s\n", text);
+        written++;
+    }
+
+    free(text);
+    free(entries);
+    munmap(map, (size_t)info.st_size);
+    return written;
+}
@@ -7,28 +7,36 @@
 
 #include "Logger.h"
 #include "Alloc.h"
+#include "Trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <inttypes.h>
-#include <math.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <syslog.h>
+#include <fnmatch.h>
 
 
-LOG_CONFIG current_log_config = {
+#define LOG_LEADER(_type, _trailer)     {_type, _trailer, sizeof(_trailer) - 1}
+
+// the config is a snapshot that is never changed once published: LogSetConfig() and LogAddAppender() build a
+// new one, swap the pointer and free the old one after a grace period, once no logging call can still hold it
+static LOG_CONFIG log_default_config = {
     LOG_LEVEL_INFO,
     NULL,
+    NULL,
     "",
+    0,
     {
-        {LOG_LEADER_VAR_TYPE_TIME, " ["},
-        {LOG_LEADER_VAR_TYPE_LEVEL, "] ("},
-        {LOG_LEADER_VAR_TYPE_THREAD, ") ["},
-        {LOG_LEADER_VAR_TYPE_FUNC, "]: "},
-        {LOG_LEADER_VAR_TYPE_MESSAGE, ""},
-        {LOG_LEADER_VAR_TYPE_NONE, ""}
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_TIME, " ["),
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_LEVEL, "] ("),
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_THREAD, ") ["),
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_FUNC, "]: "),
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_MESSAGE, ""),
+        LOG_LEADER(LOG_LEADER_VAR_TYPE_NONE, "")
     },
     {
         LogAppenderStderr,
@@ -38,6 +46,50 @@ LOG_CONFIG current_log_config = {
 
 };
 
+static LOG_CONFIG* log_config = &log_default_config;
+static pthread_mutex_t log_config_mutex = PTHREAD_MUTEX_INITIALIZER;    // one writer at a time
+
+// readers count themselves in the half of the epoch they saw. A writer flips the epoch after the swap, so only
+// readers in the old half can hold the old snapshot, and no new reader joins that half.
+// The counts are spread over slots of a cache line each, a thread keeping to one, so logging threads do not
+// share a line; the writer adds up the slots. Past LOG_CONFIG_READER_SLOTS threads a slot is shared
+#define LOG_CONFIG_READER_SLOTS     64
+
+typedef struct{
+    unsigned readers[2] __attribute__((aligned(64)));
+}LOG_CONFIG_READERS_T;
+
+static unsigned log_config_epoch = 0;
+static LOG_CONFIG_READERS_T log_config_readers[LOG_CONFIG_READER_SLOTS];
+static unsigned log_config_next_slot = 0;
+static __thread LOG_CONFIG_READERS_T* log_config_slot = NULL;
+
+static LOG_CONFIG_READERS_T* log_config_reader_slot(void){
+    if(log_config_slot == NULL){
+        unsigned slot = __atomic_fetch_add(&log_config_next_slot, 1, __ATOMIC_RELAXED) % LOG_CONFIG_READER_SLOTS;
+        log_config_slot = log_config_readers + slot;
+    }
+    return log_config_slot;
+}
+
+const LOG_CONFIG* _LogConfigEnter(unsigned* epoch){
+    *epoch = __atomic_load_n(&log_config_epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&log_config_reader_slot()->readers[*epoch], 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&log_config, __ATOMIC_SEQ_CST);
+}
+
+void _LogConfigExit(unsigned epoch){
+    __atomic_sub_fetch(&log_config_slot->readers[epoch], 1, __ATOMIC_RELEASE);
+}
+
+static unsigned log_config_reader_count(unsigned epoch){
+    unsigned count = 0;
+    for(int slot = 0; slot < LOG_CONFIG_READER_SLOTS; slot++){
+        count += __atomic_load_n(&log_config_readers[slot].readers[epoch], __ATOMIC_SEQ_CST);
+    }
+    return count;
+}
+
 const char* log_level_tags[] = {
     "EMERGENCY",
     "ALERT",
@@ -49,135 +101,158 @@ const char* log_level_tags[] = {
     "DEBUG",
 };
 
-static char* log_current_time_with_ms (char* wrAt){
+#ifdef CLOCK_REALTIME_COARSE
+#define LOG_CLOCK_COARSE    CLOCK_REALTIME_COARSE
+#else
+#define LOG_CLOCK_COARSE    CLOCK_REALTIME
+#endif
 
-    long  ms; // Milliseconds
-    time_t s;  // Seconds
-    struct timespec spec;
+static clockid_t log_clock = CLOCK_REALTIME;      // LogSetCoarseClock() may change it while others log
 
-    clock_gettime(CLOCK_REALTIME, &spec);
+// "YYYY-MM-DD HH:MM:SS" of the second this thread last logged in; localtime() only runs when it changes
+#define LOG_TIME_SECONDS_LENGTH 19
+static __thread time_t log_time_cached_second = -1;
+static __thread char log_time_cached[LOG_TIME_SECONDS_LENGTH + 1];
 
-    s  = spec.tv_sec;
-    ms = round(spec.tv_nsec / 1.0e6); // Convert nanoseconds to milliseconds
+static char* log_time_with_ms (char* wrAt, const struct timespec* time){
+
+    struct timespec spec;
+    if (time != NULL) {
+        spec = *time;
+    } else {
+        clock_gettime(__atomic_load_n(&log_clock, __ATOMIC_RELAXED), &spec);
+    }
+
+    // round to the nearest millisecond
+    time_t s = spec.tv_sec;
+    long ms = (spec.tv_nsec + 500000L) / 1000000L;
     if (ms > 999) {
         s++;
         ms = 0;
     }
 
-    struct tm *info;
-    info = localtime( &s );
-
-    strftime(wrAt,20,"%Y-%m-%d %H:%M:%S", info);
-    wrAt += strlen(wrAt);
+    if (s != log_time_cached_second) {
+        struct tm info;
+        localtime_r( &s, &info );
+        strftime(log_time_cached, sizeof(log_time_cached), "%Y-%m-%d %H:%M:%S", &info);
+        log_time_cached_second = s;
+    }
 
-    int len = snprintf(wrAt, 5, ":%03ld", ms);
-    return wrAt + len;
+    memcpy(wrAt, log_time_cached, LOG_TIME_SECONDS_LENGTH);
+    wrAt += LOG_TIME_SECONDS_LENGTH;
+    *wrAt++ = ':';
+    *wrAt++ = '0' + ms / 100;
+    *wrAt++ = '0' + ms / 10 % 10;
+    *wrAt++ = '0' + ms % 10;
+    return wrAt;
 }
 
-static char* log_write_leader_trailer(char* wrAt, const char* trailer){
-
-    strcpy( wrAt, trailer );
-    return wrAt + strlen(trailer);
+void LogSetCoarseClock(bool coarse){
+    __atomic_store_n(&log_clock, coarse ? LOG_CLOCK_COARSE : CLOCK_REALTIME, __ATOMIC_RELAXED);
 }
 
-static char* log_write_leader_time(char* wrAt, const char* trailer){
+// the leader writers copy into [wrAt, end) and return the new wrAt; end keeps room for the terminator
+static char* log_write_text(char* wrAt, char* end, const char* text, size_t length){
 
-    wrAt = log_current_time_with_ms(wrAt);
-    return log_write_leader_trailer(wrAt, trailer);
+    if( length > (size_t)(end - wrAt)) length = end - wrAt;
+    memcpy( wrAt, text, length );
+    return wrAt + length;
 }
 
-static char* log_write_leader_file(char* wrAt, const char* trailer, const char* file){
-
-    strcpy( wrAt, file);
-    wrAt += strlen(file);
+static char* log_write_leader_time(char* wrAt, char* end, const struct timespec* time){
 
-    return log_write_leader_trailer(wrAt, trailer);
+    char timeBuffer[32];
+    char* timeEnd = log_time_with_ms(timeBuffer, time);
+    return log_write_text(wrAt, end, timeBuffer, timeEnd - timeBuffer);
 }
 
-static char* log_write_leader_func(char* wrAt, const char* trailer, const char* func){
-
-    strcpy( wrAt, func);
-    wrAt += strlen(func);
-
-    return log_write_leader_trailer(wrAt, trailer);
-}
-
-static char* log_write_leader_thread(char* wrAt, const char* trailer){
-
+unsigned LogThreadTag(void){
     pthread_t tid = pthread_self();
-    int len = snprintf(wrAt, 10, "%x", (uint16_t)((long)tid >> 6));
-    wrAt += len;
-
-    return log_write_leader_trailer(wrAt, trailer);
+    return (uint16_t)((long)tid >> 6);
 }
 
-static char* log_write_leader_level(char* wrAt, const char* trailer, LOG_LEVEL level){
-
-    strcpy( wrAt, log_level_tags[level]);
-    wrAt += strlen(wrAt);
+static char* log_write_leader_thread(char* wrAt, char* end, long thread){
 
-    return log_write_leader_trailer(wrAt, trailer);
+    char threadBuffer[10];
+    int len = snprintf(threadBuffer, sizeof(threadBuffer), "%x", thread >= 0 ? (unsigned)thread : LogThreadTag());
+    return log_write_text(wrAt, end, threadBuffer, len);
 }
 
-static char* log_write_leader_message(char* wrAt, const char* trailer, const char* msgFormat){
+// the only place a format is parsed: the caller's own
+static char* log_write_leader_message(char* wrAt, char* end, const char* msgFormat, va_list* args){
+
+    // without args the message is finished text
+    if( args == NULL) return log_write_text(wrAt, end, msgFormat, strlen(msgFormat));
 
-    strcpy( wrAt, msgFormat);
-    wrAt += strlen(msgFormat);
+    va_list argsCopy;
+    va_copy(argsCopy, *args);
+    int len = vsnprintf(wrAt, end - wrAt + 1, msgFormat, argsCopy);
+    va_end(argsCopy);
 
-    return log_write_leader_trailer(wrAt, trailer);
+    if( len < 0) return wrAt;
+    return len > end - wrAt ? end : wrAt + len;
 }
 
-static char* log_write_entry(char* wrAt, LOG_LEADER_ENTRY entry, const char* file, const char* funcName, LOG_LEVEL level, const char* msgFormat ){
+static char* log_write_entry(char* wrAt, char* end, const LOG_LEADER_ENTRY* entry, const LOG_ENTRY_ORIGIN* origin, const char* msgFormat, va_list* args ){
 
-    switch(entry.type){
+    switch(entry->type){
         case LOG_LEADER_VAR_TYPE_TIME:
-            return log_write_leader_time( wrAt, entry.trailer);
+            wrAt = log_write_leader_time(wrAt, end, origin->time);
+            break;
 
         case LOG_LEADER_VAR_TYPE_FILE:
-            return log_write_leader_file(wrAt, entry.trailer, file);
+            wrAt = log_write_text(wrAt, end, origin->file, strlen(origin->file));
+            break;
 
         case LOG_LEADER_VAR_TYPE_FUNC:
-            return log_write_leader_func( wrAt, entry.trailer, funcName);
+            wrAt = log_write_text(wrAt, end, origin->funcName, strlen(origin->funcName));
+            break;
 
         case LOG_LEADER_VAR_TYPE_THREAD:
-            return log_write_leader_thread( wrAt, entry.trailer);
+            wrAt = log_write_leader_thread(wrAt, end, origin->thread);
+            break;
 
         case LOG_LEADER_VAR_TYPE_LEVEL:
-            return log_write_leader_level( wrAt, entry.trailer, level);
+            wrAt = log_write_text(wrAt, end, log_level_tags[origin->level], strlen(log_level_tags[origin->level]));
+            break;
 
         case LOG_LEADER_VAR_TYPE_MESSAGE:
-            return log_write_leader_message( wrAt, entry.trailer, msgFormat);
+            wrAt = log_write_leader_message(wrAt, end, msgFormat, args);
+            break;
 
         default:
             return wrAt;
     }
-}
-
-static void log_write_invalid_format_buffer(char* formatBuffer, const char * format){
-    char* wrAt = formatBuffer;
-    strcpy(wrAt, LOG_INVALID_LEADER_CONFIG_MSG);
-    wrAt += strlen(LOG_INVALID_LEADER_CONFIG_MSG);
-    strcpy(wrAt, format);
-    wrAt += strlen(format);
-    *(wrAt++) = '\n';
-    *wrAt = '\0';
 
+    return log_write_text(wrAt, end, entry->trailer, entry->trailerLength);
 }
 
-static void log_write_format_buffer( char* formatBuffer, const char* file, const char* funcName, LOG_LEVEL level, const char * format){
+// LogSetConfig() compiled the leader into the config: literal preamble and trailers with their
+// lengths between the variables. They are copied as they are, so a % in them, or in a file or function
+// name, is just a character.
+static int log_write_entry_buffer( const LOG_CONFIG* config, char* entryBuffer, size_t size, const LOG_ENTRY_ORIGIN* origin, const char * format, va_list* args){
 
-    char* wrAt = formatBuffer;
-    strcpy(wrAt, current_log_config.preamble);
-    wrAt += strlen(current_log_config.preamble);
+    char* wrAt = entryBuffer;
+    char* end = entryBuffer + size - 1;
+    wrAt = log_write_text(wrAt, end, config->preamble, config->preambleLength);
 
-    for( int indx = 0 ; current_log_config.leaderEntry[indx].type != LOG_LEADER_VAR_TYPE_NONE ; indx++ ){
-        if( indx >= LOG_LEADER_VAR_MAX){
-            log_write_invalid_format_buffer(formatBuffer, format);
-            break;
-        }
-        wrAt = log_write_entry(wrAt, current_log_config.leaderEntry[indx], file, funcName, level, format );
+    for( int indx = 0 ; indx < LOG_LEADER_VAR_MAX && config->leaderEntry[indx].type != LOG_LEADER_VAR_TYPE_NONE ; indx++ ){
+        wrAt = log_write_entry(wrAt, end, &config->leaderEntry[indx], origin, format, args );
     }
+    *wrAt = '\0';
+    return wrAt - entryBuffer;
+}
+
+int LogFormatEntry(char* buffer, size_t size, const LOG_ENTRY_ORIGIN* origin, const char* format, ...){
 
+    unsigned epoch;
+    const LOG_CONFIG* config = _LogConfigEnter(&epoch);
+    va_list argptr;
+    va_start(argptr, format);
+    int length = log_write_entry_buffer( config, buffer, size, origin, format, &argptr);
+    va_end(argptr);
+    _LogConfigExit(epoch);
+    return length;
 }
 
 #define LOG_SYSLOG_FACILITY  LOG_LOCAL3
@@ -210,7 +285,12 @@ void LogAppenderSyslog ( const char* entry, LOG_LEVEL level){
 static const char* log_get_next_token ( const char** tokenStart, const char* delimeter){
 
     char* tokenEnd = strstr(*tokenStart, delimeter);
-    if( tokenEnd == NULL) return *tokenStart;
+    if( tokenEnd == NULL){
+        // the rest of the string, leaving tokenStart on its terminator
+        const char* token = *tokenStart;
+        (*tokenStart) += strlen(token);
+        return token;
+    }
 
     const char* token = (*tokenStart);
     (*tokenEnd) = '\0';
@@ -221,11 +301,13 @@ static const char* log_get_next_token ( const char** tokenStart, const char* del
 
 }
 
-static void log_set_error_config(void){
-    current_log_config.preamble = LOG_INVALID_LEADER_CONFIG_MSG;
-    current_log_config.leaderEntry[0].type = LOG_LEADER_VAR_TYPE_MESSAGE;
-    current_log_config.leaderEntry[0].trailer = "";
-    current_log_config.leaderEntry[1].type = LOG_LEADER_VAR_TYPE_NONE;
+static void log_set_error_config(LOG_CONFIG* config){
+    config->preamble = LOG_INVALID_LEADER_CONFIG_MSG;
+    config->preambleLength = strlen(LOG_INVALID_LEADER_CONFIG_MSG);
+    config->leaderEntry[0].type = LOG_LEADER_VAR_TYPE_MESSAGE;
+    config->leaderEntry[0].trailer = "";
+    config->leaderEntry[0].trailerLength = 0;
+    config->leaderEntry[1].type = LOG_LEADER_VAR_TYPE_NONE;
 
 }
 
@@ -242,21 +324,128 @@ static LOG_LEADER_VAR_TYPE log_get_leader_type_by_tag( const char* tag){
 
 }
 
-//"%(asctime): [%(levelName)] (%(thread)) [%(funcName)]: %(message)"
-void LogSetConfig(LOG_LEVEL level, const char* format ){
+typedef struct{
+    const char* glob;
+    bool byFile;                    // matched against the site's file, else its module
+    LOG_LEVEL level;
+}LOG_LEVEL_RULE_T;
+
+static LOG_LEVEL_RULE_T log_level_rules[LOG_MAX_LEVEL_RULES];
+static int log_level_rule_count = 0;
+static LOG_SITE* log_sites = NULL;
+static pthread_mutex_t log_site_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool log_rule_matches(const LOG_LEVEL_RULE_T* rule, const LOG_SITE* site){
+    if(!rule->byFile){
+        return fnmatch(rule->glob, site->module, 0) == 0;
+    }
+    const char* name = strrchr(site->file, '/');
+    return fnmatch(rule->glob, site->file, 0) == 0 || (name != NULL && fnmatch(rule->glob, name + 1, 0) == 0);
+}
+
+// the newest rule matching the site, else the LogSetConfig() level. Called with log_site_mutex held
+static int log_site_threshold(const LOG_SITE* site){
+    for(int indx = log_level_rule_count - 1; indx >= 0; indx--){
+        if(log_rule_matches(log_level_rules + indx, site)){
+            return log_level_rules[indx].level;
+        }
+    }
+    unsigned epoch;
+    int level = _LogConfigEnter(&epoch)->thresholdLevel;
+    _LogConfigExit(epoch);
+    return level;
+}
+
+static void log_sites_update(void){
+    for(LOG_SITE* site = log_sites; site != NULL; site = site->next){
+        __atomic_store_n(&site->threshold, log_site_threshold(site), __ATOMIC_RELAXED);
+    }
+}
+
+bool _LogSiteResolve(LOG_SITE* site, LOG_LEVEL level){
+
+    pthread_mutex_lock(&log_site_mutex);
+    if(site->threshold == LOG_SITE_UNRESOLVED){
+        site->next = log_sites;
+        __atomic_store_n(&log_sites, site, __ATOMIC_RELEASE);
+        __atomic_store_n(&site->threshold, log_site_threshold(site), __ATOMIC_RELAXED);
+    }
+    int threshold = site->threshold;
+    pthread_mutex_unlock(&log_site_mutex);
+
+    return (int)level <= threshold;
+}
+
+static bool log_set_rule(const char* glob, bool byFile, LOG_LEVEL level){
+
+    if(glob == NULL){
+        return false;
+    }
+
+    pthread_mutex_lock(&log_site_mutex);
+    // a glob set again becomes the newest rule
+    int indx;
+    for(indx = 0; indx < log_level_rule_count; indx++){
+        if(log_level_rules[indx].byFile == byFile && strcmp(log_level_rules[indx].glob, glob) == 0){
+            break;
+        }
+    }
+    const char* copy;
+    if(indx < log_level_rule_count){
+        copy = log_level_rules[indx].glob;
+        memmove(log_level_rules + indx, log_level_rules + indx + 1,
+                (size_t)(log_level_rule_count - indx - 1) * sizeof(LOG_LEVEL_RULE_T));
+        log_level_rule_count--;
+    } else if(log_level_rule_count == LOG_MAX_LEVEL_RULES){
+        pthread_mutex_unlock(&log_site_mutex);
+        return false;
+    } else {
+        copy = allocStringCopy(glob);
+    }
+
+    log_level_rules[log_level_rule_count].glob = copy;
+    log_level_rules[log_level_rule_count].byFile = byFile;
+    log_level_rules[log_level_rule_count].level = level;
+    log_level_rule_count++;
+    log_sites_update();
+    pthread_mutex_unlock(&log_site_mutex);
+    return true;
+}
 
-    current_log_config.thresholdLevel = level;
+bool LogSetModuleLevel(const char* moduleGlob, LOG_LEVEL level){
+    return log_set_rule(moduleGlob, false, level);
+}
+
+bool LogSetFileLevel(const char* fileGlob, LOG_LEVEL level){
+    return log_set_rule(fileGlob, true, level);
+}
 
-    releaseStringCopy(current_log_config.configString);
-    current_log_config.configString = allocStringCopy(format);
+void LogClearLevels(void){
+
+    pthread_mutex_lock(&log_site_mutex);
+    for(int indx = 0; indx < log_level_rule_count; indx++){
+        releaseStringCopy(log_level_rules[indx].glob);
+    }
+    log_level_rule_count = 0;
+    log_sites_update();
+    pthread_mutex_unlock(&log_site_mutex);
+}
+
+// compile format into the leader of config
+static void log_parse_leader(LOG_CONFIG* config, const char* format){
+
+    config->format = allocStringCopy(format);
+    config->configString = allocStringCopy(format);
 
     // find preamble
-    const char* startToken = current_log_config.configString;
+    const char* startToken = config->configString;
     const char* endFormat = startToken + strlen(format);
 
     const char* token = log_get_next_token(&startToken, "%");
 
-    current_log_config.preamble = token;
+    config->preamble = token;
+    config->preambleLength = strlen(token);
+    config->leaderEntry[0].type = LOG_LEADER_VAR_TYPE_NONE;
 
     bool msgEntryFound = false;
     int insIndx;
@@ -269,85 +458,382 @@ void LogSetConfig(LOG_LEVEL level, const char* format ){
         const char* tokenTrailer = log_get_next_token(&startToken, "%");   //  token trailer
 
         if( type != LOG_LEADER_VAR_TYPE_NONE){
-            current_log_config.leaderEntry[insIndx].type = type;
-            current_log_config.leaderEntry[insIndx].trailer = tokenTrailer;
-            current_log_config.leaderEntry[insIndx+1].type = LOG_LEADER_VAR_TYPE_NONE;
+            config->leaderEntry[insIndx].type = type;
+            config->leaderEntry[insIndx].trailer = tokenTrailer;
+            config->leaderEntry[insIndx].trailerLength = strlen(tokenTrailer);
+            config->leaderEntry[insIndx+1].type = LOG_LEADER_VAR_TYPE_NONE;
         }
 
         if( type == LOG_LEADER_VAR_TYPE_MESSAGE) msgEntryFound = true;
     }
 
     if( !msgEntryFound){
-        log_set_error_config();
+        log_set_error_config(config);
     }
+}
+
+// a copy of the current config to change before log_config_publish(). Called with log_config_mutex held
+static LOG_CONFIG* log_config_copy(void){
+
+    LOG_CONFIG* config = malloc(sizeof(LOG_CONFIG));
+    if(config == NULL){
+        return NULL;
+    }
+    *config = *log_config;
+    if(log_config->format != NULL){
+        // the leader points into the old config's strings, so it is compiled again
+        log_parse_leader(config, log_config->format);
+    }
+    return config;
+}
+
+static void log_config_release(LOG_CONFIG* config){
+    if(config != &log_default_config){
+        releaseStringCopy(config->format);
+        releaseStringCopy(config->configString);
+        free(config);
+    }
+}
+
+// flip the epoch and wait for the readers of the old half, every one that began before the flip. Called with
+// log_config_mutex held, so never from an appender
+static void log_config_wait_readers(void){
+    unsigned epoch = __atomic_fetch_add(&log_config_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while(log_config_reader_count(epoch) != 0){
+        sched_yield();
+    }
+}
+
+// swap config in and free the old one once the readers that might hold it are gone
+static void log_config_publish(LOG_CONFIG* config){
 
+    LOG_CONFIG* old = __atomic_exchange_n(&log_config, config, __ATOMIC_SEQ_CST);
+    log_config_wait_readers();
+    log_config_release(old);
+}
+
+// appenders run inside a config reader, so once the readers drain no appender still uses what was swapped out
+void _LogConfigDrain(void){
+    pthread_mutex_lock(&log_config_mutex);
+    log_config_wait_readers();
+    pthread_mutex_unlock(&log_config_mutex);
+}
+
+//"%(asctime): [%(levelName)] (%(thread)) [%(funcName)]: %(message)"
+void LogSetConfig(LOG_LEVEL level, const char* format ){
+
+    pthread_mutex_lock(&log_config_mutex);
+    LOG_CONFIG* config = malloc(sizeof(LOG_CONFIG));
+    if(config != NULL){
+        *config = *log_config;
+        config->thresholdLevel = level;
+        log_parse_leader(config, format);
+        log_config_publish(config);
+    }
+    pthread_mutex_unlock(&log_config_mutex);
+
+    pthread_mutex_lock(&log_site_mutex);
+    log_sites_update();
+    pthread_mutex_unlock(&log_site_mutex);
 }
 
 void LogAddAppender(void (*appender)(const char*, LOG_LEVEL), bool clearAppenders){
 
-    // find insert index
-    int indx;
-    for( indx=0 ; !clearAppenders && current_log_config.logAppender[indx] != NULL ; indx++ );
+    pthread_mutex_lock(&log_config_mutex);
+    LOG_CONFIG* config = log_config_copy();
+    if(config != NULL){
+        // find insert index
+        int indx;
+        for( indx=0 ; !clearAppenders && config->logAppender[indx] != NULL ; indx++ );
+
+        config->logAppender[indx++] = appender;
+        config->logAppender[indx] = NULL;
+        log_config_publish(config);
+    }
+    pthread_mutex_unlock(&log_config_mutex);
+}
 
-    current_log_config.logAppender[indx++] = appender;
-    current_log_config.logAppender[indx] = NULL;
+// args NULL logs format as it is, a finished message
+static void log_emit(const LOG_ENTRY_ORIGIN* origin, const char* format, va_list* args){
 
+    unsigned epoch;
+    const LOG_CONFIG* config = _LogConfigEnter(&epoch);
 
+    char entryBuffer[LOG_BUFFER_MAX_SIZE];
+    log_write_entry_buffer( config, entryBuffer, sizeof(entryBuffer), origin, format, args);
+
+    if( !_LogAsyncPost(entryBuffer, origin->level)){
+        for( int indx = 0 ; indx < LOG_MAX_APPENDERS && config->logAppender[indx] != NULL ; indx++ ){
+            config->logAppender[indx](entryBuffer, origin->level);
+        }
+    }
+    _LogConfigExit(epoch);
+}
+
+static void log_emit_text(const LOG_ENTRY_ORIGIN* origin, const char* format, ...){
+
+    va_list argptr;
+    va_start(argptr, format);
+    log_emit(origin, format, &argptr);
+    va_end(argptr);
 }
 
 void _LogMessageEx(const char* file, const char* funcName, LOG_LEVEL level, const char * format, ... ){
 
-    char formatBuffer[LOG_BUFFER_MAX_SIZE];
-    log_write_format_buffer( formatBuffer, file, funcName, level, format);
+    TraceBegin(TRACE_CATEGORY_LOG, "LogMessage", format, level);
 
-    char entryBuffer[LOG_BUFFER_MAX_SIZE];
+    LOG_ENTRY_ORIGIN origin = { file, funcName, level, NULL, -1 };
+
+    va_list argptr;
+    va_start(argptr, format);
+    log_emit(&origin, format, &argptr);
+    va_end(argptr);
+
+    TraceEnd(TRACE_CATEGORY_LOG, "LogMessage");
+
+}
+
+static uint64_t log_rate_interval_ns = 0;       // between messages of a site, 0 for no limit
+static uint64_t log_rate_burst_ns;              // interval times the burst
+static bool log_fold_repeats = false;
+static uint64_t log_rate_limited_total = 0;
+static uint64_t log_folded_total = 0;
+
+void LogSetRateLimit(int perSecond, int burst){
+
+    uint64_t interval = perSecond > 0 ? 1000000000ull / (uint64_t)perSecond : 0;
+    __atomic_store_n(&log_rate_burst_ns, interval * (uint64_t)(burst > 0 ? burst : 1), __ATOMIC_RELAXED);
+    __atomic_store_n(&log_rate_interval_ns, interval, __ATOMIC_RELAXED);
+}
+
+void LogSetRepeatFolding(bool fold){
+    __atomic_store_n(&log_fold_repeats, fold, __ATOMIC_RELAXED);
+}
+
+void LogSuppressedCounts(uint64_t* rateLimited, uint64_t* folded){
+    if(rateLimited != NULL) *rateLimited = __atomic_load_n(&log_rate_limited_total, __ATOMIC_RELAXED);
+    if(folded != NULL) *folded = __atomic_load_n(&log_folded_total, __ATOMIC_RELAXED);
+}
+
+static void log_report_rate(LOG_SITE* site, const LOG_ENTRY_ORIGIN* origin){
+
+    uint64_t suppressed = __atomic_exchange_n(&site->rateSuppressed, 0, __ATOMIC_RELAXED);
+    if(suppressed > 0){
+        log_emit_text(origin, "%llu messages suppressed by the rate limit", (unsigned long long)suppressed);
+    }
+}
+
+static void log_report_repeats(LOG_SITE* site, const LOG_ENTRY_ORIGIN* origin){
+
+    uint64_t repeats = __atomic_exchange_n(&site->repeats, 0, __ATOMIC_RELAXED);
+    if(repeats > 0){
+        log_emit_text(origin, "last message repeated %llu times", (unsigned long long)repeats);
+    }
+}
+
+void LogReportSuppressed(void){
+
+    // sites are only ever pushed on the front, so the list can be walked while others resolve
+    for(LOG_SITE* site = __atomic_load_n(&log_sites, __ATOMIC_ACQUIRE); site != NULL; site = site->next){
+        LOG_ENTRY_ORIGIN origin = { site->file, site->funcName, LOG_LEVEL_WARNING, NULL, -1 };
+        log_report_rate(site, &origin);
+        log_report_repeats(site, &origin);
+        // the next message is not a repeat of one already reported
+        __atomic_store_n(&site->lastHash, 0, __ATOMIC_RELAXED);
+    }
+}
+
+// generic cell rate algorithm: the token bucket kept as the one time it is full again, moved with a CAS
+static bool log_rate_admit(LOG_SITE* site){
+
+    uint64_t interval = __atomic_load_n(&log_rate_interval_ns, __ATOMIC_RELAXED);
+    if(interval == 0){
+        return true;
+    }
+    uint64_t burst = __atomic_load_n(&log_rate_burst_ns, __ATOMIC_RELAXED);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+
+    uint64_t tat = __atomic_load_n(&site->rateTat, __ATOMIC_RELAXED);
+    for(;;){
+        uint64_t next = (tat > now ? tat : now) + interval;
+        if(next - now > burst){
+            __atomic_add_fetch(&site->rateSuppressed, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&log_rate_limited_total, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        if(__atomic_compare_exchange_n(&site->rateTat, &tat, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+            return true;
+        }
+    }
+}
+
+static uint64_t log_hash(const char* text){
+    uint64_t hash = 14695981039346656037ull;    // FNV-1a
+    for(; *text; text++){
+        hash = (hash ^ (unsigned char)*text) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void log_emit_folded(LOG_SITE* site, const LOG_ENTRY_ORIGIN* origin, const char* message){
+
+    uint64_t hash = log_hash(message);
+    if(__atomic_exchange_n(&site->lastHash, hash, __ATOMIC_RELAXED) == hash){
+        __atomic_add_fetch(&site->repeats, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&log_folded_total, 1, __ATOMIC_RELAXED);
+    } else {
+        log_report_repeats(site, origin);
+        log_emit(origin, message, NULL);
+    }
+}
+
+void _LogSiteMessageEx(LOG_SITE* site, LOG_LEVEL level, const char * format, ... ){
+
+    if(!log_rate_admit(site)){
+        return;
+    }
+
+    TraceBegin(TRACE_CATEGORY_LOG, "LogMessage", format, level);
+
+    LOG_ENTRY_ORIGIN origin = { site->file, site->funcName, level, NULL, -1 };
+    log_report_rate(site, &origin);
 
     va_list argptr;
     va_start(argptr, format);
-    vsnprintf(entryBuffer, LOG_BUFFER_MAX_SIZE, formatBuffer, argptr);
+    if(!__atomic_load_n(&log_fold_repeats, __ATOMIC_RELAXED)){
+        log_emit(&origin, format, &argptr);
+    } else {
+        // the message alone decides, so it is formatted before the leader
+        char message[LOG_BUFFER_MAX_SIZE];
+        vsnprintf(message, sizeof(message), format, argptr);
+        log_emit_folded(site, &origin, message);
+    }
     va_end(argptr);
 
-    for( int indx = 0 ; indx < LOG_MAX_APPENDERS && current_log_config.logAppender[indx] != NULL ; indx++ ){
-        current_log_config.logAppender[indx](entryBuffer, level);
+    TraceEnd(TRACE_CATEGORY_LOG, "LogMessage");
+}
+
+void _LogSiteTextEx(LOG_SITE* site, LOG_LEVEL level, const char* text){
+
+    if(!log_rate_admit(site)){
+        return;
+    }
+
+    LOG_ENTRY_ORIGIN origin = { site->file, site->funcName, level, NULL, -1 };
+    log_report_rate(site, &origin);
+
+    if(!__atomic_load_n(&log_fold_repeats, __ATOMIC_RELAXED)){
+        log_emit(&origin, text, NULL);
+    } else {
+        log_emit_folded(site, &origin, text);
     }
+}
 
+#define LOG_HEX_PAIR(_high, _low)   {_high, _low}
+#define LOG_HEX_ROW(_high)  LOG_HEX_PAIR(_high, '0'), LOG_HEX_PAIR(_high, '1'), LOG_HEX_PAIR(_high, '2'), LOG_HEX_PAIR(_high, '3'), \
+    LOG_HEX_PAIR(_high, '4'), LOG_HEX_PAIR(_high, '5'), LOG_HEX_PAIR(_high, '6'), LOG_HEX_PAIR(_high, '7'), \
+    LOG_HEX_PAIR(_high, '8'), LOG_HEX_PAIR(_high, '9'), LOG_HEX_PAIR(_high, 'A'), LOG_HEX_PAIR(_high, 'B'), \
+    LOG_HEX_PAIR(_high, 'C'), LOG_HEX_PAIR(_high, 'D'), LOG_HEX_PAIR(_high, 'E'), LOG_HEX_PAIR(_high, 'F')
+
+// the two digits of every byte value, so a byte is one lookup and a two byte copy
+static const char log_hex_pairs[256][2] = {
+    LOG_HEX_ROW('0'), LOG_HEX_ROW('1'), LOG_HEX_ROW('2'), LOG_HEX_ROW('3'),
+    LOG_HEX_ROW('4'), LOG_HEX_ROW('5'), LOG_HEX_ROW('6'), LOG_HEX_ROW('7'),
+    LOG_HEX_ROW('8'), LOG_HEX_ROW('9'), LOG_HEX_ROW('A'), LOG_HEX_ROW('B'),
+    LOG_HEX_ROW('C'), LOG_HEX_ROW('D'), LOG_HEX_ROW('E'), LOG_HEX_ROW('F')
+};
 
+#define LOG_HEX_CUT_LINE_MAX    32      // "\n... %d more bytes"
+
+static int log_hex_width = LOG_HEX_DEFAULT_WIDTH;
+static int log_hex_max_bytes = LOG_HEX_DEFAULT_MAX_BYTES;
+
+void LogSetHexDump(int bytesPerLine, int maxBytes){
+    if(bytesPerLine > LOG_HEX_MAX_WIDTH) bytesPerLine = LOG_HEX_MAX_WIDTH;
+    __atomic_store_n(&log_hex_width, bytesPerLine > 0 ? bytesPerLine : LOG_HEX_DEFAULT_WIDTH, __ATOMIC_RELAXED);
+    __atomic_store_n(&log_hex_max_bytes, maxBytes > 0 ? maxBytes : LOG_HEX_DEFAULT_MAX_BYTES, __ATOMIC_RELAXED);
 }
 
+// "0010  48 65 6C 6C 6F  |Hello|": offset, width columns of hex and the printable characters
+static char* log_hex_line(char* wrAt, const uint8_t* data, int offset, int count, int width){
+
+    memcpy(wrAt, log_hex_pairs[(offset >> 8) & 0xff], 2);
+    memcpy(wrAt + 2, log_hex_pairs[offset & 0xff], 2);
+    wrAt += 4;
+    *wrAt++ = ' ';
+    for(int i = 0; i < width; i++){
+        *wrAt++ = ' ';
+        if(i < count){
+            memcpy(wrAt, log_hex_pairs[data[i]], 2);
+        } else {
+            wrAt[0] = wrAt[1] = ' ';
+        }
+        wrAt += 2;
+    }
+    *wrAt++ = ' ';
+    *wrAt++ = ' ';
+    *wrAt++ = '|';
+    for(int i = 0; i < count; i++){
+        *wrAt++ = data[i] >= 0x20 && data[i] < 0x7f ? (char)data[i] : '.';
+    }
+    *wrAt++ = '|';
+    return wrAt;
+}
+
+// the whole dump is one entry: a header line and then a line for each width bytes
 void _LogHexEx(const char* file, const char* funcName, LOG_LEVEL level, char *header, uint8_t *data, int length)
 {
-    char dumpBuffer[201] = ""; // LOG_HEX_MAX_LINE_CHARS * 5 + 1 + LOG_HEX_MAX_HEADER_LEN
-    int headerLen = 0;
-    int i = 0;
-    int j = 0;
+    if (header != NULL && strlen(header) >= LOG_HEX_MAX_HEADER_LEN)
+    {
+        _LogMessageEx(file, funcName, LOG_LEVEL_WARNING, "Header length is too long, skipping.");
+        header = NULL;
+    }
+    if (length < 0)
+    {
+        length = 0;
+    }
+
+    int width = __atomic_load_n(&log_hex_width, __ATOMIC_RELAXED);
+    int maxBytes = __atomic_load_n(&log_hex_max_bytes, __ATOMIC_RELAXED);
+    int lineLength = 1 + 5 + 3 * width + 3 + width + 1;   // newline, offset, hex, "  |", text, "|"
 
-    if (header != NULL)
+    LOG_ENTRY_ORIGIN origin = { file, funcName, level, NULL, -1 };
+
+    // the leader and the cut line share the entry with the dump
+    char dump[LOG_BUFFER_MAX_SIZE - 256];
+    int room = sizeof(dump);
+    if (_LogAsyncActive())
     {
-        headerLen = strlen(header);
-        if (headerLen >= LOG_HEX_MAX_HEADER_LEN)
-        {
-            _LogMessageEx(file, funcName, LOG_LEVEL_WARNING, "Header length is too long, skipping.");
-            header = NULL;
-            headerLen = 0;
-        }
+        // the ring cuts the entry to LOG_ASYNC_ENTRY_SIZE, so leave out whole lines instead
+        char leader[LOG_ASYNC_ENTRY_SIZE];
+        room = LOG_ASYNC_ENTRY_SIZE - LogFormatEntry(leader, sizeof(leader), &origin, "%s", "") - LOG_HEX_CUT_LINE_MAX;
+        if (room < 1) room = 1;
+    }
+    char* wrAt = dump + snprintf(dump, room, "%s%s%d bytes", header != NULL ? header : "",
+                                 header != NULL ? " " : "", length);
+    if (wrAt > dump + room - 1) wrAt = dump + room - 1;
+    char* end = dump + room - 1;
+
+    int limit = length < maxBytes ? length : maxBytes;
+    int offset = 0;
+    while (offset < limit && end - wrAt >= lineLength)
+    {
+        int count = limit - offset < width ? limit - offset : width;
+        *wrAt++ = '\n';
+        wrAt = log_hex_line(wrAt, data + offset, offset, count, width);
+        offset += count;
     }
+    *wrAt = '\0';
 
-    while (i < length)
+    if (offset < length)
     {
-        int index = 0;
-        if (header != NULL)
-        {
-            sprintf(dumpBuffer, "%s", header);
-        }
-        while(j < LOG_HEX_MAX_LINE_CHARS && i < length)
-        {
-            sprintf(dumpBuffer + index + headerLen, "[%02X] ", data[i]);
-            j++;
-            i++;
-            index += 5; // each HEX value takes up 5 characters
-        }
-        _LogMessageEx(file, funcName, level, dumpBuffer);
-        dumpBuffer[0] = '\0';
-        j = 0;
+        log_emit_text(&origin, "%s\n... %d more bytes", dump, length - offset);
+    }
+    else
+    {
+        log_emit_text(&origin, "%s", dump);
     }
 }
@@ -7,8 +7,11 @@
  */
 
 
+#define LOG_MODULE_NAME     "Semaphores"
+
 #include "Semaphores.h"
 #include "Logger.h"
+#include "Trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -35,6 +38,9 @@ static void bsem_wait(B_SEMAPHORE_T *bsem_p) {
     pthread_mutex_lock(&bsem_p->mutex);
     int waitReturn;
 
+    /* only waits that block are traced */
+    bool blocks = !bsem_p->v;
+    if(blocks) TraceBegin(TRACE_CATEGORY_WAITS, "BSemWait", NULL, (uintptr_t)bsem_p);
     while(!bsem_p->v) {
         waitReturn = pthread_cond_wait(&bsem_p->cond, &bsem_p->mutex);
         if( waitReturn == EINVAL || waitReturn == EPERM )
@@ -44,6 +50,7 @@ static void bsem_wait(B_SEMAPHORE_T *bsem_p) {
             break;
         }
     }
+    if(blocks) TraceEnd(TRACE_CATEGORY_WAITS, "BSemWait");
     bsem_p->v = false;
     pthread_mutex_unlock(&bsem_p->mutex);
 }
@@ -55,19 +62,24 @@ static bool bsem_timedwait(B_SEMAPHORE_T *bsem_p, int msec){
     msecToTimespec(msec, &waitTime);
     int waitReturn;
 
+    bool blocks = !bsem_p->v;
+    if(blocks) TraceBegin(TRACE_CATEGORY_WAITS, "BSemWait", NULL, (uintptr_t)bsem_p);
     while(!bsem_p->v) {
         waitReturn = pthread_cond_timedwait(&bsem_p->cond, &bsem_p->mutex, &waitTime);
         if( waitReturn == ETIMEDOUT){
+            TraceEnd(TRACE_CATEGORY_WAITS, "BSemWait");
             pthread_mutex_unlock(&bsem_p->mutex);
             return false;
         }
         else if( waitReturn == EINVAL || waitReturn == EPERM )
         {
+            TraceEnd(TRACE_CATEGORY_WAITS, "BSemWait");
             LogMessage(LOG_LEVEL_ERROR,"cond wait failed: %d", waitReturn);
             pthread_mutex_unlock(&bsem_p->mutex);
             return false;
         }
     }
+    if(blocks) TraceEnd(TRACE_CATEGORY_WAITS, "BSemWait");
 
     bsem_p->v = false;
     pthread_mutex_unlock(&bsem_p->mutex);
@@ -77,6 +89,8 @@ static bool bsem_timedwait(B_SEMAPHORE_T *bsem_p, int msec){
 static void isem_wait_value(I_SEMAPHORE_T *isem_p, bool (*cmp)(int v, int c), int c) {
     pthread_mutex_lock(&isem_p->mutex);
     int waitReturn;
+    bool blocks = !cmp(isem_p->v, c);
+    if(blocks) TraceBegin(TRACE_CATEGORY_WAITS, "ISemWaitValue", NULL, (uintptr_t)isem_p);
     while(!cmp(isem_p->v, c)) {
         waitReturn = pthread_cond_wait(&isem_p->cond, &isem_p->mutex);
         if( waitReturn == EINVAL || waitReturn == EPERM )
@@ -86,6 +100,7 @@ static void isem_wait_value(I_SEMAPHORE_T *isem_p, bool (*cmp)(int v, int c), in
             break;
         }
     }
+    if(blocks) TraceEnd(TRACE_CATEGORY_WAITS, "ISemWaitValue");
     pthread_mutex_unlock(&isem_p->mutex);
 }
 
@@ -96,19 +111,24 @@ static bool isem_timedwait_value(I_SEMAPHORE_T *isem_p, bool (*cmp)(int v, int c
     msecToTimespec(msec, &waitTime);
     int waitReturn;
 
+    bool blocks = !cmp(isem_p->v, c);
+    if(blocks) TraceBegin(TRACE_CATEGORY_WAITS, "ISemWaitValue", NULL, (uintptr_t)isem_p);
     while(!cmp(isem_p->v, c)) {
         waitReturn = pthread_cond_timedwait(&isem_p->cond, &isem_p->mutex, &waitTime);
         if( waitReturn == ETIMEDOUT){
+            TraceEnd(TRACE_CATEGORY_WAITS, "ISemWaitValue");
             pthread_mutex_unlock(&isem_p->mutex);
             return false;
         }
         else if( waitReturn == EINVAL || waitReturn == EPERM )
         {
+            TraceEnd(TRACE_CATEGORY_WAITS, "ISemWaitValue");
             LogMessage(LOG_LEVEL_ERROR,"cond wait failed: %d", waitReturn);
             pthread_mutex_unlock(&isem_p->mutex);
             return false;
         }
     }
+    if(blocks) TraceEnd(TRACE_CATEGORY_WAITS, "ISemWaitValue");
 
     pthread_mutex_unlock(&isem_p->mutex);
     return true;
@@ -7,9 +7,12 @@
  */
 
 
+#define LOG_MODULE_NAME     "Threads"
+
 #include "Threads.h"
 #include "Semaphores.h"
 #include "Logger.h"
+#include "Trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -33,10 +36,12 @@ typedef struct {
     B_SEMAPHORE_T completed;            /* event that determines if the thread has completed */
     B_SEMAPHORE_T started;              /* event that thread routine uses to determine if the thread has started */
     B_SEMAPHORE_T run_started;          /* event that thread requester uses to determine if the thread has started */
+    B_SEMAPHORE_T released;             /* the requester has collected completion, the thread may return to the pool */
     pthread_t thread;                   /* the thread being used to process handler function  */
     void* context;                      /* context for the handler object to use in processing */
     void* (*handler)(void*);            /* pointer to the thread processing function */
     void* result;                       /* pointer returned by handler  */
+    uint64_t trace_flow;                /* ties the run in the trace to the InitThread() that started it */
     char name[THREAD_NAME_LENGTH + 1];  /* thread friendly name */
 } THREAD_SINGLE_T;
 
@@ -58,10 +63,16 @@ static THREAD_POOL_T pool = {
     false,                      /* The pool is not initialized at first. */
 };
 
+static uint64_t trace_flow_next = 0;
+
 static void* event_processing_routine(void* arg){
 
     THREAD_SINGLE_T* singlet = (THREAD_SINGLE_T*)arg;
 
+    char trace_name[TRACE_LABEL_LENGTH + 1];
+    snprintf(trace_name, sizeof(trace_name), "pool thread %d", (int)(singlet - pool.threads));
+    TraceSetThreadName(trace_name);
+
     while(singlet->initialized){
 
         /* Phase 1:
@@ -96,7 +107,11 @@ static void* event_processing_routine(void* arg){
         if(singlet->handler != NULL){
             LogMessage(LOG_LEVEL_DEBUG, ">> handler running: (%s)", singlet->name);
             BSemReset(&singlet->completed);
+            TraceBegin(TRACE_CATEGORY_THREADS, "task", singlet->name, singlet - pool.threads);
+            TraceFlowEnd(TRACE_CATEGORY_THREADS, "InitThread", singlet->trace_flow);
             singlet->result =  singlet->handler(singlet->context);
+            TraceEnd(TRACE_CATEGORY_THREADS, "task");
+            TraceInstant(TRACE_CATEGORY_THREADS, "completed", singlet->name, singlet - pool.threads);
             LogMessage(LOG_LEVEL_DEBUG, ">> handler done: (%s)", singlet->name);
             singlet->handler = NULL;
         } else {
@@ -110,12 +125,21 @@ static void* event_processing_routine(void* arg){
         BSemPost(&singlet->completed);
         LogMessage(LOG_LEVEL_DEBUG, "THREAD(%d)PROC %d Initialed: %d", singlet - pool.threads, __LINE__, singlet->initialized);
 
+        /* Phase 9-B:
+         *  Stay out of the pool until the requester has collected completion. Otherwise the thread can be
+         *  allocated again and reset completed before the requester has seen it.
+         */
+        if(singlet->initialized){
+            BSemWait(&singlet->released, 0);
+        }
+
     }
 
     /* Phase 10:
      *  The thread has now officially exited. Decrease pool resource count by 1.
      */
     ISemUpdate(&pool.available_threads, DECR );
+    BSemPost(&singlet->completed);  /* destroy_single_thread() waits for this, also when leaving from Phase 9-B */
     LogMessage(LOG_LEVEL_DEBUG, "Exit THREAD(%d)PROC %d", singlet - pool.threads, __LINE__);
 
     return NULL;
@@ -129,6 +153,7 @@ static bool init_single_thread(THREAD_SINGLE_T *singlet){
 
     BSemInit(&singlet->available, true);
     BSemInit(&singlet->run_started, false);
+    BSemInit(&singlet->released, false);
     BSemInit(&singlet->completed, false);
     BSemInit(&singlet->started, false);
 
@@ -142,6 +167,7 @@ static bool init_single_thread(THREAD_SINGLE_T *singlet){
         LogMessage(LOG_LEVEL_ERROR, "Failed to start processor thread for '%s'. return=%d errno=%d", singlet->name, pthread_create_return, errno);
         BSemDestroy(&singlet->available);
         BSemDestroy(&singlet->run_started);
+        BSemDestroy(&singlet->released);
         BSemDestroy(&singlet->completed);
         BSemDestroy(&singlet->started);
         return false;
@@ -176,6 +202,7 @@ static bool destroy_single_thread(THREAD_SINGLE_T *singlet, int timeout){
      */
     singlet->initialized = false;
     BSemPost(&singlet->started);
+    BSemPost(&singlet->released);   /* in case it finished a run nobody waited for */
 
     /* Phase 9-A (destroy scenario):
      *  Wait for completion signal
@@ -197,6 +224,7 @@ static bool destroy_single_thread(THREAD_SINGLE_T *singlet, int timeout){
 
     BSemDestroy(&singlet->available);
     BSemDestroy(&singlet->run_started);
+    BSemDestroy(&singlet->released);
     BSemDestroy(&singlet->completed);
     BSemDestroy(&singlet->started);
 
@@ -231,19 +259,31 @@ static inline bool wait_for_single_thread(THREAD_SINGLE_T *singlet, int msec, vo
             LogMessage(LOG_LEVEL_ERROR, "| -- run_started=%d", BSemValue(&singlet->run_started));
             LogMessage(LOG_LEVEL_ERROR, "| -- started=%d", BSemValue(&singlet->started));
 
+            /* Phase 9-B (timeout):
+             *  The requester gives the run up. The thread returns to the pool once the handler is done,
+             *  and the result is dropped
+             */
+            BSemPost(&singlet->released);
             return false;
         }
 
     } else {
         BSemWait(&singlet->completed, 0);
-        BSemWait(&singlet->available, 0);
-        BSemPost(&singlet->available);
     }
 
     if(result){
         *result = singlet->result;
     }
 
+    /* Phase 9-B:
+     *  Completion is collected, hand the thread back to the pool
+     */
+    BSemPost(&singlet->released);
+    if(msec <= 0){
+        BSemWait(&singlet->available, 0);
+        BSemPost(&singlet->available);
+    }
+
     LogMessage(LOG_LEVEL_DEBUG, "Waiting for thread success: %s(%d) remaining:%d", name, tIndex, ISemValue(&pool.available_threads));
 
     return true;
@@ -393,6 +433,8 @@ static inline bool allocate_in_pool(THREAD_T *t, const char* name, void* (*handl
     singlet->context = context;
     singlet->handler = handler;
     singlet->result = NULL;
+    singlet->trace_flow = __atomic_add_fetch(&trace_flow_next, 1, __ATOMIC_RELAXED);
+    TraceFlowStart(TRACE_CATEGORY_THREADS, "InitThread", singlet->trace_flow);
 
     *t = allocated;
 
@@ -434,7 +476,9 @@ bool InitThread(THREAD_T *t, const char* name, void* (*handler)(void*), void* co
         return false;
     }
 
+    TraceBegin(TRACE_CATEGORY_THREADS, "InitThread", name, 0);
     bool ret = allocate_in_pool(t, name, handler, context);
+    TraceEnd(TRACE_CATEGORY_THREADS, "InitThread");
 
     return ret;
 
@@ -452,7 +496,11 @@ bool WaitThreadComplete(THREAD_T *t, int msec, void** result ){
         return false;
     }
 
-    return wait_for_single_thread(pool.threads + *t, msec, result);
+    TraceBegin(TRACE_CATEGORY_THREADS, "WaitThreadComplete", pool.threads[*t].name, *t);
+    bool ret = wait_for_single_thread(pool.threads + *t, msec, result);
+    TraceEnd(TRACE_CATEGORY_THREADS, "WaitThreadComplete");
+
+    return ret;
 }
 
 pthread_t GetThreadID(THREAD_T *t){
@@ -0,0 +1,247 @@
+/**
+ * @file   Trace.c
+ * @date   October 2026
+ * @version 0.1
+ * @brief   Timeline tracing into per thread ring buffers, dumped as Chrome trace event JSON
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "Trace.h"
+
+typedef struct {
+    uint64_t timestamp;                     /* CLOCK_MONOTONIC ns */
+    uint64_t value;
+    const char* name;
+    char phase;
+    unsigned char category;
+    char label[TRACE_LABEL_LENGTH];         /* not terminated when full */
+} TRACE_EVENT_T;
+
+typedef struct TRACE_RING {
+    struct TRACE_RING* next;
+    int tid;
+    bool exited;                            /* its thread has ended, nothing records into it any more */
+    char threadName[TRACE_LABEL_LENGTH + 1];
+    uint64_t head;                          /* events ever written; the newest TRACE_RING_EVENTS are kept */
+    uint64_t reset;                         /* head at the last TraceReset(), under trace_lock. Only the owner writes head */
+    TRACE_EVENT_T events[TRACE_RING_EVENTS];
+} TRACE_RING_T;
+
+unsigned trace_categories = 0;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static TRACE_RING_T* trace_rings = NULL;
+static int trace_next_tid = 1;
+
+static __thread TRACE_RING_T* trace_ring = NULL;
+static __thread char trace_thread_name[TRACE_LABEL_LENGTH + 1];
+
+static const char* trace_category_names[] = { "threads", "waits", "log", "user" };
+
+static void trace_thread_exit(void* arg){
+    TRACE_RING_T* ring = arg;
+    pthread_mutex_lock(&trace_lock);
+    ring->exited = true;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void trace_init_key(void){
+    pthread_key_create(&trace_key, trace_thread_exit);
+}
+
+static uint64_t trace_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// first event of this thread: give it a ring
+static TRACE_RING_T* trace_ring_create(void){
+
+    TRACE_RING_T* ring = malloc(sizeof(TRACE_RING_T));
+    if(ring == NULL){
+        return NULL;
+    }
+    ring->exited = false;
+    ring->head = 0;
+    ring->reset = 0;
+    memcpy(ring->threadName, trace_thread_name, sizeof(ring->threadName));
+
+    pthread_once(&trace_once, trace_init_key);
+    pthread_setspecific(trace_key, ring);
+
+    pthread_mutex_lock(&trace_lock);
+    ring->tid = trace_next_tid++;
+    ring->next = trace_rings;
+    trace_rings = ring;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_ring = ring;
+    return ring;
+}
+
+void _TraceEventEx(TRACE_PHASE phase, const char* name, const char* label, uint64_t value, unsigned category){
+
+    TRACE_RING_T* ring = trace_ring != NULL ? trace_ring : trace_ring_create();
+    if(ring == NULL){
+        return;
+    }
+
+    // only this thread writes the ring; the release store publishes the event to a dump
+    uint64_t head = ring->head;
+    TRACE_EVENT_T* e = ring->events + (head & (TRACE_RING_EVENTS - 1));
+    e->timestamp = trace_now();
+    e->value = value;
+    e->name = name;
+    e->phase = (char)phase;
+    e->category = (unsigned char)category;
+    if(label != NULL){
+        strncpy(e->label, label, sizeof(e->label));
+    } else {
+        e->label[0] = 0;
+    }
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void TraceEnable(unsigned categories){
+    __atomic_store_n(&trace_categories, categories, __ATOMIC_RELAXED);
+}
+
+void TraceSetThreadName(const char* name){
+    strncpy(trace_thread_name, name, TRACE_LABEL_LENGTH);
+    trace_thread_name[TRACE_LABEL_LENGTH] = 0;
+    if(trace_ring != NULL){
+        pthread_mutex_lock(&trace_lock);
+        memcpy(trace_ring->threadName, trace_thread_name, sizeof(trace_ring->threadName));
+        pthread_mutex_unlock(&trace_lock);
+    }
+}
+
+// write s as a JSON string, at most max characters of it
+static void trace_write_string(FILE* f, const char* s, size_t max){
+    fputc('"', f);
+    for(size_t i = 0; i < max && s[i] != 0; i++){
+        unsigned char c = s[i];
+        if(c == '"' || c == '\\'){
+            fprintf(f, "\\%c", c);
+        } else if(c < 0x20){
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static const char* trace_category_name(unsigned category){
+    for(int i = 0; i < (int)(sizeof(trace_category_names) / sizeof(trace_category_names[0])); i++){
+        if(category & (1u << i)) return trace_category_names[i];
+    }
+    return "default";
+}
+
+static void trace_write_event(FILE* f, int pid, int tid, const TRACE_EVENT_T* e){
+
+    fprintf(f, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"cat\":\"%s\",\"name\":", e->phase, pid, tid,
+            e->timestamp / 1000.0, trace_category_name(e->category));
+    trace_write_string(f, e->name != NULL ? e->name : "", SIZE_MAX);
+
+    switch(e->phase){
+    case TRACE_PHASE_FLOW_START:
+        fprintf(f, ",\"id\":%llu", (unsigned long long)e->value);
+        break;
+    case TRACE_PHASE_FLOW_END:
+        // bind to the span that encloses the flow end, not to the next one
+        fprintf(f, ",\"id\":%llu,\"bp\":\"e\"", (unsigned long long)e->value);
+        break;
+    case TRACE_PHASE_INSTANT:
+        fprintf(f, ",\"s\":\"t\"");
+        /* fall through */
+    default:
+        if(e->label[0] != 0 || e->value != 0){
+            fprintf(f, ",\"args\":{\"label\":");
+            trace_write_string(f, e->label, sizeof(e->label));
+            fprintf(f, ",\"value\":%llu}", (unsigned long long)e->value);
+        }
+        break;
+    }
+    fputc('}', f);
+}
+
+long TraceDumpJson(FILE* f){
+
+    int pid = (int)getpid();
+    long written = 0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(f, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"eeyore\"}}", pid);
+
+    pthread_mutex_lock(&trace_lock);
+    for(TRACE_RING_T* ring = trace_rings; ring != NULL; ring = ring->next){
+
+        char name[TRACE_LABEL_LENGTH + 16];
+        if(ring->threadName[0] != 0){
+            snprintf(name, sizeof(name), "%s", ring->threadName);
+        } else {
+            snprintf(name, sizeof(name), "thread %d", ring->tid);
+        }
+        fprintf(f, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", pid, ring->tid);
+        trace_write_string(f, name, sizeof(name));
+        fprintf(f, "}}");
+
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        if(first < ring->reset) first = ring->reset;
+        int depth = 0;
+        for(uint64_t i = first; i < head; i++){
+            const TRACE_EVENT_T* e = ring->events + (i & (TRACE_RING_EVENTS - 1));
+            if(e->phase == TRACE_PHASE_BEGIN){
+                depth++;
+            } else if(e->phase == TRACE_PHASE_END){
+                if(depth == 0) continue;
+                depth--;
+            }
+            trace_write_event(f, pid, ring->tid, e);
+            written++;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    fprintf(f, "\n]}\n");
+    return written;
+}
+
+bool TraceDumpJsonFile(const char* path){
+
+    FILE* f = fopen(path, "w");
+    if(f == NULL){
+        return false;
+    }
+    TraceDumpJson(f);
+    return fclose(f) == 0;
+}
+
+void TraceReset(void){
+
+    pthread_mutex_lock(&trace_lock);
+    TRACE_RING_T** link = &trace_rings;
+    while(*link != NULL){
+        TRACE_RING_T* ring = *link;
+        if(ring->exited){
+            *link = ring->next;
+            free(ring);
+        } else {
+            // its thread may be recording: leave head to it and hide what it has written so far
+            ring->reset = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+}